@@ -47,6 +47,8 @@ public:
 	uint8_t Read_Sector(uint32_t head,uint32_t cylinder,uint32_t sector,void * data);
 	uint8_t Write_Sector(uint32_t head,uint32_t cylinder,uint32_t sector,void * data);
 	uint8_t Read_AbsoluteSector(uint32_t sectnum, void * data);
+	uint8_t Read_Sectors(uint32_t head, uint32_t cylinder, uint32_t sector, uint32_t count, void *data);
+	uint8_t Read_AbsoluteSectors(uint32_t sectnum, uint32_t count, void *data);
 	uint8_t Write_AbsoluteSector(uint32_t sectnum, void * data);
 
 	void Set_Geometry(uint32_t setHeads, uint32_t setCyl, uint32_t setSect, uint32_t setSectSize);
@@ -22,6 +22,7 @@
 #include "dosbox.h"
 
 #include <stdio.h>
+#include <string>
 
 class Section;
 enum OPL_Mode {
@@ -32,6 +33,8 @@ enum OPL_Mode {
 #define CAPTURE_MIDI	0x04
 #define CAPTURE_IMAGE	0x08
 #define CAPTURE_VIDEO	0x10
+#define CAPTURE_STREAM_VIDEO	0x20
+#define CAPTURE_STREAM_AUDIO	0x40
 
 extern Bitu CaptureState;
 
@@ -64,6 +67,15 @@ void CAPTURE_AddMidi(bool sysex, Bitu len, uint8_t * data);
 void CAPTURE_VideoStart();
 void CAPTURE_VideoStop();
 
+// Raw video and audio streams for external encoders
+void CAPTURE_StreamStart(const std::string &video_target,
+                         const std::string &audio_target);
+void CAPTURE_StreamStop();
+void CAPTURE_StreamImage(int width, int height, int bpp, int pitch,
+                         uint8_t flags, float fps, const uint8_t *data,
+                         const uint8_t *pal);
+void CAPTURE_StreamWave(uint32_t freq, uint32_t len, const int16_t *data);
+
 // Gravis UltraSound configuration and initialization
 void GUS_AddConfigSection(const config_ptr_t &conf);
 
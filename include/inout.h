@@ -72,6 +72,21 @@ void IO_FreeWriteHandler(io_port_t port,
                          io_width_t max_width,
                          io_port_t range = 1);
 
+// Devices that buffer the data software fetches with REP INS from a single
+// port can also register a block handler. It copies up to 'count' values of
+// the given width to 'dest' and returns how many it copied; whatever it
+// doesn't serve is read one value at a time through the regular handler.
+using io_block_read_f = std::function<size_t(io_port_t port, uint8_t *dest,
+                                             size_t count, io_width_t width)>;
+
+void IO_RegisterBlockReadHandler(io_port_t port, io_block_read_f handler);
+void IO_FreeBlockReadHandler(io_port_t port);
+
+// Serves up to 'count' reads from the port straight into guest memory at the
+// linear address, as far as the port has a block handler and the memory is
+// plain RAM within one page. Returns the number of values transferred.
+size_t IO_ReadBlock(io_port_t port, uint32_t lin_addr, size_t count, io_width_t width);
+
 /* Classes to manage the IO objects created by the various devices.
  * The io objects will remove itself on destruction.*/
 class IO_Base{
@@ -131,6 +131,11 @@ void MEM_BlockRead(PhysPt pt, void *data, Bitu size);
 void MEM_BlockCopy(PhysPt dest, PhysPt src, Bitu size);
 void MEM_StrCopy(PhysPt pt, char *data, Bitu size);
 
+// Returns a host pointer through which the whole range can be written
+// directly, or nullptr if part of it needs a page handler or its pages
+// aren't contiguous on the host
+HostPt MEM_GetBlockWritePtr(PhysPt pt, size_t size);
+
 void mem_memcpy(PhysPt dest, PhysPt src, Bitu size);
 Bitu mem_strlen(PhysPt pt);
 void mem_strcpy(PhysPt dest, PhysPt src);
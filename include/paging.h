@@ -89,6 +89,9 @@ void PAGING_ClearTLB(void);
 void PAGING_LinkPage(Bitu lin_page,Bitu phys_page);
 void PAGING_LinkPage_ReadOnly(Bitu lin_page,Bitu phys_page);
 void PAGING_UnlinkPages(Bitu lin_page,Bitu pages);
+/* Lets writes to an already linked page go straight to host memory, for
+   handlers that only need to see the first write to a page */
+void PAGING_MakePageWritable(Bitu lin_page,HostPt host_page);
 /* This maps the page directly, only use when paging is disabled */
 void PAGING_MapPage(Bitu lin_page,Bitu phys_page);
 bool PAGING_MakePhysPage(Bitu & page);
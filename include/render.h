@@ -27,12 +27,13 @@
 
 #include <deque>
 #include <string>
+#include <vector>
 
 #include "../src/gui/render_scalers.h"
 
 #define RENDER_SKIP_CACHE	16
-//Enable this for scalers to support 0 input for empty lines
-//#define RENDER_NULL_INPUT
+//Scalers support 0 input for lines that haven't changed
+#define RENDER_NULL_INPUT
 
 struct RenderPal_t {
 	struct {
@@ -87,6 +88,18 @@ struct Render_t {
 		uint32_t inHeight = 0;
 		uint32_t inLine = 0;
 		uint32_t outLine = 0;
+		// Palette-deferred 8bpp path: the scalers work on palette
+		// indexes at output resolution and the colours are looked up
+		// in a single pass once the frame is done.
+		bool deferPalette = false;
+		bool expandAll = false;
+		uint32_t outWidth = 0;
+		uint32_t outHeight = 0;
+		std::vector<uint8_t> indexFrame = {};
+		// Integer nearest-neighbour path, used by the replicating
+		// scalers when input and output share a pixel format.
+		uint32_t xscale = 0;
+		uint32_t pixelSize = 0;
 	} scale = {};
 #if C_OPENGL
 	struct {
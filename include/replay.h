@@ -0,0 +1,73 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_REPLAY_H
+#define DOSBOX_REPLAY_H
+
+#include "dosbox.h"
+
+#include <ctime>
+#include <string>
+
+#include "keyboard.h"
+
+// Records host input into a compact log and replays it deterministically.
+//
+// Host input is only delivered between emulated millisecond ticks, so each
+// event is keyed by the tick it arrived on. The cycle setting in effect at
+// every tick is logged too, which lets a replay run unthrottled while
+// executing exactly the same instructions per tick as the recorded session.
+// Guest-visible host clocks follow the emulated clock while recording or
+// replaying, so both runs see the same time.
+
+void REPLAY_StartRecording(const std::string &filename);
+void REPLAY_StartReplay(const std::string &filename);
+void REPLAY_StartFrameHashes(const std::string &filename);
+void REPLAY_Shutdown(Section *sec);
+
+bool REPLAY_IsReplaying();
+bool REPLAY_IsHashingFrames();
+
+// Called between ticks, right before the next tick starts. Logs the cycle
+// setting when recording; injects the logged input when replaying.
+void REPLAY_Tick();
+
+// Called by the input entry points. Logs the event when recording and
+// returns false if host input has to be dropped because a replay is running.
+bool REPLAY_AcceptKey(KBD_KEYS key, bool pressed);
+bool REPLAY_AcceptMouseMove(float xrel, float yrel, float x, float y, bool emulate);
+bool REPLAY_AcceptMouseButton(uint8_t button, bool pressed);
+
+// Writes a hash of a rendered source frame when frame hashing is enabled
+void REPLAY_AddFrame(int width, int height, int bpp, int pitch,
+                     const uint8_t *data, const uint8_t *pal);
+
+// Host clocks as the guest should see them: the real clocks normally, and
+// the recording's start time plus the emulated time while recording or
+// replaying.
+int64_t REPLAY_GetTimeMs();
+int64_t REPLAY_GetTicks();
+
+static inline time_t REPLAY_GetTime()
+{
+	return static_cast<time_t>(REPLAY_GetTimeMs() / 1000);
+}
+
+#endif
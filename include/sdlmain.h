@@ -114,6 +114,10 @@ struct SDL_Block {
 	bool updating = false;
 	bool update_display_contents = true;
 	bool resizing_window = false;
+	// Cleared while the window is minimized or hidden, or when running
+	// with a video driver that has no visible output (ie: headless)
+	bool is_visible = true;
+	bool is_headless = false;
 	bool wait_on_error = false;
 	SCALING_MODE scaling_mode = SCALING_MODE::NONE;
 	struct {
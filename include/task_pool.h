@@ -0,0 +1,149 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_TASK_POOL_H
+#define DOSBOX_TASK_POOL_H
+
+#include "dosbox.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+TaskPool Class
+~~~~~~~~~~~~~~
+TaskPool runs work off the emulation thread on a fixed set of worker threads,
+sized to the host's cores by default.
+
+Tasks are queued in one of two lanes. Workers always take audio tasks before
+background ones, and background tasks never occupy the last idle worker, so
+latency-sensitive audio work isn't stuck behind long-running jobs like disk
+prefetch or capture encoding.
+
+Usage:
+ 1. Use the shared pool from TASK_GetPool(), or construct a private one with
+    a name and a worker count. For example: TaskPool pool("dosbox:scaler", 2);
+ 2. Submit a callable with a task name and lane, which returns a std::future
+    for its result. Exceptions thrown by the task are rethrown by get().
+ 3. GetStats() returns the run count and timings per task name, which can be
+    used to see what's worth offloading and whether the pool keeps up.
+
+Destroying a pool runs the tasks still queued before joining its workers.
+*/
+
+enum class TaskLane {
+	Audio,
+	Background,
+};
+
+struct TaskStats {
+	int64_t runs = 0;
+	int64_t total_us = 0;     // time spent running
+	int64_t max_us = 0;       // longest single run
+	int64_t total_wait_us = 0; // time spent queued before running
+};
+
+class TaskPool {
+public:
+	// Zero workers means one per host core
+	TaskPool(const char *thread_name, const int num_workers = 0);
+	TaskPool() = delete;
+	TaskPool(const TaskPool &other) = delete;
+	TaskPool &operator=(const TaskPool &other) = delete;
+	~TaskPool();
+
+	template <typename F>
+	auto Submit(const char *task_name, const TaskLane lane, F &&task)
+	        -> std::future<std::invoke_result_t<F>>
+	{
+		using result_t = std::invoke_result_t<F>;
+		auto promise = std::make_shared<std::promise<result_t>>();
+		auto future = promise->get_future();
+		auto callable = std::make_shared<std::decay_t<F>>(std::forward<F>(task));
+
+		// The result is published after the task's statistics are
+		// recorded, so they're up to date once the future is ready
+		Enqueue(task_name, lane, [promise, callable]() -> publisher_t {
+			try {
+				if constexpr (std::is_void_v<result_t>) {
+					(*callable)();
+					return [promise] { promise->set_value(); };
+				} else {
+					auto result = std::make_shared<result_t>(
+					        (*callable)());
+					return [promise, result] {
+						promise->set_value(std::move(*result));
+					};
+				}
+			} catch (...) {
+				return [promise, error = std::current_exception()] {
+					promise->set_exception(error);
+				};
+			}
+		});
+		return future;
+	}
+
+	int NumWorkers() const;
+	size_t NumQueued();
+
+	std::map<std::string, TaskStats> GetStats();
+	void ResetStats();
+
+private:
+	using clock = std::chrono::steady_clock;
+	using publisher_t = std::function<void()>;
+	using runner_t = std::function<publisher_t()>;
+
+	struct QueuedTask {
+		const char *name = nullptr;
+		runner_t run = {};
+		clock::time_point queued_at = {};
+	};
+
+	void Enqueue(const char *task_name, const TaskLane lane, runner_t &&run);
+	bool CanTakeBackground() const;
+	void WorkerLoop();
+
+	std::vector<std::thread> workers = {};
+	std::deque<QueuedTask> audio_queue = {};
+	std::deque<QueuedTask> background_queue = {};
+	std::map<std::string, TaskStats> stats = {};
+	std::mutex mutex = {};
+	std::condition_variable has_tasks = {};
+	int idle_workers = 0;
+	bool stopping = false;
+};
+
+// The pool shared by the emulator's subsystems, started on first use
+TaskPool &TASK_GetPool();
+
+#endif
@@ -219,7 +219,8 @@ struct VGA_HWCURSOR {
 	uint16_t startaddr = 0;
 	uint8_t posx = 0;
 	uint8_t posy = 0;
-	uint8_t mc[64][64] = {};
+	uint8_t mc[64][64] = {}; // the pattern decoded into one operation per pixel
+	bool mc_dirty = true;    // the pattern address changed since decoding
 };
 
 struct VGA_S3 {
@@ -435,6 +436,25 @@ struct VGA_LFB {
 	PageHandler *handler = nullptr;
 };
 
+/* Video memory written since the last drawn frame, one byte per 4 KiB page.
+   The SVGA linear modes map guest writes straight into vga.mem.linear; only
+   the first write to a page after a frame starts is trapped to mark it, so
+   the renderer can skip lines nothing was written to. */
+constexpr uint32_t vga_dirty_page_shift = 12;
+constexpr uint8_t vga_dirty_written = 1 << 0; // since the frame started
+constexpr uint8_t vga_dirty_pending = 1 << 1; // not yet in a drawn frame
+
+struct VGA_Dirty {
+	uint8_t pages[(vga_maxmemsize >> vga_dirty_page_shift) + 1] = {};
+	// Every writer of the displayed memory is accounted for
+	bool tracking = false;
+	// Layout of the last frame, lines only line up again if it is unchanged
+	uint32_t address = 0;
+	uint32_t address_add = 0;
+	uint32_t split_line = 0;
+	bool plain_lines = false; // nothing was drawn over the memory contents
+};
+
 struct VGA_Type {
 	VGAModes mode = {}; /* The mode the vga system is in */
 	uint8_t misc_output = 0;
@@ -464,6 +484,7 @@ struct VGA_Type {
 	VGA_Changes changes = {};
 #endif
 	VGA_LFB lfb = {};
+	VGA_Dirty dirty = {};
 	// Composite video mode parameters
 	int ri = 0, rq = 0, gi = 0, gq = 0, bi = 0, bq = 0;
 	int sharpness = 0;
@@ -519,6 +540,7 @@ double VGA_GetPreferredRate();
 void VGA_DACSetEntirePalette(void);
 void VGA_StartRetrace(void);
 void VGA_StartUpdateLFB(void);
+void VGA_ProtectDirtyPages(void);
 void VGA_SetBlinking(uint8_t enabled);
 void VGA_SetCGA2Table(uint8_t val0,uint8_t val1);
 void VGA_SetCGA4Table(uint8_t val0,uint8_t val1,uint8_t val2,uint8_t val3);
@@ -531,6 +553,18 @@ void VGA_LogInitialization(const char *adapter_name,
 
 extern VGA_Type vga;
 
+// For writers that bypass the page handlers and poke vga.mem.linear directly
+static inline void VGA_MarkDirty(const uint32_t start, const uint32_t len)
+{
+	if (!len)
+		return;
+	constexpr auto num_pages = sizeof(vga.dirty.pages);
+	auto page = start >> vga_dirty_page_shift;
+	const auto last = (start + len - 1) >> vga_dirty_page_shift;
+	for (; page <= last && page < num_pages; ++page)
+		vga.dirty.pages[page] |= vga_dirty_written;
+}
+
 /* Support for modular SVGA implementation */
 /* Video mode extra data to be passed to FinishSetMode_SVGA().
    This structure will be in flux until all drivers (including S3)
@@ -74,6 +74,7 @@ void GFX_SwitchFullScreen(void);
 bool GFX_StartUpdate(uint8_t * &pixels, int &pitch);
 void GFX_EndUpdate( const uint16_t *changedLines );
 void GFX_GetSize(int &width, int &height, bool &fullscreen);
+bool GFX_IsVisible();
 void GFX_LosingFocus();
 void GFX_RegenerateWindow(Section *sec);
 
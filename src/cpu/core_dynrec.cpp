@@ -20,13 +20,16 @@
 
 #if (C_DYNREC)
 
+#include <algorithm>
 #include <cassert>
+#include <cinttypes>
 #include <cstdarg>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <type_traits>
+#include <unordered_map>
 
 #if defined (WIN32)
 #include <windows.h>
@@ -49,6 +52,7 @@
 #include "mem.h"
 #include "cpu.h"
 #include "debug.h"
+#include "fpu.h"
 #include "paging.h"
 #include "inout.h"
 #include "lazyflags.h"
@@ -91,6 +95,16 @@
 #define DRC_SEG_GS 5
 
 
+// the x87 arithmetic operations, numbered like the reg field of their
+// encodings, for backends that generate them inline
+#define DRC_FPU_ADD 0
+#define DRC_FPU_MUL 1
+#define DRC_FPU_SUB 4
+#define DRC_FPU_SUBR 5
+#define DRC_FPU_DIV 6
+#define DRC_FPU_DIVR 7
+
+
 // access to a general register
 #define DRCD_REG_VAL(reg) (&cpu_regs.regs[reg].dword)
 // access to a segment register
@@ -134,6 +148,78 @@ struct core_dynrec_t {
 
 static core_dynrec_t core_dynrec;
 
+// statistics on the translated code, logged when the code cache is closed
+struct dynrec_stats_t {
+	uint64_t tlb_inline_hits;	// memory accesses served by the inline TLB lookup
+	uint64_t tlb_helper_calls;	// memory accesses that called a checked helper
+	uint64_t deferred_cycles;		// cycles interpreted while translation was deferred
+	uint64_t cold_instructions;		// instructions interpreted because their code wasn't hot yet
+	uint64_t translated_blocks;		// blocks handed to the translator
+	uint64_t demoted_pages;			// code pages handed back to data use
+};
+
+static dynrec_stats_t dynrec_stats;
+
+// Counting memory accesses puts a counter update on every translated guest
+// memory access, so it's only done in heavy debug builds
+#if C_HEAVY_DEBUG
+#define DYNREC_MEMORY_STATS 1
+#define DYNREC_COUNT_HELPER_CALL() (++dynrec_stats.tlb_helper_calls)
+#else
+#define DYNREC_MEMORY_STATS 0
+#define DYNREC_COUNT_HELPER_CALL()
+#endif
+
+// Translating a burst of new code (a level load, an overlay, a program
+// start) in one go stalls the emulation, so only a limited number of blocks
+// is translated per emulated millisecond. Once the budget has run out, the
+// normal core runs the rest of the time slice and the code is translated
+// when it is reached again with budget left; as it is read from guest
+// memory only then, writes in the meantime need no special care.
+#define DYNREC_TRANSLATIONS_PER_TICK 64
+
+static struct {
+	uint32_t tick;		// PIC_Ticks when the budget was last refilled
+	uint32_t budget;	// blocks that may still be translated during tick
+} dynrec_translation;
+
+// Code that runs only once (initialization, self-modifying startup stubs)
+// isn't worth translating, so code addresses are interpreted until they
+// are reached for the hot_threshold-th time, which translates them. The
+// counts are kept in a small table indexed by a hash of the physical
+// address; collisions only make code hot a bit early.
+#define DYNREC_EXEC_COUNT_BITS 16
+
+static struct {
+	uint8_t hot_threshold;
+	uint8_t counts[1<<DYNREC_EXEC_COUNT_BITS];
+} dynrec_exec = {1, {}};
+
+void CPU_Core_Dynrec_SetHotThreshold(int threshold) {
+	dynrec_exec.hot_threshold=(uint8_t)clamp(threshold,1,255);
+}
+
+uint64_t CPU_Core_Dynrec_TranslatedBlocks(void) {
+	return dynrec_stats.translated_blocks;
+}
+
+static bool dynrec_is_hot(uint32_t phys_addr) {
+	if (dynrec_exec.hot_threshold<=1) return true;
+	uint8_t &count=dynrec_exec.counts[(phys_addr*2654435761u)>>(32-DYNREC_EXEC_COUNT_BITS)];
+	if (count<255) count++;
+	return count>=dynrec_exec.hot_threshold;
+}
+
+static bool dynrec_may_translate(void) {
+	if (dynrec_translation.tick!=PIC_Ticks) {
+		dynrec_translation.tick=PIC_Ticks;
+		dynrec_translation.budget=DYNREC_TRANSLATIONS_PER_TICK;
+	}
+	if (!dynrec_translation.budget) return false;
+	dynrec_translation.budget--;
+	return true;
+}
+
 // core_dynrec is often being used this way:
 //
 //   function_expecting_int16_ptr((uint16_t*)(&core_dynrec.readdata));
@@ -151,6 +237,83 @@ static_assert(offsetof(core_dynrec_t, readdata) % sizeof(uint32_t) == 0,
 
 #include "dyn_cache.h"
 
+// DOS programs often keep their variables next to their code. Every write to
+// a page holding translated code goes through the CodePageHandler, so a page
+// that is mostly written to as data and only rarely runs its code is better
+// off without translations: it keeps its fast writable mapping and the normal
+// core runs its code. Demoted pages are translated again after a back-off
+// period, which doubles each time the same page gets demoted again.
+// The use of the code is sampled by the dispatch loop: a run and the blocks
+// linked to it are credited to the page the run was entered on. Blocks take
+// a cycle per instruction, so two data writes per cycle are roughly sixteen
+// per run of a typical block.
+#define DYNREC_DATA_WRITES_PER_CYCLE 2
+#define DYNREC_DEMOTION_TICKS 1000
+#define DYNREC_DEMOTION_MAX_TICKS 64000
+
+struct dynrec_page_policy_t {
+	uint32_t demoted_at;	// PIC_Ticks when the page was last demoted
+	uint32_t ticks;			// back-off period before translating it again
+	uint32_t demotions;		// how often the page has been demoted
+};
+
+static std::unordered_map<Bitu, dynrec_page_policy_t> dynrec_page_policy;
+
+// weigh the data writes of a page against the use of its translated code
+static void dynrec_weigh_data_page(void) {
+	CodePageHandler *page=cache.busy_data_page;
+	cache.busy_data_page=nullptr;
+	const Bitu phys_page=page->GetPhysPage();
+	const uint32_t writes=page->data_writes;
+	const uint32_t cycles=page->executed_cycles;
+	page->data_writes=0;
+	page->executed_cycles=0;
+	if ((uint64_t)cycles*DYNREC_DATA_WRITES_PER_CYCLE>=writes) {
+		// the code is used enough, forget about earlier demotions
+		if (dynrec_page_policy.erase(phys_page))
+			LOG(LOG_CPU,LOG_NORMAL)("DYNREC: page %05x kept as code page",(unsigned)phys_page);
+		return;
+	}
+	auto &policy=dynrec_page_policy[phys_page];
+	policy.ticks=policy.demotions ? std::min(policy.ticks*2,(uint32_t)DYNREC_DEMOTION_MAX_TICKS)
+	                              : DYNREC_DEMOTION_TICKS;
+	policy.demoted_at=PIC_Ticks;
+	policy.demotions++;
+	dynrec_stats.demoted_pages++;
+	LOG(LOG_CPU,LOG_NORMAL)("DYNREC: page %05x demoted for %u ms, %u data writes for %u cycles run",
+	                        (unsigned)phys_page,policy.ticks,writes,cycles);
+	page->ClearRelease();
+}
+
+// is the physical page still in its back-off period after a demotion
+static bool dynrec_page_demoted(Bitu phys_page) {
+	const auto it=dynrec_page_policy.find(phys_page);
+	if (it==dynrec_page_policy.end()) return false;
+	return (PIC_Ticks-it->second.demoted_at)<it->second.ticks;
+}
+
+void CPU_Core_Dynrec_LogPagePolicy(void) {
+	char out[128];
+	LOG(LOG_MISC,LOG_ERROR)("Code pages (page, blocks, cycles run, data writes):");
+	for (CodePageHandler *page=cache.used_pages;page;page=page->next) {
+		snprintf(out,sizeof(out),"  %05x %4u %10u %6u",(unsigned)page->GetPhysPage(),
+		         (unsigned)page->GetActiveBlocks(),page->executed_cycles,page->data_writes);
+		LOG(LOG_MISC,LOG_ERROR)("%s",out);
+	}
+	LOG(LOG_MISC,LOG_ERROR)("Demoted pages (page, demotions, back-off ms, state):");
+	for (const auto &entry:dynrec_page_policy) {
+		const auto &policy=entry.second;
+		const uint32_t elapsed=PIC_Ticks-policy.demoted_at;
+		if (elapsed<policy.ticks)
+			snprintf(out,sizeof(out),"  %05x %3u %6u data for %u more ms",(unsigned)entry.first,
+			         policy.demotions,policy.ticks,policy.ticks-elapsed);
+		else
+			snprintf(out,sizeof(out),"  %05x %3u %6u translated again",(unsigned)entry.first,
+			         policy.demotions,policy.ticks);
+		LOG(LOG_MISC,LOG_ERROR)("%s",out);
+	}
+}
+
 #define X86			0x01
 #define X86_64		0x02
 #define MIPSEL		0x03
@@ -220,6 +383,9 @@ Bits CPU_Core_Dynrec_Run(void) {
 			return debugCallback;
 #endif
 
+		// a page collected enough data writes to be reconsidered
+		if (GCC_UNLIKELY(cache.busy_data_page)) dynrec_weigh_data_page();
+
 		CodePageHandler *chandler = 0;
 		// see if the current page is present and contains code
 		if (GCC_UNLIKELY(MakeCodePage(ip_point,chandler))) {
@@ -236,11 +402,28 @@ Bits CPU_Core_Dynrec_Run(void) {
 		if (!block) {
 			// no block found, thus translate the instruction stream
 			// unless the instruction is known to be modified
-			if (!chandler->invalidation_map || (chandler->invalidation_map[ip_point&4095]<4)) {
+			const bool modified=chandler->invalidation_map && (chandler->invalidation_map[ip_point&4095]>=4);
+			const bool hot=!modified && dynrec_is_hot((uint32_t)((chandler->GetPhysPage()<<12)|(ip_point&4095)));
+			if (hot && dynrec_may_translate()) {
 				// translate up to 32 instructions
+				dynrec_stats.translated_blocks++;
 				block=CreateCacheBlock(chandler,ip_point,32);
+			} else if (hot) {
+				// the translation budget is spent, so the normal core runs
+				// the rest of the time slice instead of returning here for
+				// every instruction
+				const int32_t old_cycles=CPU_Cycles;
+				const Bits nc_retcode=CPU_Core_Normal_Run();
+				dynrec_stats.deferred_cycles+=(uint64_t)(old_cycles-std::max(CPU_Cycles,0));
+				// a trap flag set meanwhile is handled by this core's
+				// trap decoder, which returns to this core afterwards
+				if (cpudecoder==&CPU_Core_Normal_Trap_Run)
+					cpudecoder=&CPU_Core_Dynrec_Trap_Run;
+				return nc_retcode;
 			} else {
-				// let the normal core handle this instruction to avoid zero-sized blocks
+				// let the normal core handle this instruction to avoid zero-sized
+				// blocks, while the code is cold
+				if (!modified) dynrec_stats.cold_instructions++;
 				Bitu old_cycles=CPU_Cycles;
 				CPU_Cycles=1;
 				Bits nc_retcode=CPU_Core_Normal_Run();
@@ -255,9 +438,13 @@ Bits CPU_Core_Dynrec_Run(void) {
 
 run_block:
 		cache.block.running=0;
+		// the block may be freed while it runs, its page handler is not
+		CodePageHandler *block_page=block->page.handler;
+		const Bits cycles_before=CPU_Cycles;
 		// now we're ready to run the dynamic code block
 //		BlockReturn ret=((BlockReturn (*)(void))(block->cache.start))();
 		BlockReturn ret=core_dynrec.runcode(block->cache.start);
+		block_page->AddExecutedCycles(cycles_before-CPU_Cycles);
 
 		switch (ret) {
 		case BR_Iret:
@@ -363,6 +550,23 @@ void CPU_Core_Dynrec_Cache_Init(bool enable_cache) {
 }
 
 void CPU_Core_Dynrec_Cache_Close(void) {
+#if DYNREC_MEMORY_STATS
+	if (dynrec_stats.tlb_inline_hits || dynrec_stats.tlb_helper_calls)
+		LOG_MSG("DYNREC: Memory accesses: %" PRIu64 " inline TLB hits, %" PRIu64 " helper calls",
+		        dynrec_stats.tlb_inline_hits, dynrec_stats.tlb_helper_calls);
+#endif
+	if (dynrec_stats.translated_blocks || dynrec_stats.cold_instructions)
+		LOG_MSG("DYNREC: %" PRIu64 " blocks translated, %" PRIu64 " cold instructions interpreted",
+		        dynrec_stats.translated_blocks, dynrec_stats.cold_instructions);
+	if (dynrec_stats.deferred_cycles)
+		LOG_MSG("DYNREC: %" PRIu64 " cycles interpreted while translation was deferred",
+		        dynrec_stats.deferred_cycles);
+	if (dynrec_stats.demoted_pages)
+		LOG_MSG("DYNREC: %" PRIu64 " code pages demoted to data pages",
+		        dynrec_stats.demoted_pages);
+	dynrec_stats = {};
+	memset(dynrec_exec.counts, 0, sizeof(dynrec_exec.counts));
+	dynrec_page_policy.clear();
 	cache_close();
 }
 
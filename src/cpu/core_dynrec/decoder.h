@@ -51,6 +51,15 @@ static CacheBlock *CreateCacheBlock(CodePageHandler *codepage, PhysPt start, Bit
 
 	InitFlagsOptimization();
 
+#if defined(DRC_USE_REG_CACHE)
+	// blocks are entered with nothing held in the register cache
+	gen_regcache_reset();
+#endif
+#if defined(DRC_USE_INLINE_FPU)
+	// and with TOP only in memory
+	dyn_fpu_top_held_at=nullptr;
+#endif
+
 	// every codeblock that is run sets cache.block.running to itself
 	// so the block linking knows the last executed block
 	gen_mov_direct_ptr(&cache.block.running,(Bitu)decode.block);
@@ -72,6 +81,8 @@ static CacheBlock *CreateCacheBlock(CodePageHandler *codepage, PhysPt start, Bit
 		decode.cycles++;
 		decode.op_start=decode.code;
 restart_prefix:
+		// the normal core runs instructions reaching into a demoted page
+		if (GCC_UNLIKELY(decode_nears_demoted_page())) goto illegalopcode;
 		Bitu opcode;
 		if (!decode.page.invmap) opcode=decode_fetchb();
 		else {
@@ -161,6 +161,11 @@ static bool MakeCodePage(Bitu lin_addr, CodePageHandler *&cph)
 		cph = nullptr;
 		return false;
 	}
+	// pages mostly used for data are left alone for a while
+	if (dynrec_page_demoted(phys_page)) {
+		cph = nullptr;
+		return false;
+	}
 	// find a free CodePage
 	if (!cache.free_pages) {
 		if (cache.used_pages!=decode.page.code) cache.used_pages->ClearRelease();
@@ -211,6 +216,17 @@ static void decode_advancepage(void) {
 	decode.page.index=0;
 }
 
+// An instruction can't be translated if it reaches into a page that has
+// been handed back to data use, as decode_advancepage needs a code page
+// handler for it. The opcode and its operands that follow the current
+// position take at most 15 bytes, so only instructions that start that
+// close to the end of the page have to look at the next one.
+static bool decode_nears_demoted_page(void) {
+	if (GCC_LIKELY(decode.page.index<=4096-15)) return false;
+	Bitu phys_page=decode.page.first+1;
+	return PAGING_MakePhysPage(phys_page) && dynrec_page_demoted(phys_page);
+}
+
 // fetch the next byte of the instruction stream
 static uint8_t decode_fetchb(void) {
 	if (GCC_UNLIKELY(decode.page.index>=4096)) {
@@ -396,7 +412,24 @@ static void inline dyn_get_modrm(void) {
 #endif
 
 
-#ifdef DRC_USE_REGS_ADDR
+#if defined(DRC_USE_REG_CACHE)
+
+#define MOV_REG_VAL_TO_HOST_REG(host_reg, reg_index) gen_mov_regcache_to_reg(host_reg,reg_index,true)
+#define ADD_REG_VAL_TO_HOST_REG(host_reg, reg_index) gen_add_regcache_to_reg(host_reg,reg_index)
+
+#define MOV_REG_WORD16_TO_HOST_REG(host_reg, reg_index) gen_mov_regcache_to_reg(host_reg,reg_index,false)
+#define MOV_REG_WORD32_TO_HOST_REG(host_reg, reg_index) gen_mov_regcache_to_reg(host_reg,reg_index,true)
+#define MOV_REG_WORD_TO_HOST_REG(host_reg, reg_index, dword) gen_mov_regcache_to_reg(host_reg,reg_index,dword)
+
+#define MOV_REG_WORD16_FROM_HOST_REG(host_reg, reg_index) gen_mov_regcache_from_reg(host_reg,reg_index,false)
+#define MOV_REG_WORD32_FROM_HOST_REG(host_reg, reg_index) gen_mov_regcache_from_reg(host_reg,reg_index,true)
+#define MOV_REG_WORD_FROM_HOST_REG(host_reg, reg_index, dword) gen_mov_regcache_from_reg(host_reg,reg_index,dword)
+
+#define MOV_REG_BYTE_TO_HOST_REG_LOW(host_reg, reg_index, high_byte) gen_mov_regcache_byte_to_reg_low(host_reg,reg_index,high_byte)
+#define MOV_REG_BYTE_TO_HOST_REG_LOW_CANUSEWORD(host_reg, reg_index, high_byte) gen_mov_regcache_byte_to_reg_low_canuseword(host_reg,reg_index,high_byte)
+#define MOV_REG_BYTE_FROM_HOST_REG_LOW(host_reg, reg_index, high_byte) gen_mov_regcache_byte_from_reg_low(host_reg,reg_index,high_byte)
+
+#elif defined(DRC_USE_REGS_ADDR)
 
 #define MOV_REG_VAL_TO_HOST_REG(host_reg, reg_index) gen_mov_regval32_to_reg(host_reg,(Bitu)(DRCD_REG_VAL(reg_index)) - (Bitu)(&cpu_regs))
 #define ADD_REG_VAL_TO_HOST_REG(host_reg, reg_index) gen_add_regval32_to_reg(host_reg,(Bitu)(DRCD_REG_VAL(reg_index)) - (Bitu)(&cpu_regs))
@@ -497,6 +530,19 @@ static inline void dyn_set_eip_end(HostReg reg,uint32_t imm=0) {
 
 
 
+// generate a call to a parameterless function that leaves the guest general
+// purpose registers alone (flags operators, memory accessors, fpu helpers),
+// so the values held in the register cache stay valid across it
+static inline void gen_call_function_keep_regs(void * func) {
+#if defined(DRC_USE_REG_CACHE)
+	const auto cached = regcache;
+	gen_call_function_raw(func);
+	regcache = cached;
+#else
+	gen_call_function_raw(func);
+#endif
+}
+
 // the following functions generate function calls
 // parameters are loaded by generating code using gen_load_param_ which
 // is architecture dependent
@@ -685,6 +731,7 @@ static void dyn_check_exception(HostReg reg) {
 
 bool DRC_CALL_CONV mem_readb_checked_drc(PhysPt address) DRC_FC;
 bool DRC_CALL_CONV mem_readb_checked_drc(PhysPt address) {
+	DYNREC_COUNT_HELPER_CALL();
 	HostPt tlb_addr=get_tlb_read(address);
 	if (tlb_addr) {
 		const uint8_t byte = host_readb(tlb_addr + address);
@@ -697,6 +744,7 @@ bool DRC_CALL_CONV mem_readb_checked_drc(PhysPt address) {
 
 bool DRC_CALL_CONV mem_readw_checked_drc(PhysPt address) DRC_FC;
 bool DRC_CALL_CONV mem_readw_checked_drc(PhysPt address) {
+	DYNREC_COUNT_HELPER_CALL();
 	if ((address & 0xfff)<0xfff) {
 		HostPt tlb_addr=get_tlb_read(address);
 		if (tlb_addr) {
@@ -709,6 +757,7 @@ bool DRC_CALL_CONV mem_readw_checked_drc(PhysPt address) {
 
 bool DRC_CALL_CONV mem_readd_checked_drc(PhysPt address) DRC_FC;
 bool DRC_CALL_CONV mem_readd_checked_drc(PhysPt address) {
+	DYNREC_COUNT_HELPER_CALL();
 	if ((address & 0xfff)<0xffd) {
 		HostPt tlb_addr=get_tlb_read(address);
 		if (tlb_addr) {
@@ -722,6 +771,7 @@ bool DRC_CALL_CONV mem_readd_checked_drc(PhysPt address) {
 bool DRC_CALL_CONV mem_writeb_checked_drc(PhysPt address, uint8_t val) DRC_FC;
 bool DRC_CALL_CONV mem_writeb_checked_drc(PhysPt address, uint8_t val)
 {
+	DYNREC_COUNT_HELPER_CALL();
 	HostPt tlb_addr = get_tlb_write(address);
 	if (tlb_addr) {
 		host_writeb(tlb_addr + address, val);
@@ -733,6 +783,7 @@ bool DRC_CALL_CONV mem_writeb_checked_drc(PhysPt address, uint8_t val)
 
 bool DRC_CALL_CONV mem_writew_checked_drc(PhysPt address,uint16_t val) DRC_FC;
 bool DRC_CALL_CONV mem_writew_checked_drc(PhysPt address,uint16_t val) {
+	DYNREC_COUNT_HELPER_CALL();
 	if ((address & 0xfff)<0xfff) {
 		HostPt tlb_addr=get_tlb_write(address);
 		if (tlb_addr) {
@@ -744,6 +795,7 @@ bool DRC_CALL_CONV mem_writew_checked_drc(PhysPt address,uint16_t val) {
 
 bool DRC_CALL_CONV mem_writed_checked_drc(PhysPt address,uint32_t val) DRC_FC;
 bool DRC_CALL_CONV mem_writed_checked_drc(PhysPt address,uint32_t val) {
+	DYNREC_COUNT_HELPER_CALL();
 	if ((address & 0xfff)<0xffd) {
 		HostPt tlb_addr=get_tlb_write(address);
 		if (tlb_addr) {
@@ -756,36 +808,55 @@ bool DRC_CALL_CONV mem_writed_checked_drc(PhysPt address,uint32_t val) {
 
 // functions that enable access to the memory
 
+// Backends that define DRC_USE_INLINE_TLB emit the TLB lookup and the host
+// memory access inline; the helper call below it is then only reached for
+// TLB misses, handler pages and accesses that cross a page boundary.
+#ifdef DRC_USE_INLINE_TLB
+#define DYN_MEM_INLINE(reg,size,write) const uint8_t* inline_done=gen_mem_access_inline(reg,size,write)
+#define DYN_MEM_INLINE_DONE() gen_fill_branch_long(inline_done)
+#else
+#define DYN_MEM_INLINE(reg,size,write)
+#define DYN_MEM_INLINE_DONE()
+#endif
+
 // read a byte from a given address and store it in reg_dst
 static void dyn_read_byte(HostReg reg_addr,HostReg reg_dst) {
 	gen_mov_regs(FC_OP1,reg_addr);
-	gen_call_function_raw((void *)&mem_readb_checked_drc);
+	DYN_MEM_INLINE(reg_dst,1,false);
+	gen_call_function_keep_regs((void *)&mem_readb_checked_drc);
 	dyn_check_exception(FC_RETOP);
 	gen_mov_byte_to_reg_low(reg_dst,&core_dynrec.readdata);
+	DYN_MEM_INLINE_DONE();
 }
 static void dyn_read_byte_canuseword(HostReg reg_addr,HostReg reg_dst) {
 	gen_mov_regs(FC_OP1,reg_addr);
-	gen_call_function_raw((void *)&mem_readb_checked_drc);
+	DYN_MEM_INLINE(reg_dst,1,false);
+	gen_call_function_keep_regs((void *)&mem_readb_checked_drc);
 	dyn_check_exception(FC_RETOP);
 	gen_mov_byte_to_reg_low_canuseword(reg_dst,&core_dynrec.readdata);
+	DYN_MEM_INLINE_DONE();
 }
 
 // write a byte from reg_val into the memory given by the address
 static void dyn_write_byte(HostReg reg_addr,HostReg reg_val) {
 	gen_mov_regs(FC_OP2,reg_val);
 	gen_mov_regs(FC_OP1,reg_addr);
-	gen_call_function_raw((void *)&mem_writeb_checked_drc);
+	DYN_MEM_INLINE(FC_OP2,1,true);
+	gen_call_function_keep_regs((void *)&mem_writeb_checked_drc);
 	dyn_check_exception(FC_RETOP);
+	DYN_MEM_INLINE_DONE();
 }
 
 // read a 32bit (dword=true) or 16bit (dword=false) value
 // from a given address and store it in reg_dst
 static void dyn_read_word(HostReg reg_addr,HostReg reg_dst,bool dword) {
 	gen_mov_regs(FC_OP1,reg_addr);
-	if (dword) gen_call_function_raw((void *)&mem_readd_checked_drc);
-	else gen_call_function_raw((void *)&mem_readw_checked_drc);
+	DYN_MEM_INLINE(reg_dst,dword?4:2,false);
+	if (dword) gen_call_function_keep_regs((void *)&mem_readd_checked_drc);
+	else gen_call_function_keep_regs((void *)&mem_readw_checked_drc);
 	dyn_check_exception(FC_RETOP);
 	gen_mov_word_to_reg(reg_dst,&core_dynrec.readdata,dword);
+	DYN_MEM_INLINE_DONE();
 }
 
 // write a 32bit (dword=true) or 16bit (dword=false) value
@@ -794,9 +865,11 @@ static void dyn_write_word(HostReg reg_addr,HostReg reg_val,bool dword) {
 //	if (!dword) gen_extend_word(false,reg_val);
 	gen_mov_regs(FC_OP2,reg_val);
 	gen_mov_regs(FC_OP1,reg_addr);
-	if (dword) gen_call_function_raw((void *)&mem_writed_checked_drc);
-	else gen_call_function_raw((void *)&mem_writew_checked_drc);
+	DYN_MEM_INLINE(FC_OP2,dword?4:2,true);
+	if (dword) gen_call_function_keep_regs((void *)&mem_writed_checked_drc);
+	else gen_call_function_keep_regs((void *)&mem_writew_checked_drc);
 	dyn_check_exception(FC_RETOP);
+	DYN_MEM_INLINE_DONE();
 }
 
 // effective address calculation helper, op2 has to be present!
@@ -52,18 +52,106 @@ static void FPU_FFREE(Bitu st) {
 #endif
 
 
+#if defined(DRC_USE_INLINE_FPU)
+// The inline FPU code holds TOP in a host register, so a run of FPU
+// instructions within a block reads it from memory only once. The register
+// is clobbered by everything else, so it is only valid while no other code
+// has been generated after the FPU instruction that left it there.
+static const uint8_t *dyn_fpu_top_held_at=nullptr;
+#endif
+
+// load TOP into reg
+static void dyn_fpu_load_top(HostReg reg) {
+#if defined(DRC_USE_INLINE_FPU)
+	if (dyn_fpu_top_held_at==cache.pos) {
+		gen_fpu_get_top(reg);
+		return;
+	}
+	gen_mov_word_to_reg(reg,(void*)(&TOP),true);
+	gen_fpu_hold_top(reg);
+#else
+	gen_mov_word_to_reg(reg,(void*)(&TOP),true);
+#endif
+}
+
+// the generated code still holds TOP
+static inline void dyn_fpu_top_held() {
+#if defined(DRC_USE_INLINE_FPU)
+	dyn_fpu_top_held_at=cache.pos;
+#endif
+}
+
 static inline void dyn_fpu_top() {
-	gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+	dyn_fpu_load_top(FC_OP1);
+	gen_mov_regs(FC_OP2,FC_OP1);
 	gen_add_imm(FC_OP2,decode.modrm.rm);
-	gen_and_imm(FC_OP2,7);
-	gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+	if (decode.modrm.rm) gen_and_imm(FC_OP2,7);
 }
 
 static inline void dyn_fpu_top_swapped() {
-	gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+	dyn_fpu_load_top(FC_OP2);
+	gen_mov_regs(FC_OP1,FC_OP2);
 	gen_add_imm(FC_OP1,decode.modrm.rm);
-	gen_and_imm(FC_OP1,7);
-	gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+	if (decode.modrm.rm) gen_and_imm(FC_OP1,7);
+}
+
+// pop the register stack; without the underflow check (release builds) the
+// inline FPU code does it on the held TOP
+static void dyn_fpu_pop() {
+#if defined(DRC_USE_INLINE_FPU) && (DB_FPU_STACK_CHECK_POP == DB_FPU_STACK_CHECK_NONE)
+	if (dyn_fpu_top_held_at!=cache.pos) dyn_fpu_load_top(FC_OP1);
+	gen_fpu_pop();
+	dyn_fpu_top_held();
+#else
+	gen_call_function_keep_regs((void*)&FPU_FPOP);
+#endif
+}
+
+// ST(FC_OP1) = ST(FC_OP1) <op> ST(FC_OP2), with op one of the DRC_FPU_ values;
+// backends that generate the arithmetic inline avoid the helper call
+static void dyn_fpu_arith(Bitu op) {
+#if defined(DRC_USE_INLINE_FPU)
+	gen_fpu_arith(op,FC_OP1,FC_OP2);
+	dyn_fpu_top_held();
+#else
+	static void (* const helpers[8])(Bitu,Bitu)={
+		FPU_FADD,FPU_FMUL,nullptr,nullptr,FPU_FSUB,FPU_FSUBR,FPU_FDIV,FPU_FDIVR
+	};
+	gen_call_function_RR((void*)helpers[op],FC_OP1,FC_OP2);
+#endif
+}
+
+// ST(FC_OP1) = ST(FC_OP1) <op> the operand loaded by an FPU_FLD_*_EA helper
+static void dyn_fpu_arith_ea(Bitu op) {
+#if defined(DRC_USE_INLINE_FPU)
+	gen_fpu_arith_ea(op,FC_OP1);
+	dyn_fpu_top_held();
+#else
+	static void (* const helpers[8])(Bitu)={
+		FPU_FADD_EA,FPU_FMUL_EA,nullptr,nullptr,FPU_FSUB_EA,FPU_FSUBR_EA,FPU_FDIV_EA,FPU_FDIVR_EA
+	};
+	gen_call_function_R((void*)helpers[op],FC_OP1);
+#endif
+}
+
+// ST(FC_OP2) = ST(FC_OP1)
+static void dyn_fpu_fst() {
+#if defined(DRC_USE_INLINE_FPU)
+	gen_fpu_copy(FC_OP1,FC_OP2);
+	dyn_fpu_top_held();
+#else
+	gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+#endif
+}
+
+// exchange ST(FC_OP1) and ST(FC_OP2)
+static void dyn_fpu_fxch() {
+#if defined(DRC_USE_INLINE_FPU)
+	gen_fpu_xchg(FC_OP1,FC_OP2);
+	dyn_fpu_top_held();
+#else
+	gen_call_function_RR((void*)&FPU_FXCH,FC_OP1,FC_OP2);
+#endif
 }
 
 static void dyn_eatree() {
@@ -71,29 +159,29 @@ static void dyn_eatree() {
 	Bitu group = decode.modrm.reg&7; //It is already that, but compilers.
 	switch (group){
 	case 0x00:		// FADD ST,STi
-		gen_call_function_R((void*)&FPU_FADD_EA,FC_OP1);
+		dyn_fpu_arith_ea(DRC_FPU_ADD);
 		break;
 	case 0x01:		// FMUL  ST,STi
-		gen_call_function_R((void*)&FPU_FMUL_EA,FC_OP1);
+		dyn_fpu_arith_ea(DRC_FPU_MUL);
 		break;
 	case 0x02:		// FCOM  STi
 		gen_call_function_R((void*)&FPU_FCOM_EA,FC_OP1);
 		break;
 	case 0x03:		// FCOMP STi
 		gen_call_function_R((void*)&FPU_FCOM_EA,FC_OP1);
-		gen_call_function_raw((void*)&FPU_FPOP);
+		dyn_fpu_pop();
 		break;
 	case 0x04:		// FSUB  ST,STi
-		gen_call_function_R((void*)&FPU_FSUB_EA,FC_OP1);
+		dyn_fpu_arith_ea(DRC_FPU_SUB);
 		break;	
 	case 0x05:		// FSUBR ST,STi
-		gen_call_function_R((void*)&FPU_FSUBR_EA,FC_OP1);
+		dyn_fpu_arith_ea(DRC_FPU_SUBR);
 		break;
 	case 0x06:		// FDIV  ST,STi
-		gen_call_function_R((void*)&FPU_FDIV_EA,FC_OP1);
+		dyn_fpu_arith_ea(DRC_FPU_DIV);
 		break;
 	case 0x07:		// FDIVR ST,STi
-		gen_call_function_R((void*)&FPU_FDIVR_EA,FC_OP1);
+		dyn_fpu_arith_ea(DRC_FPU_DIVR);
 		break;
 	default:
 		break;
@@ -107,29 +195,29 @@ static void dyn_fpu_esc0(){
 		dyn_fpu_top();
 		switch (decode.modrm.reg){
 		case 0x00:		//FADD ST,STi
-			gen_call_function_RR((void*)&FPU_FADD,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_ADD);
 			break;
 		case 0x01:		// FMUL  ST,STi
-			gen_call_function_RR((void*)&FPU_FMUL,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_MUL);
 			break;
 		case 0x02:		// FCOM  STi
 			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
 			break;
 		case 0x03:		// FCOMP STi
 			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x04:		// FSUB  ST,STi
-			gen_call_function_RR((void*)&FPU_FSUB,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_SUB);
 			break;	
 		case 0x05:		// FSUBR ST,STi
-			gen_call_function_RR((void*)&FPU_FSUBR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_SUBR);
 			break;
 		case 0x06:		// FDIV  ST,STi
-			gen_call_function_RR((void*)&FPU_FDIV,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_DIV);
 			break;
 		case 0x07:		// FDIVR ST,STi
-			gen_call_function_RR((void*)&FPU_FDIVR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_DIVR);
 			break;
 		default:
 			break;
@@ -137,7 +225,7 @@ static void dyn_fpu_esc0(){
 	} else { 
 		dyn_fill_ea(FC_ADDR);
 		gen_call_function_R((void*)&FPU_FLD_F32_EA,FC_ADDR); 
-		gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+		dyn_fpu_load_top(FC_OP1);
 		dyn_eatree();
 	}
 }
@@ -149,44 +237,44 @@ static void dyn_fpu_esc1(){
 	if (decode.modrm.mod == 3) {
 		switch (decode.modrm.reg){
 		case 0x00: /* FLD STi */
-			gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+			dyn_fpu_load_top(FC_OP1);
 			gen_add_imm(FC_OP1,decode.modrm.rm);
 			gen_and_imm(FC_OP1,7);
 			gen_protect_reg(FC_OP1);
-			gen_call_function_raw((void*)&FPU_PREP_PUSH); 
-			gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+			gen_call_function_keep_regs((void*)&FPU_PREP_PUSH); 
+			dyn_fpu_load_top(FC_OP2);
 			gen_restore_reg(FC_OP1);
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+			dyn_fpu_fst();
 			break;
 		case 0x01: /* FXCH STi */
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FXCH,FC_OP1,FC_OP2);
+			dyn_fpu_fxch();
 			break;
 		case 0x02: /* FNOP */
-			gen_call_function_raw((void*)&FPU_FNOP);
+			gen_call_function_keep_regs((void*)&FPU_FNOP);
 			break;
 		case 0x03: /* FSTP STi */
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_fst();
+			dyn_fpu_pop();
 			break;   
 		case 0x04:
 			switch(decode.modrm.rm){
 			case 0x00:       /* FCHS */
-				gen_call_function_raw((void*)&FPU_FCHS);
+				gen_call_function_keep_regs((void*)&FPU_FCHS);
 				break;
 			case 0x01:       /* FABS */
-				gen_call_function_raw((void*)&FPU_FABS);
+				gen_call_function_keep_regs((void*)&FPU_FABS);
 				break;
 			case 0x02:       /* UNKNOWN */
 			case 0x03:       /* ILLEGAL */
 				LOG(LOG_FPU,LOG_WARN)("ESC 1:Unhandled group %X subfunction %X",static_cast<uint32_t>(decode.modrm.reg), static_cast<uint32_t>(decode.modrm.rm));
 				break;
 			case 0x04:       /* FTST */
-				gen_call_function_raw((void*)&FPU_FTST);
+				gen_call_function_keep_regs((void*)&FPU_FTST);
 				break;
 			case 0x05:       /* FXAM */
-				gen_call_function_raw((void*)&FPU_FXAM);
+				gen_call_function_keep_regs((void*)&FPU_FXAM);
 				break;
 			case 0x06:       /* FTSTP (cyrix)*/
 			case 0x07:       /* UNKNOWN */
@@ -197,25 +285,25 @@ static void dyn_fpu_esc1(){
 		case 0x05:
 			switch(decode.modrm.rm){	
 			case 0x00:       /* FLD1 */
-				gen_call_function_raw((void*)&FPU_FLD1);
+				gen_call_function_keep_regs((void*)&FPU_FLD1);
 				break;
 			case 0x01:       /* FLDL2T */
-				gen_call_function_raw((void*)&FPU_FLDL2T);
+				gen_call_function_keep_regs((void*)&FPU_FLDL2T);
 				break;
 			case 0x02:       /* FLDL2E */
-				gen_call_function_raw((void*)&FPU_FLDL2E);
+				gen_call_function_keep_regs((void*)&FPU_FLDL2E);
 				break;
 			case 0x03:       /* FLDPI */
-				gen_call_function_raw((void*)&FPU_FLDPI);
+				gen_call_function_keep_regs((void*)&FPU_FLDPI);
 				break;
 			case 0x04:       /* FLDLG2 */
-				gen_call_function_raw((void*)&FPU_FLDLG2);
+				gen_call_function_keep_regs((void*)&FPU_FLDLG2);
 				break;
 			case 0x05:       /* FLDLN2 */
-				gen_call_function_raw((void*)&FPU_FLDLN2);
+				gen_call_function_keep_regs((void*)&FPU_FLDLN2);
 				break;
 			case 0x06:       /* FLDZ*/
-				gen_call_function_raw((void*)&FPU_FLDZ);
+				gen_call_function_keep_regs((void*)&FPU_FLDZ);
 				break;
 			case 0x07:       /* ILLEGAL */
 				LOG(LOG_FPU,LOG_WARN)("ESC 1:Unhandled group %X subfunction %X",static_cast<uint32_t>(decode.modrm.reg),static_cast<uint32_t>(decode.modrm.rm));
@@ -225,28 +313,28 @@ static void dyn_fpu_esc1(){
 		case 0x06:
 			switch(decode.modrm.rm){
 			case 0x00:	/* F2XM1 */
-				gen_call_function_raw((void*)&FPU_F2XM1);
+				gen_call_function_keep_regs((void*)&FPU_F2XM1);
 				break;
 			case 0x01:	/* FYL2X */
-				gen_call_function_raw((void*)&FPU_FYL2X);
+				gen_call_function_keep_regs((void*)&FPU_FYL2X);
 				break;
 			case 0x02:	/* FPTAN  */
-				gen_call_function_raw((void*)&FPU_FPTAN);
+				gen_call_function_keep_regs((void*)&FPU_FPTAN);
 				break;
 			case 0x03:	/* FPATAN */
-				gen_call_function_raw((void*)&FPU_FPATAN);
+				gen_call_function_keep_regs((void*)&FPU_FPATAN);
 				break;
 			case 0x04:	/* FXTRACT */
-				gen_call_function_raw((void*)&FPU_FXTRACT);
+				gen_call_function_keep_regs((void*)&FPU_FXTRACT);
 				break;
 			case 0x05:	/* FPREM1 */
-				gen_call_function_raw((void*)&FPU_FPREM1);
+				gen_call_function_keep_regs((void*)&FPU_FPREM1);
 				break;
 			case 0x06:	/* FDECSTP */
-				gen_call_function_raw((void*)&FPU_FDECSTP);
+				gen_call_function_keep_regs((void*)&FPU_FDECSTP);
 				break;
 			case 0x07:	/* FINCSTP */
-				gen_call_function_raw((void*)&FPU_FINCSTP);
+				gen_call_function_keep_regs((void*)&FPU_FINCSTP);
 				break;
 			default:
 				LOG(LOG_FPU,LOG_WARN)("ESC 1:Unhandled group %X subfunction %X",static_cast<uint32_t>(decode.modrm.reg),static_cast<uint32_t>(decode.modrm.rm));
@@ -256,28 +344,28 @@ static void dyn_fpu_esc1(){
 		case 0x07:
 			switch(decode.modrm.rm){
 			case 0x00:		/* FPREM */
-				gen_call_function_raw((void*)&FPU_FPREM);
+				gen_call_function_keep_regs((void*)&FPU_FPREM);
 				break;
 			case 0x01:		/* FYL2XP1 */
-				gen_call_function_raw((void*)&FPU_FYL2XP1);
+				gen_call_function_keep_regs((void*)&FPU_FYL2XP1);
 				break;
 			case 0x02:		/* FSQRT */
-				gen_call_function_raw((void*)&FPU_FSQRT);
+				gen_call_function_keep_regs((void*)&FPU_FSQRT);
 				break;
 			case 0x03:		/* FSINCOS */
-				gen_call_function_raw((void*)&FPU_FSINCOS);
+				gen_call_function_keep_regs((void*)&FPU_FSINCOS);
 				break;
 			case 0x04:		/* FRNDINT */
-				gen_call_function_raw((void*)&FPU_FRNDINT);
+				gen_call_function_keep_regs((void*)&FPU_FRNDINT);
 				break;
 			case 0x05:		/* FSCALE */
-				gen_call_function_raw((void*)&FPU_FSCALE);
+				gen_call_function_keep_regs((void*)&FPU_FSCALE);
 				break;
 			case 0x06:		/* FSIN */
-				gen_call_function_raw((void*)&FPU_FSIN);
+				gen_call_function_keep_regs((void*)&FPU_FSIN);
 				break;
 			case 0x07:		/* FCOS */
-				gen_call_function_raw((void*)&FPU_FCOS);
+				gen_call_function_keep_regs((void*)&FPU_FCOS);
 				break;
 			default:
 				LOG(LOG_FPU,LOG_WARN)("ESC 1:Unhandled group %X subfunction %X",static_cast<uint32_t>(decode.modrm.reg),static_cast<uint32_t>(decode.modrm.rm));
@@ -291,9 +379,9 @@ static void dyn_fpu_esc1(){
 	} else {
 		switch(decode.modrm.reg){
 		case 0x00: /* FLD float*/
-			gen_call_function_raw((void*)&FPU_PREP_PUSH);
+			gen_call_function_keep_regs((void*)&FPU_PREP_PUSH);
 			dyn_fill_ea(FC_OP1);
-			gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+			dyn_fpu_load_top(FC_OP2);
 			gen_call_function_RR((void*)&FPU_FLD_F32,FC_OP1,FC_OP2);
 			break;
 		case 0x01: /* UNKNOWN */
@@ -306,7 +394,7 @@ static void dyn_fpu_esc1(){
 		case 0x03: /* FSTP float*/
 			dyn_fill_ea(FC_ADDR);
 			gen_call_function_R((void*)&FPU_FST_F32,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x04: /* FLDENV */
 			dyn_fill_ea(FC_ADDR);
@@ -339,13 +427,13 @@ static void dyn_fpu_esc2(){
 		case 0x05:
 			switch(decode.modrm.rm){
 			case 0x01:		/* FUCOMPP */
-				gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+				dyn_fpu_load_top(FC_OP2);
 				gen_add_imm(FC_OP2,1);
 				gen_and_imm(FC_OP2,7);
-				gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+				dyn_fpu_load_top(FC_OP1);
 				gen_call_function_RR((void *)&FPU_FUCOM,FC_OP1,FC_OP2);
-				gen_call_function_raw((void *)&FPU_FPOP);
-				gen_call_function_raw((void *)&FPU_FPOP);
+				dyn_fpu_pop();
+				dyn_fpu_pop();
 				break;
 			default:
 				LOG(LOG_FPU,LOG_WARN)("ESC 2:Unhandled group %X subfunction %X",static_cast<uint32_t>(decode.modrm.reg),static_cast<uint32_t>(decode.modrm.rm));
@@ -359,7 +447,7 @@ static void dyn_fpu_esc2(){
 	} else {
 		dyn_fill_ea(FC_ADDR);
 		gen_call_function_R((void*)&FPU_FLD_I32_EA,FC_ADDR); 
-		gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+		dyn_fpu_load_top(FC_OP1);
 		dyn_eatree();
 	}
 }
@@ -378,10 +466,10 @@ static void dyn_fpu_esc3()
 				                        decode.modrm.rm);
 				break;
 			case 0x02:				//FNCLEX FCLEX
-				gen_call_function_raw((void*)&FPU_FCLEX);
+				gen_call_function_keep_regs((void*)&FPU_FCLEX);
 				break;
 			case 0x03:				//FNINIT FINIT
-				gen_call_function_raw((void*)&FPU_FINIT);
+				gen_call_function_keep_regs((void*)&FPU_FINIT);
 				break;
 			case 0x04:				//FNSETPM
 			case 0x05:				//FRSTPM
@@ -399,9 +487,9 @@ static void dyn_fpu_esc3()
 	} else {
 		switch(decode.modrm.reg){
 		case 0x00:	/* FILD */
-			gen_call_function_raw((void*)&FPU_PREP_PUSH);
+			gen_call_function_keep_regs((void*)&FPU_PREP_PUSH);
 			dyn_fill_ea(FC_OP1); 
-			gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+			dyn_fpu_load_top(FC_OP2);
 			gen_call_function_RR((void*)&FPU_FLD_I32,FC_OP1,FC_OP2);
 			break;
 		case 0x01:	/* FISTTP */
@@ -414,17 +502,17 @@ static void dyn_fpu_esc3()
 		case 0x03:	/* FISTP */
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FST_I32,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x05:	/* FLD 80 Bits Real */
-			gen_call_function_raw((void*)&FPU_PREP_PUSH);
+			gen_call_function_keep_regs((void*)&FPU_PREP_PUSH);
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FLD_F80,FC_ADDR);
 			break;
 		case 0x07:	/* FSTP 80 Bits Real */
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FST_F80,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		default:
 			FPU_LOG_WARN(3, true, decode.modrm.reg, decode.modrm.rm);
@@ -439,11 +527,11 @@ static void dyn_fpu_esc4(){
 		switch(decode.modrm.reg){
 		case 0x00:	/* FADD STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FADD,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_ADD);
 			break;
 		case 0x01:	/* FMUL STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FMUL,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_MUL);
 			break;
 		case 0x02:  /* FCOM*/
 			dyn_fpu_top();
@@ -452,23 +540,23 @@ static void dyn_fpu_esc4(){
 		case 0x03:  /* FCOMP*/
 			dyn_fpu_top();
 			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x04:  /* FSUBR STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUBR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_SUBR);
 			break;
 		case 0x05:  /* FSUB  STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUB,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_SUB);
 			break;
 		case 0x06:  /* FDIVR STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIVR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_DIVR);
 			break;
 		case 0x07:  /* FDIV STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIV,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_DIV);
 			break;
 		default:
 			break;
@@ -476,7 +564,7 @@ static void dyn_fpu_esc4(){
 	} else { 
 		dyn_fill_ea(FC_ADDR);
 		gen_call_function_R((void*)&FPU_FLD_F64_EA,FC_ADDR); 
-		gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+		dyn_fpu_load_top(FC_OP1);
 		dyn_eatree();
 	}
 }
@@ -491,21 +579,21 @@ static void dyn_fpu_esc5(){
 			gen_call_function_R((void*)&FPU_FFREE,FC_OP2);
 			break;
 		case 0x01: /* FXCH STi*/
-			gen_call_function_RR((void*)&FPU_FXCH,FC_OP1,FC_OP2);
+			dyn_fpu_fxch();
 			break;
 		case 0x02: /* FST STi */
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+			dyn_fpu_fst();
 			break;
 		case 0x03:  /* FSTP STi*/
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_fst();
+			dyn_fpu_pop();
 			break;
 		case 0x04:	/* FUCOM STi */
 			gen_call_function_RR((void*)&FPU_FUCOM,FC_OP1,FC_OP2);
 			break;
 		case 0x05:	/*FUCOMP STi */
 			gen_call_function_RR((void*)&FPU_FUCOM,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		default:
 			LOG(LOG_FPU,LOG_WARN)("ESC 5:Unhandled group %X subfunction %X",static_cast<uint32_t>(decode.modrm.reg),static_cast<uint32_t>(decode.modrm.rm));
@@ -514,9 +602,9 @@ static void dyn_fpu_esc5(){
 	} else {
 		switch(decode.modrm.reg){
 		case 0x00:  /* FLD double real*/
-			gen_call_function_raw((void*)&FPU_PREP_PUSH);
+			gen_call_function_keep_regs((void*)&FPU_PREP_PUSH);
 			dyn_fill_ea(FC_OP1); 
-			gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+			dyn_fpu_load_top(FC_OP2);
 			gen_call_function_RR((void*)&FPU_FLD_F64,FC_OP1,FC_OP2);
 			break;
 		case 0x01:  /* FISTTP longint*/
@@ -529,7 +617,7 @@ static void dyn_fpu_esc5(){
 		case 0x03:	/* FSTP double real*/
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FST_F64,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x04:	/* FRSTOR */
 			dyn_fill_ea(FC_ADDR); 
@@ -540,7 +628,7 @@ static void dyn_fpu_esc5(){
 			gen_call_function_R((void*)&FPU_FSAVE,FC_ADDR);
 			break;
 		case 0x07:   /*FNSTSW */
-			gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+			dyn_fpu_load_top(FC_OP1);
 			gen_call_function_R((void*)&FPU_SET_TOP,FC_OP1);
 			dyn_fill_ea(FC_OP1); 
 			gen_mov_word_to_reg(FC_OP2,(void*)(&fpu.sw),false);
@@ -559,11 +647,11 @@ static void dyn_fpu_esc6(){
 		switch(decode.modrm.reg){
 		case 0x00:	/*FADDP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FADD,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_ADD);
 			break;
 		case 0x01:	/* FMULP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FMUL,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_MUL);
 			break;
 		case 0x02:  /* FCOMP5*/
 			dyn_fpu_top();
@@ -574,37 +662,37 @@ static void dyn_fpu_esc6(){
 				LOG(LOG_FPU,LOG_WARN)("ESC 6:Unhandled group %X subfunction %X",static_cast<uint32_t>(decode.modrm.reg),static_cast<uint32_t>(decode.modrm.rm));
 				return;
 			}
-			gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+			dyn_fpu_load_top(FC_OP2);
 			gen_add_imm(FC_OP2,1);
 			gen_and_imm(FC_OP2,7);
-			gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+			dyn_fpu_load_top(FC_OP1);
 			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP); /* extra pop at the bottom*/
+			dyn_fpu_pop(); /* extra pop at the bottom*/
 			break;
 		case 0x04:  /* FSUBRP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUBR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_SUBR);
 			break;
 		case 0x05:  /* FSUBP  STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUB,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_SUB);
 			break;
 		case 0x06:	/* FDIVRP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIVR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_DIVR);
 			break;
 		case 0x07:  /* FDIVP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIV,FC_OP1,FC_OP2);
+			dyn_fpu_arith(DRC_FPU_DIV);
 			break;
 		default:
 			break;
 		}
-		gen_call_function_raw((void*)&FPU_FPOP);		
+		dyn_fpu_pop();		
 	} else {
 		dyn_fill_ea(FC_ADDR);
 		gen_call_function_R((void*)&FPU_FLD_I16_EA,FC_ADDR); 
-		gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+		dyn_fpu_load_top(FC_OP1);
 		dyn_eatree();
 	}
 }
@@ -617,22 +705,22 @@ static void dyn_fpu_esc7(){
 		case 0x00: /* FFREEP STi */
 			dyn_fpu_top();
 			gen_call_function_R((void*)&FPU_FFREE,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x01: /* FXCH STi*/
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FXCH,FC_OP1,FC_OP2);
+			dyn_fpu_fxch();
 			break;
 		case 0x02:  /* FSTP STi*/
 		case 0x03:  /* FSTP STi*/
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_fst();
+			dyn_fpu_pop();
 			break;
 		case 0x04:
 			switch(decode.modrm.rm){
 				case 0x00:     /* FNSTSW AX*/
-					gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+					dyn_fpu_load_top(FC_OP1);
 					gen_call_function_R((void*)&FPU_SET_TOP,FC_OP1); 
 					gen_mov_word_to_reg(FC_OP1,(void*)(&fpu.sw),false);
 					MOV_REG_WORD16_FROM_HOST_REG(FC_OP1,DRC_REG_EAX);
@@ -649,9 +737,9 @@ static void dyn_fpu_esc7(){
 	} else {
 		switch(decode.modrm.reg){
 		case 0x00:  /* FILD int16_t */
-			gen_call_function_raw((void*)&FPU_PREP_PUSH);
+			gen_call_function_keep_regs((void*)&FPU_PREP_PUSH);
 			dyn_fill_ea(FC_OP1); 
-			gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+			dyn_fpu_load_top(FC_OP2);
 			gen_call_function_RR((void*)&FPU_FLD_I16,FC_OP1,FC_OP2);
 			break;
 		case 0x01:
@@ -664,29 +752,29 @@ static void dyn_fpu_esc7(){
 		case 0x03:	/* FISTP int16_t */
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FST_I16,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x04:   /* FBLD packed BCD */
-			gen_call_function_raw((void*)&FPU_PREP_PUSH);
+			gen_call_function_keep_regs((void*)&FPU_PREP_PUSH);
 			dyn_fill_ea(FC_OP1);
-			gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+			dyn_fpu_load_top(FC_OP2);
 			gen_call_function_RR((void*)&FPU_FBLD,FC_OP1,FC_OP2);
 			break;
 		case 0x05:  /* FILD int64_t */
-			gen_call_function_raw((void*)&FPU_PREP_PUSH);
+			gen_call_function_keep_regs((void*)&FPU_PREP_PUSH);
 			dyn_fill_ea(FC_OP1);
-			gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+			dyn_fpu_load_top(FC_OP2);
 			gen_call_function_RR((void*)&FPU_FLD_I64,FC_OP1,FC_OP2);
 			break;
 		case 0x06:	/* FBSTP packed BCD */
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FBST,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x07:  /* FISTP int64_t */
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FST_I64,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		default:
 			LOG(LOG_FPU,LOG_WARN)("ESC 7 EA:Unhandled group %X subfunction %X",static_cast<uint32_t>(decode.modrm.reg),static_cast<uint32_t>(decode.modrm.rm));
@@ -38,6 +38,14 @@
 // use FC_SEGS_ADDR to hold the address of "Segs" and to access it using FC_SEGS_ADDR
 #define DRC_USE_SEGS_ADDR
 
+// access guest memory through an inline TLB lookup, see gen_mem_access_inline
+#if defined(USE_FULL_TLB)
+#define DRC_USE_INLINE_TLB
+#endif
+
+// keep guest registers in callee-saved host registers within a block
+#define DRC_USE_REG_CACHE
+
 // register mapping
 typedef uint8_t HostReg;
 
@@ -189,6 +197,9 @@ typedef uint8_t HostReg;
 // used to hold the address of "core_dynrec.readdata" - filled in function gen_run_code
 #define readdata_addr HOST_r22
 
+// first of the four callee-saved registers that cache guest registers
+#define REGCACHE_FIRST HOST_r23
+
 
 // instruction encodings
 
@@ -223,6 +234,8 @@ typedef uint8_t HostReg;
 // arithmetic
 // add dst, src, #(imm lsl simm)		@	0 <= imm <= 4095	&	simm = 0/12
 #define ADD_IMM(dst, src, imm, simm) (0x11000000 + (dst) + ((src) << 5) + ((imm) << 10) + ((simm)?0x00400000:0) )
+// add dst, src, #imm		@	0 <= imm <= 4095
+#define ADD64_IMM(dst, src, imm) (0x91000000 + (dst) + ((src) << 5) + ((imm) << 10) )
 // add dst, src1, src2, lsl #imm
 #define ADD_REG_LSL_IMM(dst, src1, src2, imm) (0x0b000000 + (dst) + ((src1) << 5) + ((src2) << 16) + ((imm) << 10) )
 // sub dst, src, #(imm lsl simm)		@	0 <= imm <= 4095	&	simm = 0/12
@@ -261,6 +274,12 @@ typedef uint8_t HostReg;
 #define LDRB_IMM(reg, addr, imm) (0x39400000 + (reg) + ((addr) << 5) + ((imm) << 10) )
 // ldr reg, [addr1, addr2, lsl #imm]		@	imm = 0/2
 #define LDR64_REG_LSL_IMM(reg, addr1, addr2, imm) (0xf8606800 + (reg) + ((addr1) << 5) + ((addr2) << 16) + ((imm)?0x00001000:0) )
+// ldr reg, [addr1, addr2, uxtw]
+#define LDR_REG_UXTW(reg, addr1, addr2) (0xb8604800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
+// ldrh reg, [addr1, addr2, uxtw]
+#define LDRH_REG_UXTW(reg, addr1, addr2) (0x78604800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
+// ldrb reg, [addr1, addr2, uxtw]
+#define LDRB_REG_UXTW(reg, addr1, addr2) (0x38604800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
 // ldur reg, [addr, #imm]		@	-256 <= imm < 256
 #define LDUR64_IMM(reg, addr, imm) (0xf8400000 + (reg) + ((addr) << 5) + (((imm) << 12) & 0x001ff000) )
 // ldur reg, [addr, #imm]		@	-256 <= imm < 256
@@ -281,6 +300,12 @@ typedef uint8_t HostReg;
 #define STRH_IMM(reg, addr, imm) (0x79000000 + (reg) + ((addr) << 5) + ((imm) << 9) )
 // strb reg, [addr, #imm]		@	0 <= imm < 4096
 #define STRB_IMM(reg, addr, imm) (0x39000000 + (reg) + ((addr) << 5) + ((imm) << 10) )
+// str reg, [addr1, addr2, uxtw]
+#define STR_REG_UXTW(reg, addr1, addr2) (0xb8204800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
+// strh reg, [addr1, addr2, uxtw]
+#define STRH_REG_UXTW(reg, addr1, addr2) (0x78204800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
+// strb reg, [addr1, addr2, uxtw]
+#define STRB_REG_UXTW(reg, addr1, addr2) (0x38204800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
 // stur reg, [addr, #imm]		@	-256 <= imm < 256
 #define STUR64_IMM(reg, addr, imm) (0xf8000000 + (reg) + ((addr) << 5) + (((imm) << 12) & 0x001ff000) )
 // stur reg, [addr, #imm]		@	-256 <= imm < 256
@@ -293,6 +318,8 @@ typedef uint8_t HostReg;
 // branch
 // bgt pc+imm		@	0 <= imm < 1M	&	imm mod 4 = 0
 #define BGT_FWD(imm) (0x5400000c + ((imm) << 3) )
+// bhs pc+imm		@	0 <= imm < 1M	&	imm mod 4 = 0
+#define BHS_FWD(imm) (0x54000002 + ((imm) << 3) )
 // b pc+imm		@	0 <= imm < 128M	&	imm mod 4 = 0
 #define B_FWD(imm) (0x14000000 + ((imm) >> 2) )
 // br reg
@@ -301,6 +328,8 @@ typedef uint8_t HostReg;
 #define BLR_REG(reg) (0xd63f0000 + ((reg) << 5) )
 // cbz reg, pc+imm		@	0 <= imm < 1M	&	imm mod 4 = 0
 #define CBZ_FWD(reg, imm) (0x34000000 + (reg) + ((imm) << 3) )
+// cbz reg, pc+imm (64-bit register)		@	0 <= imm < 1M	&	imm mod 4 = 0
+#define CBZ64_FWD(reg, imm) (0xb4000000 + (reg) + ((imm) << 3) )
 // cbnz reg, pc+imm		@	0 <= imm < 1M	&	imm mod 4 = 0
 #define CBNZ_FWD(reg, imm) (0x35000000 + (reg) + ((imm) << 3) )
 // ret reg
@@ -750,8 +779,44 @@ static inline void gen_lea(HostReg dest_reg,Bitu scale,Bits imm) {
 	gen_add_imm(dest_reg, imm);
 }
 
+#ifdef DRC_USE_REG_CACHE
+// The guest general purpose registers are cached in w23-w26. The cache is
+// write-through: every write still goes to cpu_regs, so nothing has to be
+// spilled when the block is left or an exception is raised. The cached
+// values are forgotten at the block start, at join points (gen_fill_branch)
+// and around calls to functions that may modify the guest registers.
+static struct {
+	int8_t guest_reg[4];	// guest register held by REGCACHE_FIRST+i, -1 if free
+	uint8_t next;			// slot to hand out next (round-robin)
+} regcache;
+
+static void gen_regcache_reset(void) {
+	for (auto &reg : regcache.guest_reg) reg = -1;
+	regcache.next = 0;
+}
+
+// returns the host register caching the guest register, or -1 if there is none
+static int regcache_find(Bitu reg_index) {
+	for (int i=0;i<4;i++) {
+		if (regcache.guest_reg[i]==(int8_t)reg_index) return REGCACHE_FIRST+i;
+	}
+	return -1;
+}
+
+static HostReg regcache_alloc(Bitu reg_index) {
+	const int slot=regcache.next;
+	regcache.next=(regcache.next+1)&3;
+	regcache.guest_reg[slot]=(int8_t)reg_index;
+	return (HostReg)(REGCACHE_FIRST+slot);
+}
+#endif
+
 // generate a call to a parameterless function
 static void inline gen_call_function_raw(void * func) {
+#ifdef DRC_USE_REG_CACHE
+	// the callee may modify the guest registers through cpu_regs
+	gen_regcache_reset();
+#endif
 	cache_addd( MOVZ64(temp1, ((uint64_t)func) & 0xffff, 0) );            // movz dest_reg, #(func & 0xffff)
 	cache_addd( MOVK64(temp1, (((uint64_t)func) >> 16) & 0xffff, 16) );   // movk dest_reg, #((func >> 16) & 0xffff), lsl #16
 	cache_addd( MOVK64(temp1, (((uint64_t)func) >> 32) & 0xffff, 32) );   // movk dest_reg, #((func >> 32) & 0xffff), lsl #32
@@ -832,7 +897,9 @@ static const uint8_t* gen_create_branch_on_nonzero(HostReg reg,bool dword) {
 }
 
 // calculate relative offset and fill it into the location pointed to by data
-static void inline gen_fill_branch(const uint8_t* data) {
+// keeps the register cache, for branches whose destination is only reached
+// with the same registers cached as at the branch
+static void inline gen_fill_branch_keep_regs(const uint8_t* data) {
 #if C_DEBUG
 	Bits len=cache.pos-data;
 	if (len<0) len=-len;
@@ -843,6 +910,15 @@ static void inline gen_fill_branch(const uint8_t* data) {
 	cache_addb((uint8_t)(offset>>16),data+2);
 }
 
+// calculate relative offset and fill it into the location pointed to by data
+static void inline gen_fill_branch(const uint8_t* data) {
+	gen_fill_branch_keep_regs(data);
+#ifdef DRC_USE_REG_CACHE
+	// two paths join here that may have cached different registers
+	gen_regcache_reset();
+#endif
+}
+
 // conditional jump if register is nonzero
 // for isdword==true the 32bit of the register are tested
 // for isdword==false the lowest 8bit of the register are tested
@@ -866,19 +942,68 @@ static const uint8_t* gen_create_branch_long_leqzero(HostReg reg) {
 }
 
 // calculate long relative offset and fill it into the location pointed to by data
+// unlike gen_fill_branch this keeps the register cache, long branches either
+// leave the block or skip a slow path that leaves the cached registers intact
 static void inline gen_fill_branch_long(const uint8_t* data) {
 	// optimize for shorter branches ?
 	uint32_t offset = (uint32_t)(cache.pos-data) >> 2;
 	cache_addd(((data[3]<<24)&~0x03ffffff)|(offset&0x03ffffff),data);
 }
 
+#ifdef DRC_USE_INLINE_TLB
+// access size bytes of guest memory at the linear address held in FC_OP1
+// directly through paging.tlb, reading into reg (zero-extended) or writing
+// the value of reg. TLB misses, handler pages and accesses that cross a page
+// continue with the code emitted next (the call to the checked helper);
+// returns the branch that skips it, to be filled in with gen_fill_branch_long()
+static const uint8_t* gen_mem_access_inline(HostReg reg,Bitu size,bool write) {
+	const uint8_t* miss[2];
+	Bitu misses=0;
+
+	if (size>1) {
+		cache_addd( UBFM(temp1, FC_OP1, 0, 11) );               // ubfx temp1, FC_OP1, #0, #12
+		cache_addd( CMP_IMM(temp1, 0x1000-size+1, 0) );         // cmp temp1, #(0x1000-size+1)
+		cache_addd( BHS_FWD(0) );                               // bhs miss
+		miss[misses++]=cache.pos-4;
+	}
+	cache_addd( UBFM(temp1, FC_OP1, 12, 31) );                  // lsr temp1, FC_OP1, #12
+	gen_mov_qword_to_reg_imm(temp2, (uint64_t)(write ? paging.tlb.write : paging.tlb.read));
+	cache_addd( LDR64_REG_LSL_IMM(temp1, temp2, temp1, 1) );    // ldr temp1, [temp2, temp1, lsl #3]
+	cache_addd( CBZ64_FWD(temp1, 0) );                          // cbz temp1, miss
+	miss[misses++]=cache.pos-4;
+
+	switch (size) {
+		case 1: cache_addd( write ? STRB_REG_UXTW(reg, temp1, FC_OP1) : LDRB_REG_UXTW(reg, temp1, FC_OP1) ); break;
+		case 2: cache_addd( write ? STRH_REG_UXTW(reg, temp1, FC_OP1) : LDRH_REG_UXTW(reg, temp1, FC_OP1) ); break;
+		default: cache_addd( write ? STR_REG_UXTW(reg, temp1, FC_OP1) : LDR_REG_UXTW(reg, temp1, FC_OP1) ); break;
+	}
+
+#if DYNREC_MEMORY_STATS
+	// dynrec_stats.tlb_inline_hits++
+	gen_mov_qword_to_reg_imm(temp2, (uint64_t)&dynrec_stats.tlb_inline_hits);
+	cache_addd( LDR64_IMM(temp3, temp2, 0) );                   // ldr temp3, [temp2]
+	cache_addd( ADD64_IMM(temp3, temp3, 1) );                   // add temp3, temp3, #1
+	cache_addd( STR64_IMM(temp3, temp2, 0) );                   // str temp3, [temp2]
+#endif
+
+	cache_addd( B_FWD(0) );                                     // b over the slow path
+	const uint8_t* done=cache.pos-4;
+	// nothing above touches the cached registers, so the slow path can
+	// keep using them
+	for (Bitu i=0;i<misses;i++) gen_fill_branch_keep_regs(miss[i]);
+	return done;
+}
+#endif
+
 static void gen_run_code(void) {
 	const uint8_t *pos1, *pos2, *pos3;
 
-	cache_addd( 0xa9bd7bfd );                                           // stp fp, lr, [sp, #-48]!
+	cache_addd( 0xa9bb7bfd );                                           // stp fp, lr, [sp, #-80]!
 	cache_addd( 0x910003fd );                                           // mov fp, sp
 	cache_addd( STP64_IMM(FC_ADDR, FC_REGS_ADDR, HOST_sp, 16) );        // stp FC_ADDR, FC_REGS_ADDR, [sp, #16]
 	cache_addd( STP64_IMM(FC_SEGS_ADDR, readdata_addr, HOST_sp, 32) );  // stp FC_SEGS_ADDR, readdata_addr, [sp, #32]
+	cache_addd( STP64_IMM(HOST_x23, HOST_x24, HOST_sp, 48) );           // stp x23, x24, [sp, #48]
+	cache_addd( STP64_IMM(HOST_x25, HOST_x26, HOST_sp, 64) );           // stp x25, x26, [sp, #64]
 
 	pos1 = cache.pos;
 	cache_addd( 0 );
@@ -913,7 +1038,9 @@ static void gen_run_code(void) {
 static void gen_return_function(void) {
 	cache_addd( LDP64_IMM(FC_ADDR, FC_REGS_ADDR, HOST_sp, 16) );        // ldp FC_ADDR, FC_REGS_ADDR, [sp, #16]
 	cache_addd( LDP64_IMM(FC_SEGS_ADDR, readdata_addr, HOST_sp, 32) );  // ldp FC_SEGS_ADDR, readdata_addr, [sp, #32]
-	cache_addd( 0xa8c37bfd );                                           // ldp fp, lr, [sp], #48
+	cache_addd( LDP64_IMM(HOST_x23, HOST_x24, HOST_sp, 48) );           // ldp x23, x24, [sp, #48]
+	cache_addd( LDP64_IMM(HOST_x25, HOST_x26, HOST_sp, 64) );           // ldp x25, x26, [sp, #64]
+	cache_addd( 0xa8c57bfd );                                           // ldp fp, lr, [sp], #80
 	cache_addd( RET );                                                  // ret
 }
 
@@ -1231,3 +1358,60 @@ static void gen_mov_regbyte_from_reg_low(HostReg src_reg,Bitu index) {
 }
 
 #endif
+
+#ifdef DRC_USE_REG_CACHE
+
+#define REGCACHE_OFFSET(ptr) ((Bitu)(ptr) - (Bitu)(&cpu_regs))
+
+// move a 32bit (dword==true) or 16bit (dword==false) guest register into
+// dest_reg, 16bit values are zero-extended
+static void gen_mov_regcache_to_reg(HostReg dest_reg,Bitu reg_index,bool dword) {
+	const int cached=regcache_find(reg_index);
+	if (cached>=0) {
+		if (dword) gen_mov_regs(dest_reg,(HostReg)cached);
+		else cache_addd( UXTH(dest_reg, cached) );      // uxth dest_reg, cached
+		return;
+	}
+	gen_mov_regword_to_reg(dest_reg,REGCACHE_OFFSET(DRCD_REG_WORD(reg_index,dword)),dword);
+	if (dword) gen_mov_regs(regcache_alloc(reg_index),dest_reg);
+}
+
+// move 32bit (dword==true) or 16bit (dword==false) of src_reg into a guest register
+static void gen_mov_regcache_from_reg(HostReg src_reg,Bitu reg_index,bool dword) {
+	gen_mov_regword_from_reg(src_reg,REGCACHE_OFFSET(DRCD_REG_WORD(reg_index,dword)),dword);
+	const int cached=regcache_find(reg_index);
+	if (dword) gen_mov_regs((cached>=0)?(HostReg)cached:regcache_alloc(reg_index),src_reg);
+	else if (cached>=0) cache_addd( BFI(cached, src_reg, 0, 16) );      // bfi cached, src_reg, #0, #16
+}
+
+// move an 8bit guest register into dest_reg, zero-extended
+static void gen_mov_regcache_byte_to_reg_low(HostReg dest_reg,Bitu reg_index,bool high_byte) {
+	const int cached=regcache_find(reg_index);
+	if (cached>=0) {
+		if (high_byte) cache_addd( UBFM(dest_reg, cached, 8, 15) );      // ubfx dest_reg, cached, #8, #8
+		else cache_addd( UXTB(dest_reg, cached) );      // uxtb dest_reg, cached
+		return;
+	}
+	gen_mov_regbyte_to_reg_low(dest_reg,REGCACHE_OFFSET(DRCD_REG_BYTE(reg_index,high_byte)));
+}
+
+// same as above, all registers are byte-accessible
+static void gen_mov_regcache_byte_to_reg_low_canuseword(HostReg dest_reg,Bitu reg_index,bool high_byte) {
+	gen_mov_regcache_byte_to_reg_low(dest_reg,reg_index,high_byte);
+}
+
+// move the lowest 8bit of src_reg into an 8bit guest register
+static void gen_mov_regcache_byte_from_reg_low(HostReg src_reg,Bitu reg_index,bool high_byte) {
+	gen_mov_regbyte_from_reg_low(src_reg,REGCACHE_OFFSET(DRCD_REG_BYTE(reg_index,high_byte)));
+	const int cached=regcache_find(reg_index);
+	if (cached>=0) cache_addd( BFI(cached, src_reg, high_byte?8:0, 8) );      // bfi cached, src_reg, #(0/8), #8
+}
+
+// add a 32bit guest register to reg
+static void gen_add_regcache_to_reg(HostReg reg,Bitu reg_index) {
+	const int cached=regcache_find(reg_index);
+	if (cached>=0) cache_addd( ADD_REG_LSL_IMM(reg, reg, cached, 0) );      // add reg, reg, cached
+	else gen_add_regval32_to_reg(reg,REGCACHE_OFFSET(DRCD_REG_VAL(reg_index)));
+}
+
+#endif
@@ -29,6 +29,14 @@
 // try to replace _simple functions by code
 #define DRC_FLAGS_INVALIDATION_DCODE
 
+// access guest memory through an inline TLB lookup, see gen_mem_access_inline
+#if defined(USE_FULL_TLB)
+#define DRC_USE_INLINE_TLB
+#endif
+
+// keep guest registers in callee-saved host registers within a block
+#define DRC_USE_REG_CACHE
+
 // calling convention modifier
 #define DRC_CALL_CONV	/* nothing */
 #define DRC_FC			/* nothing */
@@ -370,8 +378,112 @@ static inline void gen_lea(HostReg dest_reg,Bitu scale,Bits imm) {
 
 
 
+#ifdef DRC_USE_REG_CACHE
+// The guest general purpose registers are cached in r12-r15, which are
+// preserved across calls by both the SysV and the Win64 ABI. The cache is
+// write-through: every write still goes to cpu_regs, so nothing has to be
+// spilled when the block is left or an exception is raised. Only the code
+// that runs between two resets can use the cached values, a reset happens
+// at the block start, at join points (gen_fill_branch) and around calls
+// to functions that may modify the guest registers.
+static struct {
+	int8_t guest_reg[4];	// guest register held by r12+i, -1 if free
+	uint8_t next;			// slot to hand out next (round-robin)
+} regcache;
+
+static void gen_regcache_reset(void) {
+	for (auto &reg : regcache.guest_reg) reg = -1;
+	regcache.next = 0;
+}
+
+// returns the slot holding the guest register, or -1 if it isn't cached
+static int regcache_find(Bitu reg_index) {
+	for (int i=0;i<4;i++) {
+		if (regcache.guest_reg[i]==(int8_t)reg_index) return i;
+	}
+	return -1;
+}
+
+static int regcache_alloc(Bitu reg_index) {
+	const int slot=regcache.next;
+	regcache.next=(regcache.next+1)&3;
+	regcache.guest_reg[slot]=(int8_t)reg_index;
+	return slot;
+}
+
+// emit op with reg as the register operand and r12+slot as the r/m operand
+static void regcache_op(uint8_t prefix,uint16_t op,HostReg reg,int slot) {
+	if (prefix) cache_addb(prefix);
+	cache_addb(0x41);					// REX.B, selects r12-r15
+	if (op>0xff) cache_addw(op);
+	else cache_addb((uint8_t)op);
+	cache_addb(0xc4+(reg<<3)+slot);
+}
+
+// move a 32bit (dword==true) or 16bit (dword==false) guest register into
+// dest_reg, 16bit values are zero-extended
+static void gen_mov_regcache_to_reg(HostReg dest_reg,Bitu reg_index,bool dword) {
+	const int slot=regcache_find(reg_index);
+	if (slot>=0) {
+		if (dword) regcache_op(0,0x8b,dest_reg,slot);		// mov dest_reg,r12d+slot
+		else regcache_op(0,0xb70f,dest_reg,slot);		// movzx dest_reg,r12w+slot
+		return;
+	}
+	gen_mov_word_to_reg(dest_reg,DRCD_REG_WORD(reg_index,dword),dword);
+	if (dword) regcache_op(0,0x89,dest_reg,regcache_alloc(reg_index));	// mov r12d+slot,dest_reg
+}
+
+// move 32bit (dword==true) or 16bit (dword==false) of src_reg into a guest register
+static void gen_mov_regcache_from_reg(HostReg src_reg,Bitu reg_index,bool dword) {
+	gen_mov_word_from_reg(src_reg,DRCD_REG_WORD(reg_index,dword),dword);
+	int slot=regcache_find(reg_index);
+	if (dword) {
+		if (slot<0) slot=regcache_alloc(reg_index);
+		regcache_op(0,0x89,src_reg,slot);		// mov r12d+slot,src_reg
+	} else if (slot>=0) {
+		regcache_op(0x66,0x89,src_reg,slot);	// mov r12w+slot,src_reg
+	}
+}
+
+// move an 8bit guest register into dest_reg, zero-extended
+static void gen_mov_regcache_byte_to_reg_low(HostReg dest_reg,Bitu reg_index,bool high_byte) {
+	const int slot=regcache_find(reg_index);
+	if (slot>=0 && !high_byte) {
+		regcache_op(0,0xb60f,dest_reg,slot);		// movzx dest_reg,r12b+slot
+		return;
+	}
+	gen_mov_byte_to_reg_low(dest_reg,DRCD_REG_BYTE(reg_index,high_byte));
+}
+
+// same as above, all registers are byte-accessible through a REX prefix
+static void gen_mov_regcache_byte_to_reg_low_canuseword(HostReg dest_reg,Bitu reg_index,bool high_byte) {
+	gen_mov_regcache_byte_to_reg_low(dest_reg,reg_index,high_byte);
+}
+
+// move the lowest 8bit of src_reg into an 8bit guest register
+static void gen_mov_regcache_byte_from_reg_low(HostReg src_reg,Bitu reg_index,bool high_byte) {
+	gen_mov_byte_from_reg_low(src_reg,DRCD_REG_BYTE(reg_index,high_byte));
+	const int slot=regcache_find(reg_index);
+	if (slot<0) return;
+	// the REX prefix makes registers 4-7 select spl-dil rather than ah-bh
+	if (!high_byte) regcache_op(0,0x88,src_reg,slot);	// mov r12b+slot,src_reg
+	else regcache.guest_reg[slot]=-1;
+}
+
+// add a 32bit guest register to reg
+static void gen_add_regcache_to_reg(HostReg reg,Bitu reg_index) {
+	const int slot=regcache_find(reg_index);
+	if (slot>=0) regcache_op(0,0x03,reg,slot);	// add reg,r12d+slot
+	else gen_add(reg,DRCD_REG_VAL(reg_index));
+}
+#endif
+
 // generate a call to a parameterless function
 static void inline gen_call_function_raw(void * func) {
+#ifdef DRC_USE_REG_CACHE
+	// the callee may modify the guest registers through cpu_regs
+	gen_regcache_reset();
+#endif
 	cache_addw(0xb848);
 	cache_addq((uint64_t)func);
 	cache_addw(0xd0ff);
@@ -568,6 +680,10 @@ static void gen_fill_branch(const uint8_t* data) {
 		LOG_MSG("Big jump %" PRIdPTR, len);
 #endif
 	cache_addb((uint8_t)(cache.pos-data-1),data);
+#ifdef DRC_USE_REG_CACHE
+	// two paths join here that may have cached different registers
+	gen_regcache_reset();
+#endif
 }
 
 // conditional jump if register is nonzero
@@ -595,17 +711,194 @@ static const uint8_t* gen_create_branch_long_leqzero(HostReg reg) {
 }
 
 // calculate long relative offset and fill it into the location pointed to by data
+// unlike gen_fill_branch this keeps the register cache, long branches either
+// leave the block or skip a slow path that leaves the cached registers intact
 static void gen_fill_branch_long(const uint8_t* data) {
 	cache_addd((uint32_t)(cache.pos-data-4),data);
 }
 
+#ifdef DRC_USE_INLINE_TLB
+// access size bytes of guest memory at the linear address held in FC_OP1
+// directly through paging.tlb, reading into reg (zero-extended) or writing
+// the value of reg. TLB misses, handler pages and accesses that cross a page
+// continue with the code emitted next (the call to the checked helper);
+// returns the jump that skips it, to be filled in with gen_fill_branch_long()
+// uses r10 and r11, which the recompiler doesn't allocate otherwise
+static const uint8_t* gen_mem_access_inline(HostReg reg,Bitu size,bool write) {
+	const uint8_t* miss[2];
+	Bitu misses=0;
+
+	cache_addb(0x41);		// mov r11d,FC_OP1 (zero extends the address)
+	cache_addw(0xc389+(FC_OP1<<11));
+	if (size>1) {
+		cache_addw(0x8945);		// mov r10d,r11d
+		cache_addb(0xda);
+		cache_addw(0x8141);		// and r10d,0xfff
+		cache_addb(0xe2);
+		cache_addd(0xfff);
+		cache_addw(0x8141);		// cmp r10d,0x1000-size+1
+		cache_addb(0xfa);
+		cache_addd((uint32_t)(0x1000-size+1));
+		cache_addw(0x830f);		// jae miss
+		cache_addd(0);
+		miss[misses++]=cache.pos-4;
+	}
+	cache_addw(0x8945);			// mov r10d,r11d
+	cache_addb(0xda);
+	cache_addw(0xc141);			// shr r10d,12
+	cache_addw(0x0cea);
+	cache_addw(0xb949);			// mov r9,table
+	cache_addq((uint64_t)(write ? paging.tlb.write : paging.tlb.read));
+	cache_addd(0xd1148b4f);		// mov r10,[r9+r10*8]
+	cache_addw(0x854d);			// test r10,r10
+	cache_addb(0xd2);
+	cache_addw(0x840f);			// jz miss
+	cache_addd(0);
+	miss[misses++]=cache.pos-4;
+
+	// [r10+r11] with reg in the modrm field, the REX prefix makes the low
+	// byte of every register accessible
+	if (write && size==2) cache_addb(0x66);
+	cache_addb(0x43);
+	switch (size) {
+		case 1: if (write) cache_addb(0x88); else cache_addw(0xb60f); break;	// mov [],reg8 / movzx reg,byte []
+		case 2: if (write) cache_addb(0x89); else cache_addw(0xb70f); break;	// mov [],reg16 / movzx reg,word []
+		default: cache_addb(write ? 0x89 : 0x8b); break;						// mov [],reg / mov reg,[]
+	}
+	cache_addb(0x04+(reg<<3));
+	cache_addb(0x1a);
+
+#if DYNREC_MEMORY_STATS
+	// add qword [dynrec_stats.tlb_inline_hits],1
+	gen_memaddr(0x4,&dynrec_stats.tlb_inline_hits,1,1,0x83,0x48);
+#endif
+
+	cache_addb(0xe9);			// jmp over the slow path
+	cache_addd(0);
+	const uint8_t* done=cache.pos-4;
+	for (Bitu i=0;i<misses;i++) gen_fill_branch_long(miss[i]);
+	return done;
+}
+#endif
+
+#if C_FPU && !C_FPU_X86
+// generate the common x87 arithmetic and register moves inline, see gen_fpu_arith;
+// the registers are kept as doubles (fpu.regs) and the operations are done with
+// the scalar SSE2 instructions, which round like the C code of fpu_instructions.h
+#define DRC_USE_INLINE_FPU
+
+// mov r11,&fpu; the inline FPU code addresses the registers relative to r11
+static void gen_fpu_base(void) {
+	cache_addw(0xbb49);
+	cache_addq((uint64_t)&fpu);
+}
+
+// emit op with reg in the modrm field and [r11+index*(1<<scale)+disp] as the
+// memory operand, rex adds to the REX prefix that is always emitted for r11;
+// FPU_NO_INDEX addresses [r11+disp]
+static void gen_fpu_memop(uint8_t prefix,uint8_t rex,Bitu op,Bitu oplen,uint8_t reg,HostReg index,Bitu scale,Bitu disp) {
+	if (prefix) cache_addb(prefix);
+	cache_addb(0x41+rex);
+	if (oplen==2) cache_addw((uint16_t)op);
+	else cache_addb((uint8_t)op);
+	cache_addb(0x84+((reg&7)<<3));
+	cache_addb((uint8_t)((scale<<6)+(index<<3)+0x03));
+	cache_addd((uint32_t)disp);
+}
+
+#define FPU_NO_INDEX 4
+#define FPU_REG_OFFSET offsetof(FPU_rec,regs)
+
+static_assert(sizeof(fpu.regs[0])==8,"the inline FPU code scales register indexes by 8");
+static_assert(sizeof(fpu.tags[0])==4,"the inline FPU code moves tags as dwords");
+
+// addsd, mulsd, subsd and divsd
+static const uint8_t fpu_arith_sse2[8]={0x58,0x59,0x00,0x00,0x5c,0x5c,0x5e,0x5e};
+
+// TOP is held in r8 between the FPU instructions of a block, see dyn_fpu_load_top
+
+// mov r8d,reg
+static void gen_fpu_hold_top(HostReg reg) {
+	cache_addb(0x41);
+	cache_addw(0xc089+(reg<<11));
+}
+
+// mov reg,r8d
+static void gen_fpu_get_top(HostReg reg) {
+	cache_addb(0x44);
+	cache_addw(0xc089+(reg<<8));
+}
+
+// mark ST(0) empty and increment the held TOP, like FPU_FPOP does without
+// the stack underflow check
+static void gen_fpu_pop(void) {
+	gen_fpu_base();
+	gen_fpu_memop(0,2,0xc7,1,0,0,2,offsetof(FPU_rec,tags));	// mov dword [r11+r8*4+tags],TAG_Empty
+	cache_addd(TAG_Empty);
+	cache_addd(0x01c08341);		// add r8d,1
+	cache_addd(0x07e08341);		// and r8d,7
+	gen_fpu_memop(0,4,0x89,1,0,FPU_NO_INDEX,0,offsetof(FPU_rec,top));	// mov [r11+top],r8d
+}
+
+static void gen_fpu_load_value(uint8_t xmm,HostReg index) {
+	gen_fpu_memop(0xf2,0,0x100f,2,xmm,index,3,FPU_REG_OFFSET);	// movsd xmm,[]
+}
+
+static void gen_fpu_store_value(uint8_t xmm,HostReg index) {
+	gen_fpu_memop(0xf2,0,0x110f,2,xmm,index,3,FPU_REG_OFFSET);	// movsd [],xmm
+}
+
+// ST(st) = ST(st) <op> ST(other), op being one of the DRC_FPU_ operations
+static void gen_fpu_arith(Bitu op,HostReg st,HostReg other) {
+	// the reversed operations compute other <op> st
+	const bool reversed=(op==DRC_FPU_SUBR) || (op==DRC_FPU_DIVR);
+	gen_fpu_base();
+	gen_fpu_load_value(0,reversed ? other : st);
+	gen_fpu_memop(0xf2,0,0x000f+(fpu_arith_sse2[op]<<8),2,0,reversed ? st : other,3,FPU_REG_OFFSET);
+	gen_fpu_store_value(0,st);
+}
+
+// ST(st) = ST(st) <op> the operand loaded into fpu.regs[8] by one of the
+// FPU_FLD_*_EA helpers
+static void gen_fpu_arith_ea(Bitu op,HostReg st) {
+	gen_mov_dword_to_reg_imm(HOST_EAX,8);
+	gen_fpu_arith(op,st,HOST_EAX);
+}
+
+// ST(other) = ST(st)
+static void gen_fpu_copy(HostReg st,HostReg other) {
+	gen_fpu_base();
+	gen_fpu_memop(0,4,0x8b,1,2,st,2,offsetof(FPU_rec,tags));		// mov r10d,[]
+	gen_fpu_memop(0,4,0x89,1,2,other,2,offsetof(FPU_rec,tags));	// mov [],r10d
+	gen_fpu_load_value(0,st);
+	gen_fpu_store_value(0,other);
+}
+
+// exchange ST(st) and ST(other)
+static void gen_fpu_xchg(HostReg st,HostReg other) {
+	gen_fpu_base();
+	gen_fpu_memop(0,4,0x8b,1,2,st,2,offsetof(FPU_rec,tags));		// mov r10d,[]
+	gen_fpu_memop(0,0,0x8b,1,HOST_EAX,other,2,offsetof(FPU_rec,tags));	// mov eax,[]
+	gen_fpu_memop(0,0,0x89,1,HOST_EAX,st,2,offsetof(FPU_rec,tags));	// mov [],eax
+	gen_fpu_memop(0,4,0x89,1,2,other,2,offsetof(FPU_rec,tags));	// mov [],r10d
+	gen_fpu_load_value(0,st);
+	gen_fpu_load_value(1,other);
+	gen_fpu_store_value(1,st);
+	gen_fpu_store_value(0,other);
+}
+#endif
+
 static void gen_run_code(void) {
 	cache_addw(0x5355);     // push rbp,rbx
 	cache_addb(0x56);       // push rsi
+	cache_addd(0x55415441); // push r12,r13
+	cache_addd(0x57415641); // push r14,r15
 	cache_addd(0x20EC8348); // sub rsp, 32
 	cache_addb(0x48);cache_addw(0x2D8D);cache_addd(2); // lea rbp, [rip+2]
 	cache_addw(0xE0FF+(FC_OP1<<8)); // jmp FC_OP1
 	cache_addd(0x20C48348); // add rsp, 32
+	cache_addd(0x5E415F41); // pop r15,r14
+	cache_addd(0x5C415D41); // pop r13,r12
 	cache_addd(0xC35D5B5E); // pop rsi,rbx,rbp;ret
 }
 
@@ -20,6 +20,18 @@
 
 #define LoadD(_BLAH) _BLAH
 
+// Lets a device that buffers its data serve a forward REP INS as a block
+// copy, up to where the index register would wrap around
+static uint32_t DoBlockIns(const PhysPt di_base, const uint32_t di_index,
+                           const uint32_t add_mask, const uint32_t count,
+                           const io_width_t width)
+{
+	const auto size = static_cast<uint8_t>(width);
+	const auto to_wrap = (static_cast<uint64_t>(add_mask) + 1 - di_index) / size;
+	const auto limit = static_cast<size_t>(std::min<uint64_t>(count, to_wrap));
+	return static_cast<uint32_t>(IO_ReadBlock(reg_dx, di_base + di_index, limit, width));
+}
+
 static void DoString(STRING_OP type) {
 	const auto si_base = BaseDS;
 	const auto di_base = SegBase(es);
@@ -77,20 +89,36 @@ static void DoString(STRING_OP type) {
 			di_index=(di_index+add_index) & add_mask;
 		}
 		break;
-	case R_INSW:
+	case R_INSW: {
 		add_index *= 2;
+		bool try_block = add_index > 0;
 		for (;count>0;count--) {
 			SaveMw(di_base+di_index,IO_ReadW(reg_dx));
 			di_index=(di_index+add_index) & add_mask;
+			if (try_block && count>1) {
+				const auto done = DoBlockIns(di_base, di_index, add_mask, count - 1, io_width_t::word);
+				di_index=(di_index+done*2) & add_mask;
+				count-=done;
+				try_block = done > 0;
+			}
 		}
 		break;
-	case R_INSD:
+	}
+	case R_INSD: {
 		add_index *= 4;
+		bool try_block = add_index > 0;
 		for (;count>0;count--) {
 			SaveMd(di_base+di_index,IO_ReadD(reg_dx));
 			di_index=(di_index+add_index) & add_mask;
+			if (try_block && count>1) {
+				const auto done = DoBlockIns(di_base, di_index, add_mask, count - 1, io_width_t::dword);
+				di_index=(di_index+done*4) & add_mask;
+				count-=done;
+				try_block = done > 0;
+			}
 		}
 		break;
+	}
 	case R_STOSB:
 		for (;count>0;count--) {
 			SaveMb(di_base+di_index,reg_al);
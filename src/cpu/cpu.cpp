@@ -80,6 +80,7 @@ void CPU_Core_Dyn_X86_SetFPUMode(bool dh_fpu);
 void CPU_Core_Dynrec_Init(void);
 void CPU_Core_Dynrec_Cache_Init(bool enable_cache);
 void CPU_Core_Dynrec_Cache_Close(void);
+void CPU_Core_Dynrec_SetHotThreshold(int threshold);
 #endif
 
 /* In debug mode exceptions are tested and dosbox exits when 
@@ -2367,6 +2368,7 @@ public:
 		CPU_Core_Dyn_X86_Cache_Init((core == "dynamic") || (core == "dynamic_nodhfpu"));
 #elif (C_DYNREC)
 		CPU_Core_Dynrec_Cache_Init( core == "dynamic" );
+		CPU_Core_Dynrec_SetHotThreshold(section->Get_int("dynrec_hot_threshold"));
 #endif
 
 		CPU_ArchitectureType = CPU_ARCHTYPE_MIXED;
@@ -19,6 +19,7 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <cerrno>
 #include <cassert>
 #include <array>
@@ -119,6 +120,10 @@ static struct {
 	CodePageHandler *free_pages; // pointer to the free list
 	CodePageHandler *used_pages; // pointer to the list of used pages
 	CodePageHandler *last_page;  // the last used page
+#if (C_DYNREC)
+	CodePageHandler *busy_data_page; // page with many data writes, waiting
+	                                 // to be weighed against its code use
+#endif
 } cache;
 
 // cache memory pointers, to be malloc'd later
@@ -151,6 +156,10 @@ public:
 
 		active_blocks=0;
 		active_count=16;
+#if (C_DYNREC)
+		executed_cycles=0;
+		data_writes=0;
+#endif
 
 		// initialize the maps with zero (no cache blocks as well as
 		// code present)
@@ -223,8 +232,10 @@ public:
 		host_writeb(hostmem + addr, val);
 		// see if there's code where we are writing to
 		if (!write_map[addr]) {
-			if (active_blocks)
+			if (active_blocks) {
+				CountDataWrite();
 				return; // still some blocks in this page
+			}
 			active_count--;
 			if (!active_count)
 				Release(); // delay page releasing until
@@ -249,8 +260,10 @@ public:
 		host_writew(hostmem + addr, val);
 		// see if there's code where we are writing to
 		if (!read_unaligned_uint16(&write_map[addr])) {
-			if (active_blocks)
+			if (active_blocks) {
+				CountDataWrite();
 				return; // still some blocks in this page
+			}
 			active_count--;
 			if (!active_count)
 				Release(); // delay page releasing until
@@ -275,8 +288,10 @@ public:
 		host_writed(hostmem + addr, val);
 		// see if there's code where we are writing to
 		if (!read_unaligned_uint32(&write_map[addr])) {
-			if (active_blocks)
+			if (active_blocks) {
+				CountDataWrite();
 				return; // still some blocks in this page
+			}
 			active_count--;
 			if (!active_count)
 				Release(); // delay page releasing until
@@ -305,6 +320,8 @@ public:
 				// the page releasing a bit
 				active_count--;
 				if (!active_count) Release();
+			} else {
+				CountDataWrite();
 			}
 		} else {
 			if (!invalidation_map)
@@ -336,6 +353,8 @@ public:
 				// the page releasing a bit
 				active_count--;
 				if (!active_count) Release();
+			} else {
+				CountDataWrite();
 			}
 		} else {
 			if (!invalidation_map)
@@ -367,6 +386,8 @@ public:
 				// the page releasing a bit
 				active_count--;
 				if (!active_count) Release();
+			} else {
+				CountDataWrite();
 			}
 		} else {
 			if (!invalidation_map)
@@ -382,6 +403,31 @@ public:
 		return false;
 	}
 
+	// a write hit data next to translated code; once enough of them piled
+	// up the core gets to decide if the page is worth keeping as code.
+	// Only dynrec hands such pages back to data use.
+	void CountDataWrite()
+	{
+#if (C_DYNREC)
+		if (++data_writes >= data_write_epoch && !cache.busy_data_page)
+			cache.busy_data_page = this;
+#endif
+	}
+
+#if (C_DYNREC)
+	// the dispatch loop credits the cycles of each run that was entered on
+	// this page, which saturate rather than wrap around
+	void AddExecutedCycles(const Bits cycles)
+	{
+		if (cycles <= 0)
+			return;
+		const auto sum = static_cast<uint64_t>(executed_cycles) +
+		                 static_cast<uint64_t>(cycles);
+		executed_cycles = static_cast<uint32_t>(
+		        std::min(sum, static_cast<uint64_t>(UINT32_MAX)));
+	}
+#endif
+
 	// add a cache block to this page and note it in the hash map
 	void AddCacheBlock(CacheBlock *block)
 	{
@@ -442,6 +488,11 @@ public:
 
 	void Release()
 	{
+#if (C_DYNREC)
+		if (cache.busy_data_page == this)
+			cache.busy_data_page = nullptr;
+#endif
+
 		// revert to old handler
 		MEM_SetPageHandler(phys_page,1,old_pagehandler);
 		PAGING_ClearTLB();
@@ -501,6 +552,17 @@ public:
 	uint8_t write_map[4096] = {};
 	uint8_t *invalidation_map = nullptr;
 
+	Bitu GetPhysPage() const { return phys_page; }
+	Bitu GetActiveBlocks() const { return active_blocks; }
+
+#if (C_DYNREC)
+	// number of data writes that are weighed against the executed code
+	static constexpr uint32_t data_write_epoch = 4096;
+
+	uint32_t executed_cycles = 0; // sampled by the dispatch loop
+	uint32_t data_writes = 0;     // writes to bytes that aren't translated code
+#endif
+
 	CodePageHandler *prev = nullptr;
 	CodePageHandler *next = nullptr;
 
@@ -906,6 +968,9 @@ static void cache_init(bool enable) {
 		cache.free_pages=nullptr;
 		cache.last_page=nullptr;
 		cache.used_pages=nullptr;
+#if (C_DYNREC)
+		cache.busy_data_page=nullptr;
+#endif
 		// setup the code pages
 		for (int i=0;i<CACHE_PAGES;i++) {
 			CodePageHandler *newpage = new CodePageHandler();
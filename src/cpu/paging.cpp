@@ -700,6 +700,10 @@ void PAGING_UnlinkPages(Bitu lin_page,Bitu pages) {
 	}
 }
 
+void PAGING_MakePageWritable(Bitu lin_page,HostPt host_page) {
+	paging.tlb.write[lin_page]=host_page-(lin_page << 12);
+}
+
 void PAGING_MapPage(Bitu lin_page,Bitu phys_page) {
 	if (lin_page<LINK_START) {
 		paging.firstmb[lin_page]=phys_page;
@@ -803,6 +807,10 @@ void PAGING_UnlinkPages(Bitu lin_page,Bitu pages) {
 	}
 }
 
+void PAGING_MakePageWritable(Bitu lin_page,HostPt host_page) {
+	get_tlb_entry(lin_page<<12)->write=host_page-(lin_page << 12);
+}
+
 void PAGING_MapPage(Bitu lin_page,Bitu phys_page) {
 	if (lin_page<LINK_START) {
 		paging.firstmb[lin_page]=phys_page;
@@ -1295,6 +1295,10 @@ bool ParseCommand(char* str) {
 
 	if (command == "CPU") {LogCPUInfo(); return true;}
 
+#if C_DYNREC
+	if (command == "DYNPAGES") {CPU_Core_Dynrec_LogPagePolicy(); return true;}
+#endif
+
 	if (command == "INTVEC") {
 		if (found[0] != 0) {
 			OutputVecTable(found);
@@ -1383,6 +1387,9 @@ bool ParseCommand(char* str) {
 		DEBUG_ShowMsg("LDT                       - Lists descriptors of the LDT.\n");
 		DEBUG_ShowMsg("IDT                       - Lists descriptors of the IDT.\n");
 		DEBUG_ShowMsg("PAGING [page]             - Display content of page table.\n");
+#if C_DYNREC
+		DEBUG_ShowMsg("DYNPAGES                  - Show dynrec code pages and demoted pages.\n");
+#endif
 		DEBUG_ShowMsg("EXTEND                    - Toggle additional info.\n");
 		DEBUG_ShowMsg("TIMERIRQ                  - Run the system timer.\n");
 
@@ -330,6 +330,9 @@ private:
 	                 const uint16_t sectorSize,
 	                 const bool mode2);
 	std::vector<Track>::iterator GetTrack(const uint32_t sector);
+	std::vector<Track>::const_iterator GetContiguousTrack(const bool raw,
+	                                                      const uint32_t sector,
+	                                                      const uint32_t num);
 	void CDAudioCallBack(uint16_t desired_frames);
 
 	// Private functions for cue sheet processing
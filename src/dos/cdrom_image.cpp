@@ -860,6 +860,27 @@ bool CDROM_Interface_Image::ReadSectors(PhysPt buffer,
 	                                 : BYTES_PER_COOKED_REDBOOK_FRAME);
 	const uint32_t requested_bytes = num * sectorSize;
 
+	// Sectors stored back-to-back are read with one host read, straight
+	// into guest memory when it's plain RAM
+	const auto track = GetContiguousTrack(raw, sector, num);
+	if (track != tracks.end()) {
+		const uint32_t offset = track->skip +
+		                        (sector - track->start) * track->sectorSize;
+		const auto direct = MEM_GetBlockWritePtr(buffer, requested_bytes);
+		if (direct && track->file->read(direct, offset, requested_bytes))
+			return true;
+		if (!direct) {
+			if (readBuffer.size() < requested_bytes)
+				readBuffer.resize(requested_bytes);
+			if (track->file->read(readBuffer.data(), offset, requested_bytes)) {
+				MEM_BlockWrite(buffer, readBuffer.data(), requested_bytes);
+				return true;
+			}
+		}
+		// Otherwise fall back to reading frame by frame, which keeps
+		// the frames that could be read
+	}
+
 	// Resize our underlying vector if it's not big enough
 	if (readBuffer.size() < requested_bytes)
 		readBuffer.resize(requested_bytes);
@@ -982,6 +1003,18 @@ bool CDROM_Interface_Image::ReadSector(uint8_t *buffer, const bool raw, const ui
 bool CDROM_Interface_Image::ReadSectorsHost(void *buffer, bool raw, unsigned long sector, unsigned long num)
 {
 	unsigned int sectorSize = raw ? BYTES_PER_RAW_REDBOOK_FRAME : BYTES_PER_COOKED_REDBOOK_FRAME;
+
+	const auto track = GetContiguousTrack(raw, static_cast<uint32_t>(sector),
+	                                      static_cast<uint32_t>(num));
+	if (track != tracks.end()) {
+		const uint32_t offset = track->skip +
+		                        (static_cast<uint32_t>(sector) - track->start) *
+		                                track->sectorSize;
+		if (track->file->read(static_cast<uint8_t *>(buffer), offset,
+		                      static_cast<uint32_t>(num * sectorSize)))
+			return true;
+	}
+
 	bool success = true; //Gobliiins reads 0 sectors
 	for(unsigned long i = 0; i < num; i++) {
 		success = ReadSector((uint8_t*)buffer + (i * (Bitu)sectorSize), raw, sector + i);
@@ -991,6 +1024,27 @@ bool CDROM_Interface_Image::ReadSectorsHost(void *buffer, bool raw, unsigned lon
 	return success;
 }
 
+// Returns the data track holding all the sectors when they're stored
+// back-to-back at the requested frame size, so they can be read in one go.
+// Raw frames read cooked, mode 2 tracks and audio tracks need per-frame
+// handling, as do runs that cross into the pregap or another track.
+track_const_iter CDROM_Interface_Image::GetContiguousTrack(const bool raw,
+                                                          const uint32_t sector,
+                                                          const uint32_t num)
+{
+	const uint16_t sectorSize = (raw ? BYTES_PER_RAW_REDBOOK_FRAME
+	                                 : BYTES_PER_COOKED_REDBOOK_FRAME);
+	if (num == 0)
+		return tracks.end();
+	const track_const_iter track = GetTrack(sector);
+	if (track == tracks.end() || track->file == nullptr ||
+	    track->attr != 0x40 || track->sectorSize != sectorSize ||
+	    (track->mode2 && !raw) || sector < track->start ||
+	    sector - track->start + num > track->length)
+		return tracks.end();
+	return track;
+}
+
 void CDROM_Interface_Image::CDAudioCallBack(uint16_t desired_track_frames)
 {
 	/**
@@ -53,6 +53,7 @@
 #include "pci_bus.h"
 #include "midi.h"
 #include "hardware.h"
+#include "replay.h"
 #include "ne2000.h"
 
 bool shutdown_requested = false;
@@ -162,6 +163,7 @@ static Bitu Normal_Loop() {
 			if (!GFX_Events())
 				return 0;
 			if (ticksRemain > 0) {
+				REPLAY_Tick();
 				TIMER_AddTick();
 				ticksRemain--;
 			} else {increaseticks();return 0;}
@@ -170,6 +172,12 @@ static Bitu Normal_Loop() {
 }
 
 void increaseticks() { //Make it return ticksRemain and set it in the function above to remove the global variable.
+	if (GCC_UNLIKELY(REPLAY_IsReplaying())) {
+		// Replays run unthrottled, the logged cycles keep them in step
+		ticksRemain = 5;
+		return;
+	}
+
 	if (GCC_UNLIKELY(ticksLocked)) { // For Fast Forward Mode
 		ticksRemain=5;
 		/* Reset any auto cycle guessing for this frame */
@@ -346,6 +354,15 @@ static void DOSBOX_RealInit(Section * sec) {
 	MAPPER_AddHandler(DOSBOX_UnlockSpeed, SDL_SCANCODE_F12, MMOD2,
 	                  "speedlock", "Speedlock");
 
+	std::string replay_file;
+	if (control->cmdline->FindString("-recordinput", replay_file, true))
+		REPLAY_StartRecording(replay_file);
+	else if (control->cmdline->FindString("-replayinput", replay_file, true))
+		REPLAY_StartReplay(replay_file);
+	if (control->cmdline->FindString("-framehashes", replay_file, true))
+		REPLAY_StartFrameHashes(replay_file);
+	sec->AddDestroyFunction(&REPLAY_Shutdown);
+
 	std::string cmd_machine;
 	if (control->cmdline->FindString("-machine",cmd_machine,true)){
 		//update value in config (else no matching against suggested values
@@ -449,6 +466,21 @@ void DOSBOX_Init() {
 	pstring->Set_help(
 	        "Directory where things like wave, midi, screenshot get captured.");
 
+	pstring = secprop->Add_string("capture_video_stream", only_at_start, "");
+	pstring->Set_help(
+	        "Stream every rendered frame as uncompressed YUV4MPEG2 video to this file,\n"
+	        "named pipe, or inherited file descriptor (fd:N), for example for an\n"
+	        "external encoder. The stream keeps the size of the first frame.\n"
+	        "Emulation slows down if the reader can't keep up. A named pipe's reader\n"
+	        "has 30 seconds to connect, frames are dropped until then\n"
+	        "(disabled by default).");
+
+	pstring = secprop->Add_string("capture_audio_stream", only_at_start, "");
+	pstring->Set_help(
+	        "Stream the mixer output as raw 16-bit little-endian stereo PCM at the\n"
+	        "mixer's rate to this file, named pipe, or inherited file descriptor (fd:N)\n"
+	        "(disabled by default).");
+
 #if C_DEBUG
 	LOG_StartUp();
 #endif
@@ -641,6 +673,14 @@ void DOSBOX_Init() {
 	Pint->SetMinMax(1,1000000);
 	Pint->Set_help("Setting it lower than 100 will be a percentage.");
 
+#if (C_DYNREC)
+	Pint = secprop->Add_int("dynrec_hot_threshold", when_idle, 2);
+	Pint->SetMinMax(1, 255);
+	Pint->Set_help("Execution on which the dynamic core translates code, the ones before\n"
+	               "run in the normal core. 2 (the default) interprets code once and\n"
+	               "translates it when it runs again, 1 translates it when it first runs.");
+#endif
+
 #if C_FPU
 	secprop->AddInitFunction(&FPU_Init);
 #endif
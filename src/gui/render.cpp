@@ -37,6 +37,7 @@
 #include "mapper.h"
 #include "cross.h"
 #include "hardware.h"
+#include "replay.h"
 #include "support.h"
 #include "shell.h"
 #include "string_utils.h"
@@ -106,6 +107,88 @@ void RENDER_SetPal(uint8_t entry,uint8_t red,uint8_t green,uint8_t blue) {
 static void RENDER_EmptyLineHandler(const void *)
 {}
 
+// Points the scalers at their output: either the GFX surface, or the palette
+// index frame when the colour lookup is deferred to the end of the frame.
+static bool RENDER_StartOutput()
+{
+	if (render.scale.deferPalette) {
+		render.scale.outWrite = render.scale.indexFrame.data();
+		render.scale.outPitch = static_cast<int>(render.scale.outWidth);
+		return true;
+	}
+	return GFX_StartUpdate(render.scale.outWrite, render.scale.outPitch);
+}
+
+template <typename PixelType>
+static void ExpandIndexLines(uint8_t *pixels, const int pitch,
+                             const PixelType *lut, const uint32_t start,
+                             const uint32_t count)
+{
+	const auto width = render.scale.outWidth;
+	const auto end = std::min(start + count, render.scale.outHeight);
+	for (auto y = start; y < end; ++y) {
+		const uint8_t *src = render.scale.indexFrame.data() + y * width;
+		auto dst = reinterpret_cast<PixelType *>(pixels + y * pitch);
+		uint32_t x = 0;
+		for (; x + 4 <= width; x += 4) {
+			dst[x + 0] = lut[src[x + 0]];
+			dst[x + 1] = lut[src[x + 1]];
+			dst[x + 2] = lut[src[x + 2]];
+			dst[x + 3] = lut[src[x + 3]];
+		}
+		for (; x < width; ++x)
+			dst[x] = lut[src[x]];
+	}
+}
+
+static void ExpandIndexFrame(uint8_t *pixels, const int pitch,
+                             const uint32_t start, const uint32_t count)
+{
+	switch (render.scale.outMode) {
+	case scalerMode15:
+	case scalerMode16:
+		ExpandIndexLines(pixels, pitch, render.pal.lut.b16, start, count);
+		break;
+	case scalerMode32:
+		ExpandIndexLines(pixels, pitch, render.pal.lut.b32, start, count);
+		break;
+	case scalerMode8: break;
+	}
+}
+
+// Converts the changed parts of the index frame to output colours. A palette
+// change only re-runs this lookup pass; the scaled indexes stay valid.
+static void RENDER_FinishDeferredPalette(bool abort)
+{
+	if (!render.scale.outWrite && !render.scale.expandAll) {
+		GFX_EndUpdate(nullptr);
+		return;
+	}
+	uint8_t *pixels = nullptr;
+	int pitch = 0;
+	if (!GFX_StartUpdate(pixels, pitch)) {
+		// The index frame is intact, so catch up on the next frame
+		render.scale.expandAll = true;
+		GFX_EndUpdate(nullptr);
+		return;
+	}
+	if (render.scale.expandAll || abort) {
+		ExpandIndexFrame(pixels, pitch, 0, render.scale.outHeight);
+		Scaler_ChangedLines[0] = 0;
+		Scaler_ChangedLines[1] = static_cast<uint16_t>(render.scale.outHeight);
+		Scaler_ChangedLineIndex = 1;
+		render.scale.expandAll = false;
+	} else {
+		uint32_t y = 0;
+		for (Bitu i = 0; i <= Scaler_ChangedLineIndex; ++i) {
+			if (i & 1)
+				ExpandIndexFrame(pixels, pitch, y, Scaler_ChangedLines[i]);
+			y += Scaler_ChangedLines[i];
+		}
+	}
+	GFX_EndUpdate(Scaler_ChangedLines);
+}
+
 static void RENDER_StartLineHandler(const void * s) {
 	if (s) {
 		const Bitu *src = (Bitu*)s;
@@ -114,7 +197,7 @@ static void RENDER_StartLineHandler(const void * s) {
 			const auto src_ptr = reinterpret_cast<const uint8_t *>(src);
 			const auto src_val = read_unaligned_size_t(src_ptr);
 			if (GCC_UNLIKELY(src_val != cache[0])) {
-				if (!GFX_StartUpdate(render.scale.outWrite, render.scale.outPitch)) {
+				if (!RENDER_StartOutput()) {
 					RENDER_DrawLine = RENDER_EmptyLineHandler;
 					return;
 				}
@@ -166,6 +249,18 @@ bool RENDER_StartUpdate(void) {
 		return false;
 	}
 	render.frameskip.count=0;
+	/* Skip all drawing and scaling while the output can't be seen, unless
+	 * we're capturing or hashing frames. The VGA timing events are
+	 * scheduled regardless, so only the frame contents are lost; redraw
+	 * everything on the way back.
+	 */
+	if (GCC_UNLIKELY(!GFX_IsVisible()) &&
+	    !(CaptureState &
+	      (CAPTURE_IMAGE | CAPTURE_VIDEO | CAPTURE_STREAM_VIDEO)) &&
+	    !REPLAY_IsHashingFrames()) {
+		render.scale.clearCache = true;
+		return false;
+	}
 	if (render.scale.inMode == scalerMode8) {
 		Check_Palette();
 	}
@@ -180,13 +275,17 @@ bool RENDER_StartUpdate(void) {
 	if (GCC_UNLIKELY( render.scale.clearCache) ) {
 //		LOG_MSG("Clearing cache");
 		//Will always have to update the screen with this one anyway, so let's update already
-		if (GCC_UNLIKELY(!GFX_StartUpdate( render.scale.outWrite, render.scale.outPitch )))
+		if (GCC_UNLIKELY(!RENDER_StartOutput()))
 			return false;
 		render.fullFrame = true;
 		render.scale.clearCache = false;
 		RENDER_DrawLine = RENDER_ClearCacheHandler;
 	} else {
-		if (render.pal.changed) {
+		if (render.pal.changed && render.scale.deferPalette) {
+			/* Only the colour lookup needs redoing, not the scaling */
+			render.scale.expandAll = true;
+		}
+		if (render.pal.changed && !render.scale.deferPalette) {
 			/* Assume pal changes always do a full screen update anyway */
 			if (GCC_UNLIKELY(!GFX_StartUpdate( render.scale.outWrite, render.scale.outPitch )))
 				return false;
@@ -194,7 +293,7 @@ bool RENDER_StartUpdate(void) {
 			render.fullFrame = true;
 		} else {
 			RENDER_DrawLine = RENDER_StartLineHandler;
-			if (GCC_UNLIKELY(CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO))) 
+			if (GCC_UNLIKELY(CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO|CAPTURE_STREAM_VIDEO))) 
 				render.fullFrame = true;
 			else
 				render.fullFrame = false;
@@ -216,7 +315,7 @@ void RENDER_EndUpdate( bool abort ) {
 	if (GCC_UNLIKELY(!render.updating))
 		return;
 	RENDER_DrawLine = RENDER_EmptyLineHandler;
-	if (GCC_UNLIKELY(CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO))) {
+	if (GCC_UNLIKELY(CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO|CAPTURE_STREAM_VIDEO))) {
 		Bitu pitch, flags;
 		flags = 0;
 		if (render.src.dblw != render.src.dblh) {
@@ -233,7 +332,15 @@ void RENDER_EndUpdate( bool abort ) {
 		                 pitch, flags, static_cast<float>(fps), (uint8_t *)&scalerSourceCache,
 		                 (uint8_t *)&render.pal.rgb);
 	}
-	if ( render.scale.outWrite ) {
+	if (GCC_UNLIKELY(REPLAY_IsHashingFrames()))
+		REPLAY_AddFrame(render.src.width, render.src.height, render.src.bpp,
+		                render.scale.cachePitch,
+		                (uint8_t *)&scalerSourceCache,
+		                (uint8_t *)&render.pal.rgb);
+	if (render.scale.deferPalette) {
+		RENDER_FinishDeferredPalette(abort);
+		render.frameskip.hadSkip[render.frameskip.index] = 0;
+	} else if ( render.scale.outWrite ) {
 		GFX_EndUpdate( abort? NULL : Scaler_ChangedLines );
 		render.frameskip.hadSkip[render.frameskip.index] = 0;
 	} else {
@@ -536,6 +643,43 @@ forcenormal:
 	default:
 		E_Exit("RENDER:Wrong source bpp %u", render.src.bpp);
 	}
+	/* Plain pixel replication commutes with the palette lookup, so 8bpp
+	 * sources can be scaled as indexes and coloured in a final pass */
+	const bool is_replicating = (simpleBlock == &ScaleNormal1x ||
+	                             simpleBlock == &ScaleNormalDw ||
+	                             simpleBlock == &ScaleNormalDh ||
+	                             simpleBlock == &ScaleNormal2x ||
+	                             simpleBlock == &ScaleNormal3x);
+	render.scale.deferPalette = render.src.bpp == 8 && !complexBlock &&
+	                            is_replicating &&
+	                            render.scale.outMode != scalerMode8 &&
+	                            (*lineBlock)[0][scalerMode8];
+	render.scale.expandAll = false;
+	if (render.scale.deferPalette) {
+		render.scale.lineHandler = (*lineBlock)[0][scalerMode8];
+		render.scale.outWidth = static_cast<uint32_t>(width);
+		render.scale.outHeight = static_cast<uint32_t>(height);
+		render.scale.indexFrame.assign(width * height, 0);
+	} else {
+		render.scale.indexFrame.clear();
+	}
+	/* With matching input and output formats, replication needs no per
+	 * pixel conversion and can use the integer nearest-neighbour blitter */
+	render.scale.pixelSize = 0;
+	if (is_replicating && !complexBlock) {
+		if (render.src.bpp == 8 && (render.scale.deferPalette ||
+		                            render.scale.outMode == scalerMode8))
+			render.scale.pixelSize = 1;
+		else if ((render.src.bpp == 15 && render.scale.outMode == scalerMode15) ||
+		         (render.src.bpp == 16 && render.scale.outMode == scalerMode16))
+			render.scale.pixelSize = 2;
+		else if (render.src.bpp == 32 && render.scale.outMode == scalerMode32)
+			render.scale.pixelSize = 4;
+	}
+	if (render.scale.pixelSize) {
+		render.scale.xscale = static_cast<uint32_t>(simpleBlock->xscale);
+		render.scale.lineHandler = Scaler_NearestLine;
+	}
 	render.scale.blocks = render.src.width / SCALER_BLOCKSIZE;
 	render.scale.lastBlock = render.src.width % SCALER_BLOCKSIZE;
 	render.scale.inHeight = render.src.height;
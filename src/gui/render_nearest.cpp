@@ -0,0 +1,174 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "render_nearest.h"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEAREST_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Portable fallback, also used for the tail that doesn't fill a vector
+template <typename T, int factor>
+static void replicate(const uint8_t *src, uint8_t *dst, const int width)
+{
+	for (int x = 0; x < width; ++x) {
+		T pixel;
+		memcpy(&pixel, src + x * sizeof(T), sizeof(T));
+		for (int i = 0; i < factor; ++i)
+			memcpy(dst + (x * factor + i) * sizeof(T), &pixel, sizeof(T));
+	}
+}
+
+#if NEAREST_USE_SSE2
+
+static inline __m128i load(const uint8_t *p)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+static inline void store(uint8_t *p, const __m128i v)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+
+// 2x: interleaving a vector with itself doubles every element
+template <typename T>
+static void replicate_2x(const uint8_t *src, uint8_t *dst, const int width)
+{
+	constexpr int step = 16 / sizeof(T);
+	int x = 0;
+	for (; x + step <= width; x += step) {
+		const auto v = load(src + x * sizeof(T));
+		__m128i lo, hi;
+		if constexpr (sizeof(T) == 1) {
+			lo = _mm_unpacklo_epi8(v, v);
+			hi = _mm_unpackhi_epi8(v, v);
+		} else if constexpr (sizeof(T) == 2) {
+			lo = _mm_unpacklo_epi16(v, v);
+			hi = _mm_unpackhi_epi16(v, v);
+		} else {
+			lo = _mm_unpacklo_epi32(v, v);
+			hi = _mm_unpackhi_epi32(v, v);
+		}
+		store(dst + x * 2 * sizeof(T), lo);
+		store(dst + x * 2 * sizeof(T) + 16, hi);
+	}
+	replicate<T, 2>(src + x * sizeof(T), dst + x * 2 * sizeof(T), width - x);
+}
+
+// 3x and 4x on 32-bit pixels: four pixels ABCD become AAAB BBCC CDDD (or
+// AAAA BBBB CCCC DDDD), which are plain dword shuffles
+static void replicate_3x_32(const uint8_t *src, uint8_t *dst, const int width)
+{
+	int x = 0;
+	for (; x + 4 <= width; x += 4) {
+		const auto v = load(src + x * 4);
+		uint8_t *out = dst + x * 12;
+		store(out, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 0, 0)));
+		store(out + 16, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 1, 1)));
+		store(out + 32, _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 2)));
+	}
+	replicate<uint32_t, 3>(src + x * 4, dst + x * 12, width - x);
+}
+
+static void replicate_4x_32(const uint8_t *src, uint8_t *dst, const int width)
+{
+	int x = 0;
+	for (; x + 4 <= width; x += 4) {
+		const auto v = load(src + x * 4);
+		uint8_t *out = dst + x * 16;
+		store(out, _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 0, 0, 0)));
+		store(out + 16, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 1, 1)));
+		store(out + 32, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 2, 2)));
+		store(out + 48, _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)));
+	}
+	replicate<uint32_t, 4>(src + x * 4, dst + x * 16, width - x);
+}
+
+#else
+
+template <typename T>
+static void replicate_2x(const uint8_t *src, uint8_t *dst, const int width)
+{
+	replicate<T, 2>(src, dst, width);
+}
+
+static void replicate_3x_32(const uint8_t *src, uint8_t *dst, const int width)
+{
+	replicate<uint32_t, 3>(src, dst, width);
+}
+
+static void replicate_4x_32(const uint8_t *src, uint8_t *dst, const int width)
+{
+	replicate<uint32_t, 4>(src, dst, width);
+}
+
+#endif
+
+template <typename T>
+static void scale_line(const uint8_t *src, uint8_t *dst, const int width,
+                       const int factor)
+{
+	switch (factor) {
+	case 1: memcpy(dst, src, width * sizeof(T)); break;
+	case 2: replicate_2x<T>(src, dst, width); break;
+	case 3:
+		if constexpr (sizeof(T) == 4)
+			replicate_3x_32(src, dst, width);
+		else
+			replicate<T, 3>(src, dst, width);
+		break;
+	case 4:
+		if constexpr (sizeof(T) == 4)
+			replicate_4x_32(src, dst, width);
+		else
+			replicate<T, 4>(src, dst, width);
+		break;
+	default:
+		for (int x = 0; x < width; ++x)
+			for (int i = 0; i < factor; ++i)
+				memcpy(dst + (x * factor + i) * sizeof(T),
+				       src + x * sizeof(T), sizeof(T));
+		break;
+	}
+}
+
+void nearest_scale_line(const uint8_t *src, uint8_t *dst, const int width,
+                        const int factor, const int pixel_size)
+{
+	assert(width >= 0 && factor > 0);
+	switch (pixel_size) {
+	case 1: scale_line<uint8_t>(src, dst, width, factor); break;
+	case 2: scale_line<uint16_t>(src, dst, width, factor); break;
+	case 4: scale_line<uint32_t>(src, dst, width, factor); break;
+	default: assert(false); break;
+	}
+}
+
+void nearest_fill_rows(const uint8_t *line, const size_t bytes, uint8_t *dst,
+                       const ptrdiff_t pitch, const int rows)
+{
+	for (int y = 0; y < rows; ++y)
+		memcpy(dst + pitch * y, line, bytes);
+}
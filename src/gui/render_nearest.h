@@ -0,0 +1,48 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_RENDER_NEAREST_H
+#define DOSBOX_RENDER_NEAREST_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+Integer Nearest-Neighbour Scaling
+---------------------------------
+When the input and output share a pixel format, an integer scale is nothing
+more than pixel replication: each pixel is repeated 'factor' times across
+the line, and the widened line is repeated down the rows it covers.
+
+The horizontal pass is done once per source line (with SSE2 unpacks and
+shuffles where available), after which the vertical pass is a plain memcpy
+per output row.
+*/
+
+// Widens 'width' pixels of 'pixel_size' bytes each (1, 2, or 4) from 'src'
+// into 'dst', repeating every pixel 'factor' times.
+void nearest_scale_line(const uint8_t *src, uint8_t *dst, int width,
+                        int factor, int pixel_size);
+
+// Copies a widened line of 'bytes' into 'rows' consecutive output rows.
+void nearest_fill_rows(const uint8_t *line, size_t bytes, uint8_t *dst,
+                       ptrdiff_t pitch, int rows);
+
+#endif
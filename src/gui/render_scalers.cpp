@@ -23,6 +23,7 @@
 
 #include "dosbox.h"
 #include "render.h"
+#include "render_nearest.h"
 #include <string.h>
 
 uint8_t Scaler_Aspect[SCALER_MAXHEIGHT];
@@ -71,6 +72,30 @@ static inline void ScalerAddLines( Bitu changed, Bitu count ) {
 	render.scale.outWrite += render.scale.outPitch * count;
 }
 
+void Scaler_NearestLine(const void *s) {
+	const auto src = static_cast<const uint8_t *>(s);
+	uint8_t *cache = render.scale.cacheRead;
+	render.scale.cacheRead += render.scale.cachePitch;
+	const Bitu lines = Scaler_Aspect[ render.scale.outLine++ ];
+#ifdef RENDER_NULL_INPUT
+	if (!src) {
+		ScalerAddLines( 0, lines );
+		return;
+	}
+#endif
+	if (memcmp(src, cache, render.scale.cachePitch) == 0) {
+		ScalerAddLines( 0, lines );
+		return;
+	}
+	memcpy(cache, src, render.scale.cachePitch);
+	/* Widen into the write cache so the output is only ever written to */
+	uint8_t *line = reinterpret_cast<uint8_t *>(scalerWriteCache.b32[0]);
+	nearest_scale_line(src, line, render.src.width, render.scale.xscale,
+	                   render.scale.pixelSize);
+	nearest_fill_rows(line, render.scale.cachePitch * render.scale.xscale,
+	                  render.scale.outWrite, render.scale.outPitch, lines);
+	ScalerAddLines( 1, lines );
+}
 
 #define BituMove2(_DST,_SRC,_SIZE)			\
 {											\
@@ -99,6 +99,9 @@ extern scalerChangeCache_t scalerChangeCache;
 #endif
 typedef ScalerLineHandler_t ScalerLineBlock_t[6][4];
 
+/* Same-format integer scaling: widens the line once, then copies it down */
+void Scaler_NearestLine(const void *src);
+
 typedef struct {
 	const char *name;
 	Bitu gfxFlags;
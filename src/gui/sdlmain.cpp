@@ -1444,6 +1444,19 @@ static bool is_using_kmsdrm_driver()
 	return driver_str == "kmsdrm";
 }
 
+// The dummy and offscreen drivers never put anything on screen, so there's
+// no point in rendering frames with them.
+static bool is_using_headless_driver()
+{
+	const auto driver = SDL_GetCurrentVideoDriver();
+	if (!driver)
+		return false;
+
+	std::string driver_str = driver;
+	lowcase(driver_str);
+	return driver_str == "dummy" || driver_str == "offscreen";
+}
+
 static void check_kmsdrm_setting()
 {
 	// Simple pre-check to see if we're using kmsdrm
@@ -2159,6 +2172,24 @@ static void SwitchFullScreen(bool pressed)
 		GFX_SwitchFullScreen();
 }
 
+// Returns false when nothing drawn would be seen, so the renderer can skip
+// line drawing, scaling, and frame uploads altogether.
+bool GFX_IsVisible()
+{
+	return sdl.is_visible && !sdl.is_headless;
+}
+
+// Marks the window as shown again and requests a full redraw, because the
+// renderer's line cache went stale while frames were being skipped.
+static void set_window_shown()
+{
+	if (sdl.is_visible)
+		return;
+	sdl.is_visible = true;
+	if (sdl.draw.callback)
+		sdl.draw.callback(GFX_CallBackRedraw);
+}
+
 // This function returns write'able buffer for user to draw upon. Successful
 // return depends on properly initialized SDL_Block structure (which generally
 // can be achieved via GFX_SetSize call), and specifically - properly initialized
@@ -2242,13 +2273,44 @@ void GFX_EndUpdate(const uint16_t *changedLines)
 
 // Texture update and presentation
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-static void update_frame_texture([[maybe_unused]] const uint16_t *changedLines)
+
+// Uploads a band of rows of the input surface to the texture, straight from
+// the surface so the driver copies them only once.
+static void upload_texture_rows(const int y, const int height)
+{
+	const auto surface = sdl.texture.input_surface;
+	assert(surface);
+	if (y >= surface->h || height <= 0)
+		return;
+
+	const SDL_Rect rect = {0, y, surface->w, std::min(height, surface->h - y)};
+	const auto pixels = static_cast<const uint8_t *>(surface->pixels) +
+	                    y * surface->pitch;
+	SDL_UpdateTexture(sdl.texture.texture, &rect, pixels, surface->pitch);
+}
+
+static void update_frame_texture(const uint16_t *changedLines)
 {
-	if (sdl.update_display_contents) {
-		SDL_UpdateTexture(sdl.texture.texture,
-		                  nullptr, // update entire texture
-		                  sdl.texture.input_surface->pixels,
-		                  sdl.texture.input_surface->pitch);
+	// Nothing was drawn, so the texture still holds the current frame
+	if (!sdl.update_display_contents || !sdl.updating)
+		return;
+
+	// Aborted frames don't carry change information; upload everything
+	if (!changedLines) {
+		upload_texture_rows(0, sdl.texture.input_surface->h);
+		return;
+	}
+
+	// The changed-lines list alternates between runs of unchanged and
+	// changed rows, exactly like the OpenGL frame-buffer path consumes it.
+	int y = 0;
+	size_t index = 0;
+	while (y < sdl.draw.height) {
+		const int height = changedLines[index];
+		if (index & 1)
+			upload_texture_rows(y, height);
+		y += height;
+		index++;
 	}
 }
 
@@ -3253,6 +3315,10 @@ static void GUI_StartUp(Section *sec)
 	sdl.updating = false;
 	sdl.update_display_contents = true;
 	sdl.resizing_window = false;
+	sdl.is_visible = true;
+	sdl.is_headless = is_using_headless_driver();
+	if (sdl.is_headless)
+		LOG_MSG("SDL: Headless video driver detected, skipping frame rendering");
 	sdl.wait_on_error = section->Get_bool("waitonerror");
 
 	sdl.desktop.fullscreen=section->Get_bool("fullscreen");
@@ -3667,6 +3733,7 @@ bool GFX_Events()
 			switch (event.window.event) {
 			case SDL_WINDOWEVENT_RESTORED:
 				DEBUG_LOG_MSG("SDL: Window has been restored");
+				set_window_shown();
 				/* We may need to re-create a texture
 				 * and more on Android. Another case:
 				 * Update surface while using X11.
@@ -3701,6 +3768,8 @@ bool GFX_Events()
 				 * and size toggles.
 				 */
 				// DEBUG_LOG_MSG("SDL: Window has gained keyboard focus");
+				// Redrawn just below, so only mark it as visible
+				sdl.is_visible = true;
 				SetPriority(sdl.priority.focus);
 				if (sdl.draw.callback)
 					sdl.draw.callback(GFX_CallBackRedraw);
@@ -3733,10 +3802,12 @@ bool GFX_Events()
 
 			case SDL_WINDOWEVENT_SHOWN:
 				DEBUG_LOG_MSG("SDL: Window has been shown");
+				set_window_shown();
 				continue;
 
 			case SDL_WINDOWEVENT_HIDDEN:
 				DEBUG_LOG_MSG("SDL: Window has been hidden");
+				sdl.is_visible = false;
 				continue;
 
 #if 0 // ifdefed out only because it's too noisy
@@ -3761,10 +3832,12 @@ bool GFX_Events()
 
 			case SDL_WINDOWEVENT_MINIMIZED:
 				DEBUG_LOG_MSG("SDL: Window has been minimized");
+				sdl.is_visible = false;
 				break;
 
 			case SDL_WINDOWEVENT_MAXIMIZED:
 				DEBUG_LOG_MSG("SDL: Window has been maximized");
+				set_window_shown();
 				continue;
 
 			case SDL_WINDOWEVENT_CLOSE:
@@ -3819,6 +3892,7 @@ bool GFX_Events()
 								// We've got focus back, so unpause and break out of the loop
 								if ((ev.window.event == SDL_WINDOWEVENT_FOCUS_GAINED) || (ev.window.event == SDL_WINDOWEVENT_RESTORED) || (ev.window.event == SDL_WINDOWEVENT_EXPOSED)) {
 									paused = false;
+									set_window_shown();
 									GFX_SetTitle(-1,-1,false);
 									SetPriority(sdl.priority.focus);
 									CPU_Disable_SkipAutoAdjust();
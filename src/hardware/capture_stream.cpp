@@ -0,0 +1,410 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "hardware.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if !defined(WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "rwqueue.h"
+#include "string_utils.h"
+
+// Streams raw video frames and PCM audio to files, named pipes, or inherited
+// file descriptors so an external encoder can run on other cores. The
+// emulation thread only copies the source frame or the mixed samples into a
+// recycled buffer. A writer thread per stream does the colour conversion and
+// blocks on the pipe, which throttles the emulation if the encoder falls
+// behind rather than dropping frames. Until a named pipe's reader connects,
+// and after a stream fails, frames are dropped instead.
+
+using stream_buffer_t = std::vector<uint8_t>;
+
+// Sets no_reader when the target is a named pipe nobody reads from yet
+static FILE *open_stream_target(const std::string &target, bool &no_reader)
+{
+	no_reader = false;
+	if (starts_with("fd:", target)) {
+		const auto fd = atoi(target.c_str() + 3);
+#if defined(WIN32)
+		return _fdopen(fd, "wb");
+#else
+		return fdopen(fd, "wb");
+#endif
+	}
+#if defined(WIN32)
+	return fopen(target.c_str(), "wb");
+#else
+	// A blocking open of a named pipe waits for its reader, possibly
+	// forever, while a non-blocking one fails with ENXIO instead
+	const auto fd = open(target.c_str(),
+	                     O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, 0644);
+	if (fd < 0) {
+		no_reader = (errno == ENXIO);
+		return nullptr;
+	}
+	// But the writes should block, so a slow reader throttles emulation
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+	FILE *file = fdopen(fd, "wb");
+	if (!file)
+		close(fd);
+	return file;
+#endif
+}
+
+class CaptureStream {
+public:
+	// Writes one buffer on the writer thread, returns false on failure
+	using writer_t = bool (*)(FILE *file, const stream_buffer_t &buffer);
+
+	CaptureStream(const char *stream_kind, const std::string &stream_target,
+	              const writer_t stream_writer)
+	        : kind(stream_kind),
+	          target(stream_target),
+	          writer(stream_writer)
+	{
+		for (auto i = 0; i < num_buffers; ++i)
+			backstock.Enqueue(stream_buffer_t());
+		thread = std::thread(&CaptureStream::Run, this);
+	}
+
+	~CaptureStream()
+	{
+		// An empty buffer tells the writer to finish up
+		is_stopping = true;
+		playable.Enqueue(stream_buffer_t());
+		thread.join();
+	}
+
+	CaptureStream(const CaptureStream &) = delete;
+	CaptureStream &operator=(const CaptureStream &) = delete;
+
+	// Frames are only worth queueing while the target is open
+	bool IsOpen() const
+	{
+		return is_open;
+	}
+
+	stream_buffer_t GetBuffer()
+	{
+		auto buffer = backstock.Dequeue();
+		buffer.clear();
+		return buffer;
+	}
+
+	void Submit(stream_buffer_t &&buffer)
+	{
+		playable.Enqueue(std::move(buffer));
+	}
+
+private:
+	// Waits a while for a named pipe's reader to connect, polling so the
+	// stream can still be stopped in the meantime
+	FILE *Open()
+	{
+		using namespace std::chrono;
+		const auto give_up_at = steady_clock::now() + seconds(30);
+
+		bool no_reader = false;
+		FILE *file = open_stream_target(target, no_reader);
+		if (no_reader)
+			LOG_MSG("CAPTURE: Waiting for a reader to connect to '%s'",
+			        target.c_str());
+		while (!file && no_reader && !is_stopping &&
+		       steady_clock::now() < give_up_at) {
+			std::this_thread::sleep_for(milliseconds(100));
+			file = open_stream_target(target, no_reader);
+		}
+
+		if (file)
+			LOG_MSG("CAPTURE: Streaming %s to '%s'", kind, target.c_str());
+		else if (no_reader && !is_stopping)
+			LOG_WARNING("CAPTURE: Nothing connected to '%s', not streaming %s",
+			            target.c_str(), kind);
+		else if (!no_reader)
+			LOG_WARNING("CAPTURE: Can't open '%s' for the %s stream",
+			            target.c_str(), kind);
+		return file;
+	}
+
+	void Run()
+	{
+		FILE *file = Open();
+		is_open = (file != nullptr);
+
+		while (true) {
+			auto buffer = playable.Dequeue();
+			if (buffer.empty())
+				break;
+			if (file && !writer(file, buffer)) {
+				LOG_WARNING("CAPTURE: Stopped streaming %s, '%s' was closed",
+				            kind, target.c_str());
+				is_open = false;
+				fclose(file);
+				file = nullptr;
+			}
+			backstock.Enqueue(std::move(buffer));
+		}
+		if (file)
+			fclose(file);
+	}
+
+	static constexpr auto num_buffers = 8;
+	RWQueue<stream_buffer_t> playable{num_buffers + 1};
+	RWQueue<stream_buffer_t> backstock{num_buffers};
+	const char *kind = nullptr;
+	std::string target = {};
+	writer_t writer = nullptr;
+	std::atomic<bool> is_open = false;
+	std::atomic<bool> is_stopping = false;
+	std::thread thread = {};
+};
+
+// Video frames are queued with this header, the palette, and the source
+// lines packed without padding
+struct StreamFrameHeader {
+	int width = 0;
+	int height = 0;
+	int bpp = 0;
+	uint8_t flags = 0;
+	float fps = 0.0f;
+};
+
+constexpr size_t stream_palette_size = 256 * 4;
+
+// Audio is queued in blocks of this many stereo frames
+constexpr size_t stream_audio_block = 4096;
+
+static struct {
+	std::unique_ptr<CaptureStream> video = {};
+	std::unique_ptr<CaptureStream> audio = {};
+	stream_buffer_t audio_buffer = {};
+	bool has_audio_buffer = false;
+	uint32_t audio_rate = 0;
+} stream = {};
+
+// The writer thread's output format, fixed by the first frame since
+// YUV4MPEG2 can't change it mid-stream
+static struct {
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> planes = {};
+	// Source column for each output column
+	std::vector<int> source_x = {};
+	int source_width = 0;
+	int source_dblw = -1;
+} stream_out = {};
+
+static inline void decode_pixel(const uint8_t *line, const int x, const int bpp,
+                                const uint8_t *pal, int &r, int &g, int &b)
+{
+	uint16_t pixel = 0;
+	switch (bpp) {
+	case 8:
+		r = pal[line[x] * 4 + 0];
+		g = pal[line[x] * 4 + 1];
+		b = pal[line[x] * 4 + 2];
+		break;
+	case 15:
+		memcpy(&pixel, line + x * 2, sizeof(pixel));
+		b = ((pixel & 0x001f) * 0x21) >> 2;
+		g = ((pixel & 0x03e0) * 0x21) >> 7;
+		r = ((pixel & 0x7c00) * 0x21) >> 12;
+		break;
+	case 16:
+		memcpy(&pixel, line + x * 2, sizeof(pixel));
+		b = ((pixel & 0x001f) * 0x21) >> 2;
+		g = ((pixel & 0x07e0) * 0x41) >> 9;
+		r = ((pixel & 0xf800) * 0x21) >> 13;
+		break;
+	case 24:
+		b = line[x * 3 + 0];
+		g = line[x * 3 + 1];
+		r = line[x * 3 + 2];
+		break;
+	default:
+		b = line[x * 4 + 0];
+		g = line[x * 4 + 1];
+		r = line[x * 4 + 2];
+		break;
+	}
+}
+
+// Converts a queued frame to planar BT.601 YUV 4:4:4 and writes it as a
+// YUV4MPEG2 frame. Frames of another size than the first are scaled to it.
+static bool write_video_frame(FILE *file, const stream_buffer_t &buffer)
+{
+	StreamFrameHeader header;
+	memcpy(&header, buffer.data(), sizeof(header));
+	const uint8_t *pal = buffer.data() + sizeof(header);
+	const uint8_t *pixels = pal + stream_palette_size;
+	const auto line_bytes = static_cast<size_t>(header.width *
+	                                            ((header.bpp + 7) / 8));
+
+	const auto dblw = (header.flags & CAPTURE_FLAG_DBLW) ? 1 : 0;
+	const auto dblh = (header.flags & CAPTURE_FLAG_DBLH) ? 1 : 0;
+	const auto src_width = header.width << dblw;
+	const auto src_height = header.height << dblh;
+
+	auto &out = stream_out;
+	if (!out.width) {
+		out.width = src_width;
+		out.height = src_height;
+		out.planes.resize(static_cast<size_t>(out.width * out.height * 3));
+		fprintf(file, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C444\n", out.width,
+		        out.height, static_cast<int>(header.fps * 1000.0f + 0.5f));
+	}
+	if (out.source_width != src_width || out.source_dblw != dblw) {
+		out.source_width = src_width;
+		out.source_dblw = dblw;
+		out.source_x.resize(static_cast<size_t>(out.width));
+		for (int x = 0; x < out.width; ++x)
+			out.source_x[x] = (x * src_width / out.width) >> dblw;
+	}
+
+	const auto plane_size = static_cast<size_t>(out.width * out.height);
+	uint8_t *y_plane = out.planes.data();
+	uint8_t *u_plane = y_plane + plane_size;
+	uint8_t *v_plane = u_plane + plane_size;
+	for (int y = 0; y < out.height; ++y) {
+		const auto row = (y * src_height / out.height) >> dblh;
+		const uint8_t *line = pixels + row * line_bytes;
+		for (int x = 0; x < out.width; ++x) {
+			int r = 0, g = 0, b = 0;
+			decode_pixel(line, out.source_x[x], header.bpp, pal, r, g, b);
+			*y_plane++ = static_cast<uint8_t>(
+			        ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+			*u_plane++ = static_cast<uint8_t>(
+			        ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			*v_plane++ = static_cast<uint8_t>(
+			        ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+	}
+	fputs("FRAME\n", file);
+	fwrite(out.planes.data(), 1, out.planes.size(), file);
+	return !ferror(file);
+}
+
+static bool write_audio_block(FILE *file, const stream_buffer_t &buffer)
+{
+	fwrite(buffer.data(), 1, buffer.size(), file);
+	return !ferror(file);
+}
+
+void CAPTURE_StreamStart(const std::string &video_target,
+                         const std::string &audio_target)
+{
+	if (video_target.empty() && audio_target.empty())
+		return;
+#if !defined(WIN32)
+	// A reader going away should end the stream, not DOSBox
+	signal(SIGPIPE, SIG_IGN);
+#endif
+	// Only the configured streams get their full frames or converted
+	// samples
+	if (!video_target.empty()) {
+		stream.video = std::make_unique<CaptureStream>("video", video_target,
+		                                               write_video_frame);
+		CaptureState |= CAPTURE_STREAM_VIDEO;
+	}
+	if (!audio_target.empty()) {
+		stream.audio = std::make_unique<CaptureStream>("audio", audio_target,
+		                                               write_audio_block);
+		CaptureState |= CAPTURE_STREAM_AUDIO;
+	}
+}
+
+void CAPTURE_StreamStop()
+{
+	if (stream.audio && stream.has_audio_buffer &&
+	    !stream.audio_buffer.empty())
+		stream.audio->Submit(std::move(stream.audio_buffer));
+	stream.has_audio_buffer = false;
+	stream.video.reset();
+	stream.audio.reset();
+	CaptureState &= ~(CAPTURE_STREAM_VIDEO | CAPTURE_STREAM_AUDIO);
+}
+
+void CAPTURE_StreamImage(int width, int height, int bpp, int pitch,
+                         uint8_t flags, float fps, const uint8_t *data,
+                         const uint8_t *pal)
+{
+	if (!stream.video || !stream.video->IsOpen())
+		return;
+	const auto line_bytes = static_cast<size_t>(width * ((bpp + 7) / 8));
+	auto buffer = stream.video->GetBuffer();
+	buffer.resize(sizeof(StreamFrameHeader) + stream_palette_size +
+	              line_bytes * static_cast<size_t>(height));
+
+	StreamFrameHeader header;
+	header.width = width;
+	header.height = height;
+	header.bpp = bpp;
+	header.flags = flags;
+	header.fps = fps;
+	uint8_t *dest = buffer.data();
+	memcpy(dest, &header, sizeof(header));
+	dest += sizeof(header);
+	memcpy(dest, pal, stream_palette_size);
+	dest += stream_palette_size;
+	for (int y = 0; y < height; ++y, dest += line_bytes)
+		memcpy(dest, data + y * pitch, line_bytes);
+
+	stream.video->Submit(std::move(buffer));
+}
+
+void CAPTURE_StreamWave(uint32_t freq, uint32_t len, const int16_t *data)
+{
+	if (!stream.audio || !stream.audio->IsOpen())
+		return;
+	if (!stream.audio_rate) {
+		stream.audio_rate = freq;
+		LOG_MSG("CAPTURE: The audio stream is %u Hz 16-bit little-endian stereo PCM",
+		        freq);
+	}
+	if (!stream.has_audio_buffer) {
+		stream.audio_buffer = stream.audio->GetBuffer();
+		stream.has_audio_buffer = true;
+	}
+	// The mixer has already converted the samples to little-endian, as
+	// for WAV and AVI capture, so they're copied as they are
+	auto &buffer = stream.audio_buffer;
+	const auto bytes = static_cast<size_t>(len) * 2 * sizeof(int16_t);
+	const auto used = buffer.size();
+	buffer.resize(used + bytes);
+	memcpy(buffer.data() + used, data, bytes);
+
+	if (buffer.size() >= stream_audio_block * 2 * sizeof(int16_t)) {
+		stream.audio->Submit(std::move(buffer));
+		stream.has_audio_buffer = false;
+	}
+}
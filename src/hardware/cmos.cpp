@@ -26,6 +26,7 @@
 #include "inout.h"
 #include "mem.h"
 #include "pic.h"
+#include "replay.h"
 #include "setup.h"
 #include "timer.h"
 
@@ -137,7 +138,7 @@ static uint8_t cmos_readreg(io_port_t, io_width_t)
 	Bitu drive_a, drive_b;
 	uint8_t hdparm;
 
-	const time_t curtime = time(nullptr);
+	const time_t curtime = REPLAY_GetTime();
 	struct tm datetime;
 	cross::localtime_r(&curtime, &datetime);
 
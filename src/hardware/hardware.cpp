@@ -346,6 +346,8 @@ void CAPTURE_AddImage([[maybe_unused]] int width,
                       [[maybe_unused]] uint8_t *data,
                       [[maybe_unused]] uint8_t *pal)
 {
+	if (CaptureState & CAPTURE_STREAM_VIDEO)
+		CAPTURE_StreamImage(width, height, bpp, pitch, flags, fps, data, pal);
 #if (C_SSHOT)
 	uint8_t doubleRow[SCALER_MAXWIDTH * 4];
 	auto countWidth = width;
@@ -663,6 +665,8 @@ static uint8_t wavheader[]={
 };
 
 void CAPTURE_AddWave(uint32_t freq, uint32_t len, int16_t * data) {
+	if (CaptureState & CAPTURE_STREAM_AUDIO)
+		CAPTURE_StreamWave(freq, len, data);
 #if (C_SSHOT)
 	if (CaptureState & CAPTURE_VIDEO) {
 		Bitu left = WAVE_BUF - capture.video.audioused;
@@ -822,6 +826,8 @@ public:
 		Prop_path* proppath= section->Get_path("captures");
 		capturedir = proppath->realpath;
 		CaptureState = 0;
+		CAPTURE_StreamStart(section->Get_string("capture_video_stream"),
+		                    section->Get_string("capture_audio_stream"));
 		MAPPER_AddHandler(CAPTURE_WaveEvent, SDL_SCANCODE_F6,
 		                  PRIMARY_MOD, "recwave", "Rec. Audio");
 		MAPPER_AddHandler(CAPTURE_MidiEvent, SDL_SCANCODE_UNKNOWN, 0,
@@ -834,6 +840,7 @@ public:
 #endif
 	}
 	~HARDWARE(){
+		CAPTURE_StreamStop();
 #if (C_SSHOT)
 		if (capture.video.handle) CAPTURE_VideoEvent(true);
 #endif
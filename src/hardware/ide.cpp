@@ -35,6 +35,7 @@ static void ide_altio_w(io_port_t port, io_val_t val, io_width_t width);
 static uint32_t ide_altio_r(io_port_t port, io_width_t width);
 static void ide_baseio_w(io_port_t port, io_val_t val, io_width_t width);
 static uint32_t ide_baseio_r(io_port_t port, io_width_t width);
+static size_t ide_baseio_read_block(io_port_t port, uint8_t *dest, size_t count, io_width_t width);
 bool GetMSCDEXDrive(uint8_t drive_letter, CDROM_Interface **_cdrom);
 
 enum IDEDeviceType { IDE_TYPE_NONE, IDE_TYPE_HDD = 1, IDE_TYPE_CDROM };
@@ -150,6 +151,7 @@ public:
 	virtual void writecommand(uint8_t cmd);
 	virtual uint32_t data_read(io_width_t width);          /* read from 1F0h data port from IDE device */
 	virtual void data_write(uint32_t v, io_width_t width); /* write to 1F0h data port to IDE device */
+	virtual size_t data_read_block(uint8_t *dest, size_t count, io_width_t width); /* REP INS from 1F0h */
 	virtual bool command_interruption_ok(uint8_t cmd);
 	virtual void abort_silent();
 };
@@ -174,6 +176,7 @@ public:
 	void update_from_biosdisk();
 	virtual uint32_t data_read(io_width_t width);          /* read from 1F0h data port from IDE device */
 	virtual void data_write(uint32_t v, io_width_t width); /* write to 1F0h data port to IDE device */
+	virtual size_t data_read_block(uint8_t *dest, size_t count, io_width_t width); /* REP INS from 1F0h */
 	virtual void generate_identify_device();
 	virtual void prepare_read(uint32_t offset, uint32_t size);
 	virtual void prepare_write(uint32_t offset, uint32_t size);
@@ -1862,6 +1865,23 @@ uint32_t IDEATADevice::data_read(io_width_t width)
 	return w;
 }
 
+/* Serves a run of data port reads straight from the sector buffer. The last
+ * value of the buffer is left to data_read(), which completes the transfer. */
+size_t IDEATADevice::data_read_block(uint8_t *dest, size_t count, io_width_t width)
+{
+	if (state != IDE_DEV_DATA_READ || !(status & IDE_STATUS_DRQ))
+		return 0;
+
+	const auto size = static_cast<uint8_t>(width);
+	if (sector_i + size >= sector_total)
+		return 0;
+	count = std::min(count, static_cast<size_t>((sector_total - sector_i) / size - 1));
+
+	memcpy(dest, sector + sector_i, count * size);
+	sector_i += check_cast<uint32_t>(count * size);
+	return count;
+}
+
 void IDEATADevice::data_write(uint32_t v, io_width_t width)
 {
 	if (state != IDE_DEV_DATA_WRITE) {
@@ -3405,6 +3425,11 @@ uint32_t IDEDevice::data_read(io_width_t)
 void IDEDevice::data_write(io_val_t, io_width_t)
 {}
 
+size_t IDEDevice::data_read_block(uint8_t *, size_t, io_width_t)
+{
+	return 0;
+}
+
 /* IDE controller -> upon writing bit 2 of alt (0x3F6) */
 void IDEDevice::host_reset_complete()
 {
@@ -3834,6 +3859,7 @@ void IDEController::install_io_ports()
 			WriteHandler[i].Install(base_io + i, ide_baseio_w, io_width_t::dword);
 			ReadHandler[i].Install(base_io + i, ide_baseio_r, io_width_t::dword);
 		}
+		IO_RegisterBlockReadHandler(base_io, ide_baseio_read_block);
 	}
 
 	if (alt_io != 0) {
@@ -3849,6 +3875,7 @@ void IDEController::uninstall_io_ports()
 {
 	// Uninstall the eight sets of base I/O ports
 	assert(base_io != 0);
+	IO_FreeBlockReadHandler(base_io);
 	for (auto & h : WriteHandler)
 		h.Uninstall();
 	for (auto & h : ReadHandler)
@@ -3988,6 +4015,20 @@ static uint32_t ide_baseio_r(io_port_t port, io_width_t width)
 	return ret;
 }
 
+static size_t ide_baseio_read_block(io_port_t port, uint8_t *dest, size_t count, io_width_t width)
+{
+	IDEController *ide = match_ide_controller(port);
+	if (ide == nullptr)
+		return 0;
+
+	/* 32-bit PIO that is split or ignored keeps going through ide_baseio_r() */
+	if (width == io_width_t::dword && (!ide->enable_pio32 || ide->ignore_pio32))
+		return 0;
+
+	IDEDevice *dev = ide->device[ide->select];
+	return (dev != nullptr) ? dev->data_read_block(dest, count, width) : 0;
+}
+
 static void ide_baseio_w(io_port_t port, io_val_t val, io_width_t width)
 {
 	IDEController *ide = match_ide_controller(port);
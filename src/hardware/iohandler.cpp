@@ -21,6 +21,7 @@
 
 #include "inout.h"
 
+#include <algorithm>
 #include <cassert>
 #include <limits>
 #include <cstring>
@@ -28,6 +29,7 @@
 
 #include "setup.h"
 #include "cpu.h"
+#include "paging.h"
 #include "../src/cpu/lazyflags.h"
 #include "callback.h"
 
@@ -41,6 +43,8 @@ extern std::unordered_map<io_port_t, io_write_f> io_write_handlers[io_widths];
 uint8_t read_byte_from_port(const io_port_t port);
 uint16_t read_word_from_port(const io_port_t port);
 uint32_t read_dword_from_port(const io_port_t port);
+size_t read_block_from_port(const io_port_t port, uint8_t *dest,
+                            const size_t count, const io_width_t width);
 void write_byte_to_port(const io_port_t port, const uint8_t val);
 void write_word_to_port(const io_port_t port, const uint16_t val);
 void write_dword_to_port(const io_port_t port, const uint32_t val);
@@ -389,6 +393,33 @@ uint32_t IO_ReadD(io_port_t port)
 	return retval;
 }
 
+size_t IO_ReadBlock(io_port_t port, uint32_t lin_addr, size_t count, io_width_t width)
+{
+	// ports trapped by a virtual 8086 monitor are read one at a time
+	const auto size = static_cast<uint8_t>(width);
+	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port, size))))
+		return 0;
+
+	// only plain memory can be written directly, the next page might
+	// not be
+	const HostPt tlb_addr = get_tlb_write(lin_addr);
+	if (!tlb_addr)
+		return 0;
+	count = std::min(count, static_cast<size_t>((4096 - (lin_addr & 4095)) / size));
+	if (!count)
+		return 0;
+
+	const auto done = read_block_from_port(port, tlb_addr + lin_addr, count, width);
+
+	// the same virtual time as reading the values one by one
+	auto delaycyc = static_cast<int64_t>(done) * (CPU_CycleMax / IODELAY_READ_MICROSk);
+	if (GCC_UNLIKELY(delaycyc > CPU_Cycles))
+		delaycyc = CPU_Cycles;
+	CPU_Cycles -= static_cast<int32_t>(delaycyc);
+	CPU_IODelayRemoved += delaycyc;
+	return done;
+}
+
 
 class IO final : public Module_base {
 public:
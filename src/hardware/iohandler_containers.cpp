@@ -197,6 +197,27 @@ void IO_FreeWriteHandler(io_port_t port,
 	}
 }
 
+std::unordered_map<io_port_t, io_block_read_f> io_block_read_handlers = {};
+
+size_t read_block_from_port(const io_port_t port, uint8_t *dest,
+                            const size_t count, const io_width_t width)
+{
+	const auto reader = io_block_read_handlers.find(port);
+	return reader != io_block_read_handlers.end()
+	               ? reader->second(port, dest, count, width)
+	               : 0;
+}
+
+void IO_RegisterBlockReadHandler(const io_port_t port, const io_block_read_f handler)
+{
+	io_block_read_handlers[port] = handler;
+}
+
+void IO_FreeBlockReadHandler(const io_port_t port)
+{
+	io_block_read_handlers.erase(port);
+}
+
 void IO_ReadHandleObject::Install(const io_port_t port,
                                   const io_read_f handler,
                                   const io_width_t max_width,
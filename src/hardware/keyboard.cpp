@@ -24,6 +24,7 @@
 #include "pic.h"
 #include "mem.h"
 #include "mixer.h"
+#include "replay.h"
 #include "timer.h"
 #include "support.h"
 
@@ -299,7 +300,7 @@ static uint8_t read_p64(io_port_t, io_width_t)
 	return status;
 }
 
-void KEYBOARD_AddKey(KBD_KEYS keytype,bool pressed) {
+static void add_key(KBD_KEYS keytype, bool pressed) {
 	uint8_t ret=0;bool extend=false;
 	switch (keytype) {
 	case KBD_esc:ret=1;break;
@@ -452,10 +453,16 @@ void KEYBOARD_AddKey(KBD_KEYS keytype,bool pressed) {
 	KEYBOARD_AddBuffer(ret);
 }
 
+void KEYBOARD_AddKey(KBD_KEYS keytype, bool pressed)
+{
+	if (REPLAY_AcceptKey(keytype, pressed))
+		add_key(keytype, pressed);
+}
+
 static void KEYBOARD_TickHandler(void) {
 	if (keyb.repeat.wait) {
 		keyb.repeat.wait--;
-		if (!keyb.repeat.wait) KEYBOARD_AddKey(keyb.repeat.key,true);
+		if (!keyb.repeat.wait) add_key(keyb.repeat.key,true);
 	}
 }
 
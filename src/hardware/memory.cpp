@@ -19,6 +19,7 @@
 
 #include "mem.h"
 
+#include <algorithm>
 #include <string.h>
 
 #include "inout.h"
@@ -194,11 +195,53 @@ void MEM_BlockRead(PhysPt pt,void * data,Bitu size) {
 void MEM_BlockWrite(PhysPt pt, const void *data, size_t size)
 {
 	const uint8_t *read = static_cast<const uint8_t *>(data);
-	while (size--) {
-		mem_writeb_inline(pt++,*read++);
+	while (size) {
+		// copy a page at a time where it is plain memory, the first
+		// write through the handler maps it if it can be
+		size_t chunk = std::min(size, static_cast<size_t>(4096 - (pt & 4095)));
+		HostPt tlb_addr = get_tlb_write(pt);
+		if (!tlb_addr) {
+			mem_writeb_inline(pt++, *read++);
+			--size;
+			--chunk;
+			tlb_addr = get_tlb_write(pt);
+			if (!tlb_addr) {
+				while (chunk--) {
+					mem_writeb_inline(pt++, *read++);
+					--size;
+				}
+				continue;
+			}
+		}
+		memcpy(tlb_addr + pt, read, chunk);
+		pt += static_cast<PhysPt>(chunk);
+		read += chunk;
+		size -= chunk;
 	}
 }
 
+HostPt MEM_GetBlockWritePtr(PhysPt pt, size_t size)
+{
+	HostPt start = nullptr;
+	PhysPt page_pt = pt;
+	while (size) {
+		const size_t chunk = std::min(size, static_cast<size_t>(4096 - (page_pt & 4095)));
+		HostPt tlb_addr = get_tlb_write(page_pt);
+		if (!tlb_addr && PAGING_ForcePageInit(page_pt))
+			tlb_addr = get_tlb_write(page_pt);
+		if (!tlb_addr)
+			return nullptr;
+		const HostPt host = tlb_addr + page_pt;
+		if (!start)
+			start = host;
+		else if (host != start + (page_pt - pt))
+			return nullptr;
+		page_pt += static_cast<PhysPt>(chunk);
+		size -= chunk;
+	}
+	return start;
+}
+
 void MEM_BlockCopy(PhysPt dest,PhysPt src,Bitu size) {
 	mem_memcpy(dest,src,size);
 }
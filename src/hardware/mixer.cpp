@@ -888,7 +888,7 @@ static inline bool Mixer_irq_important()
 {
 	/* In some states correct timing of the irqs is more important than
 	 * non stuttering audo */
-	return (ticksLocked || (CaptureState & (CAPTURE_WAVE|CAPTURE_VIDEO)));
+	return (ticksLocked || (CaptureState & (CAPTURE_WAVE|CAPTURE_VIDEO|CAPTURE_STREAM_AUDIO)));
 }
 
 static constexpr int calc_tickadd(const int freq)
@@ -909,7 +909,7 @@ static void MIXER_MixData(int needed)
 		it.second->Mix(needed);
 	lock.unlock();
 
-	if (CaptureState & (CAPTURE_WAVE | CAPTURE_VIDEO)) {
+	if (CaptureState & (CAPTURE_WAVE | CAPTURE_VIDEO | CAPTURE_STREAM_AUDIO)) {
 		int16_t convert[1024][2];
 		const auto added = check_cast<work_index_t>(std::min(needed - mixer.done, 1024));
 		auto readpos = check_cast<work_index_t>((mixer.pos + mixer.done) & MIXER_BUFMASK);
@@ -0,0 +1,391 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "cpu.h"
+#include "mouse.h"
+#include "pic.h"
+#include "timer.h"
+#include "video.h"
+
+// Log layout. Numbers are little-endian LEB128 varints, so most events take
+// three bytes:
+//   header: "DBREPLAY", version byte, start time in ms since the epoch
+//   event:  ticks since the previous event, event type, payload
+constexpr char replay_magic[] = "DBREPLAY";
+constexpr size_t replay_magic_len = sizeof(replay_magic) - 1;
+constexpr uint8_t replay_version = 1;
+
+enum class ReplayEvent : uint8_t {
+	KeyDown = 0,         // key
+	KeyUp = 1,           // key
+	MouseMove = 2,       // xrel, yrel, x, y as float bits, emulate
+	MouseButtonDown = 3, // button
+	MouseButtonUp = 4,   // button
+	Cycles = 5,          // cycle max, auto-adjust flags
+	End = 6,
+};
+
+constexpr uint8_t cycles_auto_adjust = 0x1;
+constexpr uint8_t cycles_skip_auto_adjust = 0x2;
+
+enum class ReplayMode { Off, Recording, Replaying };
+
+static struct {
+	ReplayMode mode = ReplayMode::Off;
+	bool virtual_clock = false;
+	bool injecting = false;
+	FILE *log = nullptr;
+	FILE *hashes = nullptr;
+	int64_t start_ms = 0;
+	uint32_t last_tick = 0;
+	uint32_t events = 0;
+	uint32_t frames = 0;
+	int64_t host_start = 0;
+
+	// Recording: the last logged cycle setting
+	int32_t cycle_max = -1;
+	uint8_t cycle_flags = 0;
+
+	// Replaying: the tick and type of the next event
+	uint32_t next_tick = 0;
+	ReplayEvent next_type = ReplayEvent::End;
+} replay;
+
+static int64_t host_time_ms()
+{
+	using namespace std::chrono;
+	const auto now = system_clock::now().time_since_epoch();
+	return duration_cast<milliseconds>(now).count();
+}
+
+static void write_varint(uint64_t value)
+{
+	while (value >= 0x80) {
+		fputc(static_cast<int>((value & 0x7f) | 0x80), replay.log);
+		value >>= 7;
+	}
+	fputc(static_cast<int>(value), replay.log);
+}
+
+static bool read_varint(uint64_t &value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		const int c = fgetc(replay.log);
+		if (c == EOF)
+			return false;
+		value |= static_cast<uint64_t>(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+static uint64_t float_to_bits(const float f)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+static float bits_to_float(const uint64_t value)
+{
+	const auto bits = static_cast<uint32_t>(value);
+	float f = 0.0f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static void write_event(const ReplayEvent type)
+{
+	write_varint(PIC_Ticks - replay.last_tick);
+	replay.last_tick = PIC_Ticks;
+	fputc(static_cast<int>(type), replay.log);
+	++replay.events;
+}
+
+static void read_next_event()
+{
+	uint64_t delta = 0;
+	const int type = read_varint(delta) ? fgetc(replay.log) : EOF;
+	if (type == EOF) {
+		// A log cut short by a crash simply ends where it stops
+		replay.next_tick = replay.last_tick;
+		replay.next_type = ReplayEvent::End;
+		return;
+	}
+	replay.last_tick += static_cast<uint32_t>(delta);
+	replay.next_tick = replay.last_tick;
+	replay.next_type = static_cast<ReplayEvent>(type);
+}
+
+// Feeds one logged event to the emulation, returns false if it's malformed
+static bool replay_event(const ReplayEvent type)
+{
+	uint64_t args[4] = {};
+	uint64_t flag = 0;
+	switch (type) {
+	case ReplayEvent::KeyDown:
+	case ReplayEvent::KeyUp:
+		if (!read_varint(args[0]) || args[0] >= KBD_LAST)
+			return false;
+		KEYBOARD_AddKey(static_cast<KBD_KEYS>(args[0]),
+		                type == ReplayEvent::KeyDown);
+		return true;
+	case ReplayEvent::MouseMove:
+		for (auto &arg : args)
+			if (!read_varint(arg))
+				return false;
+		if (!read_varint(flag))
+			return false;
+		Mouse_CursorMoved(bits_to_float(args[0]), bits_to_float(args[1]),
+		                  bits_to_float(args[2]), bits_to_float(args[3]),
+		                  flag != 0);
+		return true;
+	case ReplayEvent::MouseButtonDown:
+	case ReplayEvent::MouseButtonUp:
+		if (!read_varint(args[0]))
+			return false;
+		if (type == ReplayEvent::MouseButtonDown)
+			Mouse_ButtonPressed(static_cast<uint8_t>(args[0]));
+		else
+			Mouse_ButtonReleased(static_cast<uint8_t>(args[0]));
+		return true;
+	case ReplayEvent::Cycles:
+		if (!read_varint(args[0]) || !read_varint(flag))
+			return false;
+		CPU_CycleMax = static_cast<int32_t>(args[0]);
+		CPU_CycleAutoAdjust = (flag & cycles_auto_adjust) != 0;
+		CPU_SkipCycleAutoAdjust = (flag & cycles_skip_auto_adjust) != 0;
+		return true;
+	case ReplayEvent::End: break;
+	}
+	return false;
+}
+
+static void finish_replay()
+{
+	const auto elapsed_ms = GetTicksSince(replay.host_start);
+	LOG_MSG("REPLAY: Replayed %u events over %u ms of emulated time in %d ms (%.1fx)",
+	        replay.events, PIC_Ticks, elapsed_ms,
+	        static_cast<double>(PIC_Ticks) / std::max(elapsed_ms, 1));
+	fclose(replay.log);
+	replay.log = nullptr;
+	replay.mode = ReplayMode::Off;
+	GFX_RequestExit(true);
+}
+
+void REPLAY_StartRecording(const std::string &filename)
+{
+	replay.log = fopen(filename.c_str(), "wb");
+	if (!replay.log) {
+		LOG_WARNING("REPLAY: Can't create '%s', not recording",
+		            filename.c_str());
+		return;
+	}
+	replay.start_ms = host_time_ms();
+	fwrite(replay_magic, 1, replay_magic_len, replay.log);
+	fputc(replay_version, replay.log);
+	write_varint(static_cast<uint64_t>(replay.start_ms));
+
+	replay.mode = ReplayMode::Recording;
+	replay.virtual_clock = true;
+	LOG_MSG("REPLAY: Recording input to '%s'", filename.c_str());
+}
+
+void REPLAY_StartReplay(const std::string &filename)
+{
+	replay.log = fopen(filename.c_str(), "rb");
+	if (!replay.log) {
+		LOG_WARNING("REPLAY: Can't open '%s', not replaying",
+		            filename.c_str());
+		return;
+	}
+	char magic[replay_magic_len] = {};
+	uint64_t start_ms = 0;
+	if (fread(magic, 1, replay_magic_len, replay.log) != replay_magic_len ||
+	    memcmp(magic, replay_magic, replay_magic_len) != 0 ||
+	    fgetc(replay.log) != replay_version || !read_varint(start_ms)) {
+		LOG_WARNING("REPLAY: '%s' is not a supported input log, not replaying",
+		            filename.c_str());
+		fclose(replay.log);
+		replay.log = nullptr;
+		return;
+	}
+	replay.start_ms = static_cast<int64_t>(start_ms);
+	replay.host_start = GetTicks();
+	read_next_event();
+
+	replay.mode = ReplayMode::Replaying;
+	replay.virtual_clock = true;
+	LOG_MSG("REPLAY: Replaying input from '%s'", filename.c_str());
+}
+
+void REPLAY_StartFrameHashes(const std::string &filename)
+{
+	replay.hashes = fopen(filename.c_str(), "w");
+	if (!replay.hashes) {
+		LOG_WARNING("REPLAY: Can't create '%s', not hashing frames",
+		            filename.c_str());
+		return;
+	}
+	LOG_MSG("REPLAY: Writing frame hashes to '%s'", filename.c_str());
+}
+
+void REPLAY_Shutdown(Section * /*sec*/)
+{
+	if (replay.mode == ReplayMode::Recording) {
+		LOG_MSG("REPLAY: Recorded %u events over %u ms of emulated time",
+		        replay.events, PIC_Ticks);
+		write_event(ReplayEvent::End);
+	}
+	if (replay.log) {
+		fclose(replay.log);
+		replay.log = nullptr;
+	}
+	if (replay.hashes) {
+		fclose(replay.hashes);
+		replay.hashes = nullptr;
+	}
+	replay.mode = ReplayMode::Off;
+}
+
+bool REPLAY_IsReplaying()
+{
+	return replay.mode == ReplayMode::Replaying;
+}
+
+bool REPLAY_IsHashingFrames()
+{
+	return replay.hashes != nullptr;
+}
+
+void REPLAY_Tick()
+{
+	if (replay.mode == ReplayMode::Recording) {
+		const uint8_t flags = (CPU_CycleAutoAdjust ? cycles_auto_adjust : 0) |
+		                      (CPU_SkipCycleAutoAdjust ? cycles_skip_auto_adjust : 0);
+		if (CPU_CycleMax != replay.cycle_max || flags != replay.cycle_flags) {
+			write_event(ReplayEvent::Cycles);
+			write_varint(static_cast<uint64_t>(CPU_CycleMax));
+			write_varint(flags);
+			replay.cycle_max = CPU_CycleMax;
+			replay.cycle_flags = flags;
+		}
+		return;
+	}
+	while (replay.mode == ReplayMode::Replaying &&
+	       replay.next_tick <= PIC_Ticks) {
+		if (replay.next_type == ReplayEvent::End) {
+			finish_replay();
+			return;
+		}
+		replay.injecting = true;
+		const bool ok = replay_event(replay.next_type);
+		replay.injecting = false;
+		if (!ok) {
+			LOG_WARNING("REPLAY: Malformed event at tick %u, stopping",
+			            replay.next_tick);
+			finish_replay();
+			return;
+		}
+		++replay.events;
+		read_next_event();
+	}
+}
+
+bool REPLAY_AcceptKey(const KBD_KEYS key, const bool pressed)
+{
+	if (replay.mode == ReplayMode::Recording) {
+		write_event(pressed ? ReplayEvent::KeyDown : ReplayEvent::KeyUp);
+		write_varint(key);
+	}
+	return replay.mode != ReplayMode::Replaying || replay.injecting;
+}
+
+bool REPLAY_AcceptMouseMove(const float xrel, const float yrel, const float x,
+                            const float y, const bool emulate)
+{
+	if (replay.mode == ReplayMode::Recording) {
+		write_event(ReplayEvent::MouseMove);
+		write_varint(float_to_bits(xrel));
+		write_varint(float_to_bits(yrel));
+		write_varint(float_to_bits(x));
+		write_varint(float_to_bits(y));
+		write_varint(emulate ? 1 : 0);
+	}
+	return replay.mode != ReplayMode::Replaying || replay.injecting;
+}
+
+bool REPLAY_AcceptMouseButton(const uint8_t button, const bool pressed)
+{
+	if (replay.mode == ReplayMode::Recording) {
+		write_event(pressed ? ReplayEvent::MouseButtonDown
+		                    : ReplayEvent::MouseButtonUp);
+		write_varint(button);
+	}
+	return replay.mode != ReplayMode::Replaying || replay.injecting;
+}
+
+// 64-bit FNV-1a over the visible part of each line and, for paletted
+// frames, the palette
+void REPLAY_AddFrame(const int width, const int height, const int bpp,
+                     const int pitch, const uint8_t *data, const uint8_t *pal)
+{
+	if (!replay.hashes)
+		return;
+	uint64_t hash = 0xcbf29ce484222325;
+	const auto add = [&hash](const uint8_t *bytes, const size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			hash ^= bytes[i];
+			hash *= 0x100000001b3;
+		}
+	};
+	const auto line_bytes = static_cast<size_t>(width * ((bpp + 7) / 8));
+	for (int y = 0; y < height; ++y)
+		add(data + y * pitch, line_bytes);
+	if (bpp == 8 && pal)
+		add(pal, 256 * 4);
+
+	fprintf(replay.hashes, "%u %u %dx%d %016" PRIx64 "\n", replay.frames++,
+	        PIC_Ticks, width, height, hash);
+}
+
+int64_t REPLAY_GetTimeMs()
+{
+	if (!replay.virtual_clock)
+		return host_time_ms();
+	return replay.start_ms + static_cast<int64_t>(PIC_FullIndex());
+}
+
+int64_t REPLAY_GetTicks()
+{
+	if (!replay.virtual_clock)
+		return GetTicks();
+	return static_cast<int64_t>(PIC_FullIndex());
+}
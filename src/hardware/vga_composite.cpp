@@ -0,0 +1,147 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *  Copyright (C) 2002-2021  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "dosbox.h"
+
+#include "vga_composite.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "render.h"
+
+constexpr int max_hdots = SCALER_MAXWIDTH;
+
+static inline uint32_t byte_clamp(int v)
+{
+	v >>= 13;
+	return static_cast<uint32_t>(std::clamp(v, 0, 255));
+}
+
+// Builds the composite signal with one table lookup per hdot, plus the
+// border colour padding on each side that the filters reach into.
+static void generate_signal(int *signal, const uint8_t *rgbi, const int w,
+                            const uint8_t border, const int *table)
+{
+	const int *b = &table[border * 68];
+	int *o = signal;
+	for (int x = 0; x < 4; ++x)
+		*o++ = b[(x + 3) & 3];
+	*o++ = table[(border << 6) | (rgbi[0] << 2) | 3];
+	for (int x = 0; x < w - 1; ++x)
+		*o++ = table[(rgbi[x] << 6) | (rgbi[x + 1] << 2) | (x & 3)];
+	*o++ = table[(rgbi[w - 1] << 6) | (border << 2) | 3];
+	for (int x = 0; x < 5; ++x)
+		*o++ = b[x & 3];
+}
+
+static void decode_monochrome(uint32_t *out, const int *signal, const int w,
+                              const int sharpness)
+{
+	const int *s = signal + 5;
+	for (int x = 0; x < w; ++x) {
+		const int c = s[x] * 16;
+		const int d = (s[x - 1] + s[x + 1]) * 8;
+		const int y = (c + d) * 256 + sharpness * (c - d);
+		out[x] = byte_clamp(y) * 0x10101;
+	}
+}
+
+static void decode_colour(uint32_t *out, const int *signal, const int w,
+                          const CompositeParams &p)
+{
+	alignas(16) static int chroma_a[max_hdots + 2];
+	alignas(16) static int chroma_b[max_hdots + 2];
+	alignas(16) static int luma[max_hdots + 2];
+
+	// The chroma and luma arrays start one hdot before the visible line
+	const int n = w + 2;
+	const int *s = signal + 4;
+	for (int x = 0; x < n; ++x) {
+		chroma_a[x] = s[x - 4] - (s[x - 2] - s[x] + s[x + 2]) * 2 + s[x + 4];
+		chroma_b[x] = (s[x - 3] - s[x - 1] + s[x + 1] - s[x + 3]) * 2;
+	}
+	for (int x = 0; x < n; ++x)
+		luma[x] = s[x] * 8 - chroma_a[x];
+
+	// The I/Q axes rotate by a quarter turn each hdot: (a, b), (-b, a),
+	// (-a, -b), (b, -a). Fold that into per-phase channel coefficients.
+	const int coef_a[3][4] = {{p.ri, p.rq, -p.ri, -p.rq},
+	                          {p.gi, p.gq, -p.gi, -p.gq},
+	                          {p.bi, p.bq, -p.bi, -p.bq}};
+	const int coef_b[3][4] = {{p.rq, -p.ri, -p.rq, p.ri},
+	                          {p.gq, -p.gi, -p.gq, p.gi},
+	                          {p.bq, -p.bi, -p.bq, p.bi}};
+
+	assert(w % 4 == 0);
+	for (int x = 0; x < w; x += 4) {
+		for (int phase = 0; phase < 4; ++phase) {
+			const int i = x + phase + 1;
+			const int c = luma[i] * 2;
+			const int d = luma[i - 1] + luma[i + 1];
+			const int y = (c + d) * 256 + p.sharpness * (c - d);
+			const int a = chroma_a[i];
+			const int b = chroma_b[i];
+			const int r = y + coef_a[0][phase] * a + coef_b[0][phase] * b;
+			const int g = y + coef_a[1][phase] * a + coef_b[1][phase] * b;
+			const int bl = y + coef_a[2][phase] * a + coef_b[2][phase] * b;
+			out[x + phase] = (byte_clamp(r) << 16) |
+			                 (byte_clamp(g) << 8) | byte_clamp(bl);
+		}
+	}
+}
+
+uint8_t *composite_decode_line(uint8_t *line,
+                               const uint8_t border,
+                               const uint32_t blocks,
+                               const bool doublewidth,
+                               const CompositeParams &params)
+{
+	alignas(16) static int signal[max_hdots + 10];
+	alignas(16) static uint32_t pixels[max_hdots];
+
+	assert(params.table);
+	int w = static_cast<int>(blocks * 4);
+
+	if (doublewidth) {
+		uint8_t *source = line + w - 1;
+		uint8_t *dest = line + w * 2 - 2;
+		for (int x = 0; x < w; ++x) {
+			*dest = *source;
+			*(dest + 1) = *source;
+			--source;
+			dest -= 2;
+		}
+		w *= 2;
+	}
+	assert(w > 0 && w <= max_hdots);
+
+	generate_signal(signal, line, w, border, params.table);
+
+	if (params.is_monochrome)
+		decode_monochrome(pixels, signal, w, params.sharpness);
+	else
+		decode_colour(pixels, signal, w, params);
+
+	memcpy(line, pixels, static_cast<size_t>(w) * sizeof(pixels[0]));
+	return line;
+}
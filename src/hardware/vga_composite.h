@@ -0,0 +1,62 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *  Copyright (C) 2002-2021  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_VGA_COMPOSITE_H
+#define DOSBOX_VGA_COMPOSITE_H
+
+#include <cstdint>
+
+/*
+CGA Composite Decoder
+---------------------
+Simulates the NTSC composite output of the CGA (and Tandy/PCjr) by turning
+a line of 4-bit RGBI hdots into a composite signal, separating chroma with
+two 4-hdot period FIR filters, and converting the YIQ result to RGB.
+
+The colour burst repeats every four hdots, so each of the four phases uses a
+fixed pair of I/Q coefficients per RGB channel. These are precomputed once
+per line, which leaves a branch-free inner loop that the compiler can turn
+into SIMD code.
+*/
+
+struct CompositeParams {
+	// 1024-entry composite level table, indexed by the left and right
+	// RGBI values and the phase: (left << 6) | (right << 2) | phase
+	const int *table = nullptr;
+
+	// Chroma-to-RGB coefficients and the luma sharpness filter strength
+	int ri = 0, rq = 0, gi = 0, gq = 0, bi = 0, bq = 0;
+	int sharpness = 0;
+
+	// Decode only luma (ie: Tandy/PCjr mono composite)
+	bool is_monochrome = false;
+};
+
+// Decodes a line of RGBI hdots in-place into 32-bit 0RGB pixels. The buffer
+// holds 'blocks * 4' hdots (which get doubled first when 'doublewidth' is
+// set) and must have room for four bytes per output pixel.
+uint8_t *composite_decode_line(uint8_t *line,
+                               uint8_t border,
+                               uint32_t blocks,
+                               bool doublewidth,
+                               const CompositeParams &params);
+
+#endif
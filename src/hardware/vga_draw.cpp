@@ -28,6 +28,8 @@
 #include "../gui/render_scalers.h"
 #include "support.h"
 #include "vga.h"
+#include "vga_composite.h"
+#include "vga_draw.h"
 #include "video.h"
 
 //#undef C_DEBUG
@@ -36,12 +38,10 @@
 
 #define VGA_PARTS 4
 
-typedef uint8_t * (* VGA_Line_Handler)(Bitu vidstart, Bitu line);
-
-static VGA_Line_Handler VGA_DrawLine;
+VGA_Line_Handler VGA_DrawLine;
 static uint8_t TempLine[SCALER_MAXWIDTH * 4];
 
-static uint8_t * VGA_Draw_1BPP_Line(Bitu vidstart, Bitu line) {
+uint8_t * VGA_Draw_1BPP_Line(Bitu vidstart, Bitu line) {
 	const uint8_t *base = vga.tandy.draw_base + ((line & vga.tandy.line_mask) << vga.tandy.line_shift);
 
 	uint16_t i = 0;
@@ -53,7 +53,7 @@ static uint8_t * VGA_Draw_1BPP_Line(Bitu vidstart, Bitu line) {
 	return TempLine;
 }
 
-static uint8_t * VGA_Draw_2BPP_Line(Bitu vidstart, Bitu line) {
+uint8_t * VGA_Draw_2BPP_Line(Bitu vidstart, Bitu line) {
 	const uint8_t *base = vga.tandy.draw_base + ((line & vga.tandy.line_mask) << vga.tandy.line_shift);
 
 	uint16_t i = 0;
@@ -125,109 +125,22 @@ static uint8_t *VGA_Draw_CGA16_Line(Bitu vidstart, Bitu line)
 	return TempLine;
 }
 
-static uint8_t byte_clamp(int v)
-{
-	v >>= 13;
-	return v < 0 ? 0u : (v > 255 ? 255u : static_cast<uint8_t>(v));
-}
-
 static uint8_t *Composite_Process(uint8_t border, uint32_t blocks, bool doublewidth)
 {
-	static int temp[SCALER_MAXWIDTH + 10] = {0};
-	static int atemp[SCALER_MAXWIDTH + 2] = {0};
-	static int btemp[SCALER_MAXWIDTH + 2] = {0};
-
-	int w = blocks * 4;
-
-	if (doublewidth) {
-		uint8_t *source = TempLine + w - 1;
-		uint8_t *dest = TempLine + w * 2 - 2;
-		for (int x = 0; x < w; ++x) {
-			*dest = *source;
-			*(dest + 1) = *source;
-			--source;
-			dest -= 2;
-		}
-		blocks *= 2;
-		w *= 2;
-	}
-
-	// Simulate CGA composite output
-	int *o = temp;
-	auto push_pixel = [&o](const int v) {
-		*o = v;
-		++o;
-	};
-
-	uint8_t *rgbi = TempLine;
-	int *b = &CGA_Composite_Table[border * 68];
-	for (int x = 0; x < 4; ++x)
-		push_pixel(b[(x + 3) & 3]);
-	push_pixel(CGA_Composite_Table[(border << 6) | ((*rgbi) << 2) | 3]);
-	for (int x = 0; x < w - 1; ++x) {
-		push_pixel(CGA_Composite_Table[(rgbi[0] << 6) | (rgbi[1] << 2) | (x & 3)]);
-		++rgbi;
-	}
-	push_pixel(CGA_Composite_Table[((*rgbi) << 6) | (border << 2) | 3]);
-	for (int x = 0; x < 5; ++x)
-		push_pixel(b[x & 3]);
-
-	if ((vga.tandy.mode_control & 4) != 0) {
-		// Decode
-		int *i = temp + 5;
-		uint16_t idx = 0;
-		for (uint32_t x = 0; x < blocks * 4; ++x) {
-			int c = (i[0] + i[0]) << 3;
-			int d = (i[-1] + i[1]) << 3;
-			int y = ((c + d) << 8) + vga.sharpness * (c - d);
-			++i;
-			write_unaligned_uint32_at(TempLine, idx++,
-			                          byte_clamp(y) * 0x10101);
-		}
-	} else {
-		// Store chroma
-		int *i = temp + 4;
-		int *ap = atemp + 1;
-		int *bp = btemp + 1;
-		for (int x = -1; x < w + 1; ++x) {
-			ap[x] = i[-4] - left_shift_signed(i[-2] - i[0] + i[2], 1) + i[4];
-			bp[x] = left_shift_signed(i[-3] - i[-1] + i[1] - i[3], 1);
-			++i;
-		}
-
-		// Decode
-		i = temp + 5;
-		i[-1] = (i[-1] << 3) - ap[-1];
-		i[0] = (i[0] << 3) - ap[0];
-
-		uint16_t idx = 0;
-		auto COMPOSITE_CONVERT = [&](const int I, const int Q) {
-			i[1] = (i[1] << 3) - ap[1];
-			const int c = i[0] + i[0];
-			const int d = i[-1] + i[1];
-			const int y = left_shift_signed(c + d, 8) + vga.sharpness * (c - d);
-			const int rr = y + vga.ri * (I) + vga.rq * (Q);
-			const int gg = y + vga.gi * (I) + vga.gq * (Q);
-			const int bb = y + vga.bi * (I) + vga.bq * (Q);
-			++i;
-			++ap;
-			++bp;
-			const auto srgb = (byte_clamp(rr) << 16) |
-			                  (byte_clamp(gg) << 8) | byte_clamp(bb);
-			write_unaligned_uint32_at(TempLine, idx++, srgb);
-		};
-
-		for (uint32_t x = 0; x < blocks; ++x) {
-			COMPOSITE_CONVERT(ap[0], bp[0]);
-			COMPOSITE_CONVERT(-bp[0], ap[0]);
-			COMPOSITE_CONVERT(-ap[0], -bp[0]);
-			COMPOSITE_CONVERT(bp[0], -ap[0]);
-		}
-	}
-	return TempLine;
+	CompositeParams params = {};
+	params.table = CGA_Composite_Table;
+	params.ri = vga.ri;
+	params.rq = vga.rq;
+	params.gi = vga.gi;
+	params.gq = vga.gq;
+	params.bi = vga.bi;
+	params.bq = vga.bq;
+	params.sharpness = vga.sharpness;
+	params.is_monochrome = (vga.tandy.mode_control & 4) != 0;
+	return composite_decode_line(TempLine, border, blocks, doublewidth, params);
 }
 
-static uint8_t *VGA_TEXT_Draw_Line(Bitu vidstart, Bitu line);
+uint8_t *VGA_TEXT_Draw_Line(Bitu vidstart, Bitu line);
 
 static uint8_t *VGA_CGA_TEXT_Composite_Draw_Line(Bitu vidstart, Bitu line)
 {
@@ -242,7 +155,7 @@ static uint8_t *VGA_Draw_CGA2_Composite_Line(Bitu vidstart, Bitu line)
 	return Composite_Process(0, vga.draw.blocks * 2, false);
 }
 
-static uint8_t *VGA_Draw_CGA4_Composite_Line(Bitu vidstart, Bitu line)
+uint8_t *VGA_Draw_CGA4_Composite_Line(Bitu vidstart, Bitu line)
 {
 	VGA_Draw_2BPP_Line(vidstart, line);
 	return Composite_Process(vga.tandy.color_select & 0x0f, vga.draw.blocks, true);
@@ -306,7 +219,7 @@ static uint8_t * VGA_Draw_Changes_Line(Bitu vidstart, Bitu line) {
 
 #endif
 
-static uint8_t * VGA_Draw_Linear_Line(Bitu vidstart, Bitu /*line*/) {
+uint8_t * VGA_Draw_Linear_Line(Bitu vidstart, Bitu /*line*/) {
 	Bitu offset = vidstart & vga.draw.linear_mask;
 	uint8_t* ret = &vga.draw.linear_base[offset];
 	
@@ -338,7 +251,7 @@ static uint8_t * VGA_Draw_Linear_Line(Bitu vidstart, Bitu /*line*/) {
 	return ret;
 }
 
-static uint8_t *VGA_Draw_Xlat16_Linear_Line(Bitu vidstart, Bitu /*line*/)
+uint8_t *VGA_Draw_Xlat16_Linear_Line(Bitu vidstart, Bitu /*line*/)
 {
 	const auto offset = vidstart & vga.draw.linear_mask;
 	const uint8_t *ret = &vga.draw.linear_base[offset];
@@ -380,151 +293,115 @@ static uint8_t *VGA_Draw_Xlat16_Linear_Line(Bitu vidstart, Bitu /*line*/)
 	return TempLine;
 } */
 
-static uint8_t * VGA_Draw_VGA_Line_HWMouse( Bitu vidstart, Bitu /*line*/) {
-	if (!svga.hardware_cursor_active || !svga.hardware_cursor_active())
-		// HW Mouse not enabled, use the tried and true call
-		return &vga.mem.linear[vidstart];
+// S3 hardware cursor
+// ------------------
+// The cursor is a 64x64 pattern which is shifted (inside the 64x64 mouse
+// cursor space) to the right by posx pixels and up by posy pixels. This is
+// used when the mouse cursor partially leaves the screen. The pattern is 1kB
+// of video memory at startaddr, where every 16 pixels of a row are stored as
+// 16 bits of bitA followed by 16 bits of bitB, each AB bit pair selecting
+// the operation for one pixel.
+//
+// Lines that the cursor doesn't cover are returned straight from video
+// memory. The pattern is decoded into vga.s3.hgc.mc once and only decoded
+// again when its address is changed or, as checked once per frame, when its
+// contents differ from the copy it was decoded from.
+
+enum HWCursorOp : uint8_t {
+	HWCURSOR_BACK = 0,        // A=0 B=0: background color
+	HWCURSOR_FORE = 1,        // A=0 B=1: foreground color
+	HWCURSOR_TRANSPARENT = 2, // A=1 B=0: screen data
+	HWCURSOR_INVERT = 3,      // A=1 B=1: inverted screen data
+};
+
+constexpr size_t HWCURSOR_PATTERN_SIZE = (64 * 64 * 2) / 8;
+
+static struct {
+	uint8_t pattern[HWCURSOR_PATTERN_SIZE] = {};
+	bool checked = false; // the pattern was compared during this frame
+} hwcursor_cache;
+
+static void VGA_DecodeHWCursor()
+{
+	auto &hgc = vga.s3.hgc;
+	if (hwcursor_cache.checked && !hgc.mc_dirty)
+		return;
+	hwcursor_cache.checked = true;
 
-	Bitu lineat = (vidstart-(vga.config.real_start<<2)) / vga.draw.width;
-	if ((vga.s3.hgc.posx >= vga.draw.width) ||
-		(lineat < vga.s3.hgc.originy) || 
-		(lineat > (vga.s3.hgc.originy + (63U-vga.s3.hgc.posy))) ) {
-		// the mouse cursor *pattern* is not on this line
-		return &vga.mem.linear[ vidstart ];
-	} else {
-		// Draw mouse cursor: cursor is a 64x64 pattern which is shifted (inside the
-		// 64x64 mouse cursor space) to the right by posx pixels and up by posy pixels.
-		// This is used when the mouse cursor partially leaves the screen.
-		// It is arranged as bitmap of 16bits of bitA followed by 16bits of bitB, each
-		// AB bits corresponding to a cursor pixel. The whole map is 8kB in size.
-		memcpy(TempLine, &vga.mem.linear[ vidstart ], vga.draw.width);
-		// the index of the bit inside the cursor bitmap we start at:
-		Bitu sourceStartBit = ((lineat - vga.s3.hgc.originy) + vga.s3.hgc.posy)*64 + vga.s3.hgc.posx; 
-		// convert to video memory addr and bit index
-		// start adjusted to the pattern structure (thus shift address by 2 instead of 3)
-		// Need to get rid of the third bit, so "/8 *2" becomes ">> 2 & ~1"
-		Bitu cursorMemStart = ((sourceStartBit >> 2)& ~1) + (((uint32_t)vga.s3.hgc.startaddr) << 10);
-		Bitu cursorStartBit = sourceStartBit & 0x7;
-		// stay at the right position in the pattern
-		if (cursorMemStart & 0x2)
-			--cursorMemStart;
-		Bitu cursorMemEnd = cursorMemStart + ((64-vga.s3.hgc.posx) >> 2);
-		uint8_t* xat = &TempLine[vga.s3.hgc.originx]; // mouse data start pos. in scanline
-		for (Bitu m = cursorMemStart; m < cursorMemEnd;
-		     (m & 1) ? (m += 3) : ++m) {
-			// for each byte of cursor data
-			uint8_t bitsA = vga.mem.linear[m];
-			uint8_t bitsB = vga.mem.linear[m+2];
-			for (uint8_t bit=(0x80 >> cursorStartBit); bit != 0; bit >>= 1) {
-				// for each bit
-				cursorStartBit=0; // only the first byte has some bits cut off
-				if (bitsA&bit) {
-					if (bitsB&bit) *xat ^= 0xFF; // Invert screen data
-					//else Transparent
-				} else if (bitsB&bit) {
-					*xat = vga.s3.hgc.forestack[0]; // foreground color
-				} else {
-					*xat = vga.s3.hgc.backstack[0];
-				}
-				xat++;
-			}
+	const uint8_t *pattern = &vga.mem.linear[((uint32_t)hgc.startaddr) << 10];
+	if (!hgc.mc_dirty &&
+	    !memcmp(hwcursor_cache.pattern, pattern, HWCURSOR_PATTERN_SIZE))
+		return;
+	hgc.mc_dirty = false;
+	memcpy(hwcursor_cache.pattern, pattern, HWCURSOR_PATTERN_SIZE);
+
+	for (int y = 0; y < 64; ++y) {
+		for (int x = 0; x < 64; ++x) {
+			const uint8_t *bits = &pattern[y * 16 + (x / 16) * 4 + ((x / 8) & 1)];
+			const uint8_t mask = 0x80 >> (x & 7);
+			const bool a = bits[0] & mask;
+			const bool b = bits[2] & mask;
+			hgc.mc[y][x] = static_cast<uint8_t>((a << 1) | b);
 		}
-		return TempLine;
 	}
 }
 
-static uint8_t * VGA_Draw_LIN16_Line_HWMouse(Bitu vidstart, Bitu /*line*/) {
+// Returns the line of video memory at vidstart, with the cursor drawn over
+// it if it covers the line. T is the pixel type, invert the bits flipped by
+// inverted cursor pixels.
+template <typename T>
+static uint8_t *VGA_Draw_HWMouse_Line(Bitu vidstart, const T invert)
+{
 	if (!svga.hardware_cursor_active || !svga.hardware_cursor_active())
+		// HW Mouse not enabled, use the tried and true call
 		return &vga.mem.linear[vidstart];
 
-	Bitu lineat = ((vidstart-(vga.config.real_start<<2)) >> 1) / vga.draw.width;
-	if ((vga.s3.hgc.posx >= vga.draw.width) ||
-		(lineat < vga.s3.hgc.originy) || 
-		(lineat > (vga.s3.hgc.originy + (63U-vga.s3.hgc.posy))) ) {
+	const auto &hgc = vga.s3.hgc;
+	const Bitu lineat = ((vidstart - (vga.config.real_start << 2)) / sizeof(T)) /
+	                    vga.draw.width;
+	if ((hgc.posx >= vga.draw.width) || (lineat < hgc.originy) ||
+	    (lineat > (hgc.originy + (63U - hgc.posy)))) {
+		// the mouse cursor *pattern* is not on this line
 		return &vga.mem.linear[vidstart];
-	} else {
-		memcpy(TempLine, &vga.mem.linear[ vidstart ], vga.draw.width*2);
-		Bitu sourceStartBit = ((lineat - vga.s3.hgc.originy) + vga.s3.hgc.posy)*64 + vga.s3.hgc.posx; 
- 		Bitu cursorMemStart = ((sourceStartBit >> 2)& ~1) + (((uint32_t)vga.s3.hgc.startaddr) << 10);
-		Bitu cursorStartBit = sourceStartBit & 0x7;
-		if (cursorMemStart & 0x2) cursorMemStart--;
-		Bitu cursorMemEnd = cursorMemStart + ((64-vga.s3.hgc.posx) >> 2);
-
-		uint16_t i = vga.s3.hgc.originx;
-		for (Bitu m = cursorMemStart; m < cursorMemEnd;
-		     (m & 1) ? (m += 3) : ++m) {
-			// for each byte of cursor data
-			uint8_t bitsA = vga.mem.linear[m];
-			uint8_t bitsB = vga.mem.linear[m+2];
-			for (uint8_t bit=(0x80 >> cursorStartBit); bit != 0; bit >>= 1) {
-				// for each bit
-				cursorStartBit=0;
-				if (bitsA&bit) {
-					// byte order doesn't matter here as all bits get flipped
-					if (bitsB & bit) {
-						const auto xat = read_unaligned_uint16_at(TempLine, i);
-						write_unaligned_uint16_at(TempLine, i, xat ^ 0xffff);
-					}
-					// else Transparent
-				} else if (bitsB & bit) {
-					// Source as well as destination are uint8_t arrays, 
-					// so this should work out endian-wise?
-					const auto fore = read_unaligned_uint16(vga.s3.hgc.forestack);
-					write_unaligned_uint16_at(TempLine, i, fore);
-				} else {
-					const auto back = read_unaligned_uint16(vga.s3.hgc.backstack);
-					write_unaligned_uint16_at(TempLine, i, back);
-				}
-				++i;
-			}
+	}
+
+	VGA_DecodeHWCursor();
+	memcpy(TempLine, &vga.mem.linear[vidstart], vga.draw.width * sizeof(T));
+
+	T fore, back;
+	memcpy(&fore, hgc.forestack, sizeof(T));
+	memcpy(&back, hgc.backstack, sizeof(T));
+
+	const Bitu count = 64 - hgc.posx;
+	const uint8_t *ops = &hgc.mc[(lineat - hgc.originy) + hgc.posy][hgc.posx];
+	uint8_t *xat = &TempLine[hgc.originx * sizeof(T)];
+	for (Bitu i = 0; i < count; ++i, xat += sizeof(T)) {
+		T pixel;
+		switch (ops[i]) {
+		case HWCURSOR_BACK: pixel = back; break;
+		case HWCURSOR_FORE: pixel = fore; break;
+		case HWCURSOR_INVERT:
+			memcpy(&pixel, xat, sizeof(T));
+			pixel ^= invert;
+			break;
+		default: continue;
 		}
-		return TempLine;
+		memcpy(xat, &pixel, sizeof(T));
 	}
+	return TempLine;
 }
 
-static uint8_t * VGA_Draw_LIN32_Line_HWMouse(Bitu vidstart, Bitu /*line*/) {
-	if (!svga.hardware_cursor_active || !svga.hardware_cursor_active())
-		return &vga.mem.linear[vidstart];
+uint8_t * VGA_Draw_VGA_Line_HWMouse( Bitu vidstart, Bitu /*line*/) {
+	return VGA_Draw_HWMouse_Line<uint8_t>(vidstart, 0xff);
+}
 
-	Bitu lineat = ((vidstart-(vga.config.real_start<<2)) >> 2) / vga.draw.width;
-	if ((vga.s3.hgc.posx >= vga.draw.width) ||
-		(lineat < vga.s3.hgc.originy) || 
-		(lineat > (vga.s3.hgc.originy + (63U-vga.s3.hgc.posy))) ) {
-		return &vga.mem.linear[ vidstart ];
-	} else {
-		memcpy(TempLine, &vga.mem.linear[ vidstart ], vga.draw.width*4);
-		Bitu sourceStartBit = ((lineat - vga.s3.hgc.originy) + vga.s3.hgc.posy)*64 + vga.s3.hgc.posx; 
-		Bitu cursorMemStart = ((sourceStartBit >> 2)& ~1) + (((uint32_t)vga.s3.hgc.startaddr) << 10);
-		Bitu cursorStartBit = sourceStartBit & 0x7;
-		if (cursorMemStart & 0x2)
-			--cursorMemStart;
-		Bitu cursorMemEnd = cursorMemStart + ((64-vga.s3.hgc.posx) >> 2);
-		uint16_t i = vga.s3.hgc.originx;
-		for (Bitu m = cursorMemStart; m < cursorMemEnd;
-		     (m & 1) ? (m += 3) : ++m) {
-			// for each byte of cursor data
-			uint8_t bitsA = vga.mem.linear[m];
-			uint8_t bitsB = vga.mem.linear[m+2];
-			for (uint8_t bit=(0x80 >> cursorStartBit); bit != 0; bit >>= 1) { // for each bit
-				cursorStartBit=0;
-				if (bitsA&bit) {
-					if (bitsB & bit) {
-						const auto xat = read_unaligned_uint32_at(TempLine, i);
-						write_unaligned_uint32_at(TempLine, i, xat ^ 0xffff);
-					}
-					// else Transparent
-				} else if (bitsB & bit) {
-					const auto fore = read_unaligned_uint32(vga.s3.hgc.forestack);
-					write_unaligned_uint32_at(TempLine, i, fore);
-				} else {
-					const auto back = read_unaligned_uint32(vga.s3.hgc.backstack);
-					write_unaligned_uint32_at(TempLine, i, back);
-				}
-				++i;
-			}
-		}
-		return TempLine;
-	}
+uint8_t * VGA_Draw_LIN16_Line_HWMouse(Bitu vidstart, Bitu /*line*/) {
+	return VGA_Draw_HWMouse_Line<uint16_t>(vidstart, 0xffff);
+}
+
+uint8_t * VGA_Draw_LIN32_Line_HWMouse(Bitu vidstart, Bitu /*line*/) {
+	// only the low 16 bits get inverted, as they always have been
+	return VGA_Draw_HWMouse_Line<uint32_t>(vidstart, 0xffff);
 }
 
 static const uint8_t* VGA_Text_Memwrap(Bitu vidstart) {
@@ -548,7 +425,7 @@ static bool SkipCursor(Bitu vidstart, Bitu line)
 }
 
 static uint32_t FontMask[2]={0xffffffff,0x0};
-static uint8_t *VGA_TEXT_Draw_Line(Bitu vidstart, Bitu line)
+uint8_t *VGA_TEXT_Draw_Line(Bitu vidstart, Bitu line)
 {
 	uint16_t i = 0;
 	const uint8_t* vidmem = VGA_Text_Memwrap(vidstart);
@@ -631,7 +508,7 @@ static uint8_t *VGA_TEXT_Herc_Draw_Line(Bitu vidstart, Bitu line)
 	return TempLine;
 }
 // combined 8/9-dot wide text mode 16bpp line drawing function
-static uint8_t *VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line)
+uint8_t *VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line)
 {
 	// keep it aligned:
 	uint16_t idx = 16 - vga.draw.panning;
@@ -694,6 +571,54 @@ static uint8_t *VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line)
 	return TempLine + 32;
 }
 
+// Lines that only show video memory nobody wrote to since the last drawn
+// frame are handed to the renderer as empty, it keeps what it has cached
+static uint8_t *VGA_Draw_Dirty_Line(Bitu vidstart, Bitu line)
+{
+	const Bitu offset = vidstart & vga.draw.linear_mask;
+	const Bitu end = offset + vga.draw.line_length;
+	if (end <= vga.draw.linear_mask + 1) {
+		const auto last = (end - 1) >> vga_dirty_page_shift;
+		bool dirty = false;
+		for (auto page = offset >> vga_dirty_page_shift; page <= last; ++page)
+			dirty |= (vga.dirty.pages[page] != 0);
+		if (!dirty)
+			return nullptr;
+	}
+	return VGA_Draw_Linear_Line(vidstart, line);
+}
+
+// Pages written during the frame now becoming visible stay dirty until that
+// frame has been completely drawn
+void VGA_DirtyFrameStart()
+{
+	for (auto &page : vga.dirty.pages)
+		if (page & vga_dirty_written)
+			page = vga_dirty_pending;
+
+	if (VGA_DrawLine == VGA_Draw_Dirty_Line)
+		VGA_DrawLine = VGA_Draw_Linear_Line;
+	const bool plain_lines = vga.draw.mode == PART &&
+	                         vga.draw.linear_base == vga.mem.linear &&
+	                         VGA_DrawLine == VGA_Draw_Linear_Line;
+	const bool same_layout = vga.dirty.plain_lines && plain_lines &&
+	                         vga.dirty.address == vga.draw.address &&
+	                         vga.dirty.address_add == vga.draw.address_add &&
+	                         vga.dirty.split_line == vga.draw.split_line;
+	vga.dirty.plain_lines = plain_lines;
+	vga.dirty.address = vga.draw.address;
+	vga.dirty.address_add = vga.draw.address_add;
+	vga.dirty.split_line = vga.draw.split_line;
+	if (same_layout && vga.dirty.tracking && !render.fullFrame)
+		VGA_DrawLine = VGA_Draw_Dirty_Line;
+}
+
+static void VGA_DirtyFrameEnd()
+{
+	for (auto &page : vga.dirty.pages)
+		page &= ~vga_dirty_pending;
+}
+
 #ifdef VGA_KEEP_CHANGES
 static inline void VGA_ChangesEnd(void ) {
 	if ( vga.changes.active ) {
@@ -830,7 +755,7 @@ static void VGA_DrawEGASingleLine(uint32_t /*blah*/)
 	} else RENDER_EndUpdate(false);
 }
 
-static void VGA_DrawPart(uint32_t lines)
+void VGA_DrawPart(uint32_t lines)
 {
 	while (lines--) {
 		uint8_t * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );
@@ -860,6 +785,7 @@ static void VGA_DrawPart(uint32_t lines)
 #ifdef VGA_KEEP_CHANGES
 		VGA_ChangesEnd();
 #endif
+		VGA_DirtyFrameEnd();
 		RENDER_EndUpdate(false);
 	}
 }
@@ -935,6 +861,8 @@ static void VGA_PanningLatch(uint32_t /*val*/)
 static void VGA_VerticalTimer(uint32_t /*val*/)
 {
 	vga.draw.delay.framestart = PIC_FullIndex();
+	hwcursor_cache.checked = false;
+	VGA_ProtectDirtyPages();
 	PIC_AddEvent(VGA_VerticalTimer, vga.draw.delay.vtotal);
 
 	switch(machine) {
@@ -1068,6 +996,7 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 #ifdef VGA_KEEP_CHANGES
 	if (startaddr_changed) VGA_ChangesStart();
 #endif
+	VGA_DirtyFrameStart();
 
 	// check if some lines at the top off the screen are blanked
 	double draw_skip = 0.0;
@@ -1162,6 +1091,8 @@ void VGA_ActivateHardwareCursor(void) {
 		if (svga.hardware_cursor_active()) hwcursor_active=true;
 	}
 	if (hwcursor_active) {
+		// the cursor is drawn over lines whose memory doesn't change
+		vga.dirty.plain_lines = false;
 		switch(vga.mode) {
 		case M_LIN32:
 			VGA_DrawLine=VGA_Draw_LIN32_Line_HWMouse;
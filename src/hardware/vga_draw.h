@@ -0,0 +1,53 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_VGA_DRAW_H
+#define DOSBOX_VGA_DRAW_H
+
+#include "dosbox.h"
+
+// The line handlers VGA_SetupDrawing picks from and the drawing of the
+// frame, for the tests and benchmarks that drive them without the timing
+// events
+
+typedef uint8_t *(*VGA_Line_Handler)(Bitu vidstart, Bitu line);
+
+// The current mode's line handler
+extern VGA_Line_Handler VGA_DrawLine;
+
+uint8_t *VGA_Draw_1BPP_Line(Bitu vidstart, Bitu line);
+uint8_t *VGA_Draw_2BPP_Line(Bitu vidstart, Bitu line);
+uint8_t *VGA_Draw_CGA4_Composite_Line(Bitu vidstart, Bitu line);
+uint8_t *VGA_Draw_Linear_Line(Bitu vidstart, Bitu line);
+uint8_t *VGA_Draw_Xlat16_Linear_Line(Bitu vidstart, Bitu line);
+uint8_t *VGA_Draw_VGA_Line_HWMouse(Bitu vidstart, Bitu line);
+uint8_t *VGA_Draw_LIN16_Line_HWMouse(Bitu vidstart, Bitu line);
+uint8_t *VGA_Draw_LIN32_Line_HWMouse(Bitu vidstart, Bitu line);
+uint8_t *VGA_TEXT_Draw_Line(Bitu vidstart, Bitu line);
+uint8_t *VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line);
+
+// Draws the next 'lines' lines of the frame set up in vga.draw
+void VGA_DrawPart(uint32_t lines);
+
+// Decides which lines of the SVGA linear modes can be skipped this frame,
+// see VGA_Dirty in vga.h
+void VGA_DirtyFrameStart();
+
+#endif
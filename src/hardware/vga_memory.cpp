@@ -19,6 +19,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
 #include "dosbox.h"
 #include "mem.h"
 #include "mem_host.h"
@@ -557,6 +558,88 @@ public:
 	}
 };
 
+// Linear pages opened for direct writes since the last vertical timer
+static std::vector<Bitu> unprotected_pages = {};
+
+// Writes normally reach the dirty tracking handlers by linear address, but
+// can also arrive by physical address. The TLB entry for 'addr' translates it
+// only when it belongs to the handler and maps into the handler's pages.
+static bool VGA_IsMappedWrite(const PageHandler *handler, PhysPt addr,
+                              Bitu first_page, Bitu pages)
+{
+	if (get_tlb_writehandler(addr) != handler)
+		return false;
+	const Bitu phys_page = PAGING_GetPhysicalPage(addr) >> 12;
+	return phys_page - first_page < pages;
+}
+
+// Marks the page holding 'offset' as written and, when the write came in
+// by a linear address mapped to it, lets further writes to that linear page
+// go straight to video memory until VGA_ProtectDirtyPages() closes it again.
+static void VGA_OpenDirtyPage(bool mapped, PhysPt addr, Bitu offset)
+{
+	vga.dirty.pages[offset >> vga_dirty_page_shift] |= vga_dirty_written;
+	if (!mapped)
+		return;
+	const Bitu lin_page = addr >> 12;
+	PAGING_MakePageWritable(lin_page, &vga.mem.linear[offset & ~0xfff]);
+	unprotected_pages.push_back(lin_page);
+}
+
+void VGA_ProtectDirtyPages(void)
+{
+	for (const auto lin_page : unprotected_pages)
+		PAGING_UnlinkPages(lin_page, 1);
+	unprotected_pages.clear();
+}
+
+// The banked window of the SVGA linear modes. Reads are mapped directly,
+// writes only trap until the page has been marked dirty for this frame.
+class VGA_DirtyMap_Handler final : public PageHandler {
+public:
+	VGA_DirtyMap_Handler() {
+		flags=PFLAG_READABLE|PFLAG_NOCODE;
+	}
+	HostPt GetHostReadPt(Bitu phys_page) {
+		phys_page-=vgapages.base;
+		return &vga.mem.linear[CHECKED3(vga.svga.bank_read_full+phys_page*4096)];
+	}
+	void writeb(PhysPt addr, uint8_t val)
+	{
+		const bool mapped = IsMapped(addr);
+		const Bitu offset = WriteOffset(addr, mapped);
+		host_writeb(&vga.mem.linear[offset], val);
+		VGA_OpenDirtyPage(mapped, addr, offset);
+	}
+	void writew(PhysPt addr, uint16_t val)
+	{
+		const bool mapped = IsMapped(addr);
+		const Bitu offset = WriteOffset(addr, mapped);
+		host_writew(&vga.mem.linear[offset], val);
+		VGA_OpenDirtyPage(mapped, addr, offset);
+	}
+	void writed(PhysPt addr, uint32_t val)
+	{
+		const bool mapped = IsMapped(addr);
+		const Bitu offset = WriteOffset(addr, mapped);
+		host_writed(&vga.mem.linear[offset], val);
+		VGA_OpenDirtyPage(mapped, addr, offset);
+	}
+
+private:
+	bool IsMapped(PhysPt addr) const
+	{
+		return VGA_IsMappedWrite(this, addr, vgapages.base,
+		                         (vgapages.mask + 1) >> 12);
+	}
+	static Bitu WriteOffset(PhysPt addr, bool mapped)
+	{
+		if (mapped)
+			addr = PAGING_GetPhysicalAddress(addr);
+		return CHECKED3(vga.svga.bank_write_full + (addr & vgapages.mask));
+	}
+};
+
 class VGA_Map_Handler final : public PageHandler {
 public:
 	VGA_Map_Handler() {
@@ -741,17 +824,50 @@ public:
 	}
 };
 
+// Maps the linear framebuffer directly for reading, while writes only trap
+// until the page has been marked dirty for this frame
 class VGA_LFB_Handler final : public PageHandler {
 public:
 	VGA_LFB_Handler() {
-		flags=PFLAG_READABLE|PFLAG_WRITEABLE|PFLAG_NOCODE;
+		flags=PFLAG_READABLE|PFLAG_NOCODE;
 	}
 	HostPt GetHostReadPt( Bitu phys_page ) {
 		phys_page -= vga.lfb.page;
 		return &vga.mem.linear[CHECKED3(phys_page * 4096)];
 	}
-	HostPt GetHostWritePt( Bitu phys_page ) {
-		return GetHostReadPt( phys_page );
+	void writeb(PhysPt addr, uint8_t val)
+	{
+		const bool mapped = IsMapped(addr);
+		const Bitu offset = WriteOffset(addr, mapped);
+		host_writeb(&vga.mem.linear[offset], val);
+		VGA_OpenDirtyPage(mapped, addr, offset);
+	}
+	void writew(PhysPt addr, uint16_t val)
+	{
+		const bool mapped = IsMapped(addr);
+		const Bitu offset = WriteOffset(addr, mapped);
+		host_writew(&vga.mem.linear[offset], val);
+		VGA_OpenDirtyPage(mapped, addr, offset);
+	}
+	void writed(PhysPt addr, uint32_t val)
+	{
+		const bool mapped = IsMapped(addr);
+		const Bitu offset = WriteOffset(addr, mapped);
+		host_writed(&vga.mem.linear[offset], val);
+		VGA_OpenDirtyPage(mapped, addr, offset);
+	}
+
+private:
+	bool IsMapped(PhysPt addr) const
+	{
+		return VGA_IsMappedWrite(this, addr, vga.lfb.page,
+		                         vga.vmemsize >> 12);
+	}
+	static Bitu WriteOffset(PhysPt addr, bool mapped)
+	{
+		if (mapped)
+			addr = PAGING_GetPhysicalAddress(addr);
+		return CHECKED3(addr - vga.lfb.addr);
 	}
 };
 
@@ -873,6 +989,7 @@ public:
 
 static struct vg {
 	VGA_Map_Handler map = {};
+	VGA_DirtyMap_Handler dirtymap = {};
 	VGA_Changes_Handler changes = {};
 	VGA_TEXT_PageHandler text = {};
 	VGA_TANDY_PageHandler tandy = {};
@@ -965,7 +1082,7 @@ void VGA_SetupHandlers(void) {
 	case M_LIN24:
 	case M_LIN32:
 #ifdef VGA_LFB_MAPPED
-		newHandler = &vgaph.map;
+		newHandler = &vgaph.dirtymap;
 #else
 		newHandler = &vgaph.changes;
 #endif
@@ -977,7 +1094,7 @@ void VGA_SetupHandlers(void) {
 				newHandler = &vgaph.cvga;
 			else 
 #ifdef VGA_LFB_MAPPED
-				newHandler = &vgaph.map;
+				newHandler = &vgaph.dirtymap;
 #else
 				newHandler = &vgaph.changes;
 #endif
@@ -1037,6 +1154,7 @@ void VGA_SetupHandlers(void) {
 		MEM_SetPageHandler( VGA_PAGE_B0, 8, &vgaph.empty );
 		break;
 	}
+	vga.dirty.tracking = (newHandler == &vgaph.dirtymap);
 	if(svgaCard == SVGA_S3Trio && (vga.s3.ext_mem_ctrl & 0x10))
 		MEM_SetPageHandler(VGA_PAGE_A0, 16, &vgaph.mmio);
 range_done:
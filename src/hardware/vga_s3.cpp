@@ -141,10 +141,12 @@ void SVGA_S3_WriteCRTC(io_port_t reg, io_val_t value, io_width_t)
 			                                // if read back of this address is ever implemented this needs to change
 			LOG(LOG_VGAMISC,LOG_NORMAL)("VGA:S3:CRTC: HGC pattern address beyond video memory" );
 		}
+		vga.s3.hgc.mc_dirty = true;
 		break;
 	case 0x4d:  /* HGC start address low byte*/
 		vga.s3.hgc.startaddr &=0xff00;
 		vga.s3.hgc.startaddr |= (val & 0xff);
+		vga.s3.hgc.mc_dirty = true;
 		break;
 	case 0x4e:  /* HGC pattern start X */
 		vga.s3.hgc.posx = val & 0x3f;	// bits 0-5
@@ -18,6 +18,7 @@
 
 #include "dosbox.h"
 
+#include <algorithm>
 #include <cassert>
 #include <math.h>
 #include <stdio.h>
@@ -156,18 +157,22 @@ void XGA_DrawPoint(Bitu x, Bitu y, Bitu c) {
 		case M_LIN8:
 			if (GCC_UNLIKELY(memaddr >= vga.vmemsize)) break;
 			vga.mem.linear[memaddr] = c;
+			VGA_MarkDirty(memaddr, 1);
 			break;
 		case M_LIN15:
 			if (GCC_UNLIKELY(memaddr*2 >= vga.vmemsize)) break;
 			((uint16_t*)(vga.mem.linear))[memaddr] = (uint16_t)(c&0x7fff);
+			VGA_MarkDirty(memaddr * 2, 2);
 			break;
 		case M_LIN16:
 			if (GCC_UNLIKELY(memaddr*2 >= vga.vmemsize)) break;
 			((uint16_t*)(vga.mem.linear))[memaddr] = (uint16_t)(c&0xffff);
+			VGA_MarkDirty(memaddr * 2, 2);
 			break;
 		case M_LIN32:
 			if (GCC_UNLIKELY(memaddr*4 >= vga.vmemsize)) break;
 			((uint32_t*)(vga.mem.linear))[memaddr] = c;
+			VGA_MarkDirty(memaddr * 4, 4);
 			break;
 		default:
 			break;
@@ -254,6 +259,353 @@ static Bitu GetMixResult(uint32_t mixmode, Bitu srcval, Bitu dstdata)
 	return destval;
 }
 
+// Span kernels
+// ------------
+// Rectangle fills, blits and pattern fills with the foreground mix are
+// drawn a line at a time by kernels specialised for the pixel size and the
+// mix, chosen once per command. They are only used when the destination
+// rectangle, clipped to the scissors, and its source lie completely within
+// video memory; everything else (and all commands whose result depends on
+// the pixel data) still goes through XGA_GetPoint/XGA_DrawPoint.
+
+template <uint32_t mix>
+static inline uint32_t MixPixel(const uint32_t src, const uint32_t dst)
+{
+	switch (mix) {
+	case 0x00: return ~dst;
+	case 0x01: return 0;
+	case 0x02: return 0xffffffff;
+	case 0x03: return dst;
+	case 0x04: return ~src;
+	case 0x05: return src ^ dst;
+	case 0x06: return ~(src ^ dst);
+	case 0x07: return src;
+	case 0x08: return ~(src & dst);
+	case 0x09: return (~src) | dst;
+	case 0x0a: return src | (~dst);
+	case 0x0b: return src | dst;
+	case 0x0c: return src & dst;
+	case 0x0d: return src & (~dst);
+	case 0x0e: return (~src) & dst;
+	default: return ~(src | dst);
+	}
+}
+
+// the mixes that don't depend on the destination
+static constexpr bool MixIgnoresDest(const uint32_t mix)
+{
+	return mix == 0x01 || mix == 0x02 || mix == 0x04 || mix == 0x07;
+}
+
+// Each kernel processes len pixels, starting at dst and stepping by dir
+// (+1 or -1) like the per-pixel loops do. Stored values are masked like
+// XGA_DrawPoint masks them.
+template <typename T, uint32_t mix>
+static void XGA_FillSpan(T *dst, const Bits len, const Bits dir,
+                         const uint32_t src, const uint32_t mask)
+{
+	if constexpr (MixIgnoresDest(mix)) {
+		const auto val = static_cast<T>(MixPixel<mix>(src, 0) & mask);
+		std::fill_n(dir > 0 ? dst : dst - (len - 1), len, val);
+	} else {
+		// leaving the destination as it is still masks it
+		if (mix == 0x03 && mask == static_cast<T>(~0u))
+			return;
+		for (Bits i = 0; i < len; ++i, dst += dir)
+			*dst = static_cast<T>(MixPixel<mix>(src, *dst) & mask);
+	}
+}
+
+template <typename T, uint32_t mix>
+static void XGA_CopySpan(T *dst, const T *src, const Bits len,
+                         const Bits dir, const uint32_t mask)
+{
+	if constexpr (mix == 0x07) {
+		// a plain copy behaves like memmove unless the destination
+		// runs into source pixels that still have to be read
+		const bool smears = dir > 0 ? (dst > src && dst < src + len)
+		                            : (dst < src && dst > src - len);
+		if (mask == static_cast<T>(~0u) && !smears) {
+			if (dir > 0)
+				memmove(dst, src, len * sizeof(T));
+			else
+				memmove(dst - (len - 1), src - (len - 1), len * sizeof(T));
+			return;
+		}
+	}
+	for (Bits i = 0; i < len; ++i, dst += dir, src += dir)
+		*dst = static_cast<T>(MixPixel<mix>(*src, *dst) & mask);
+}
+
+// pattern holds the 8 pixels of the pattern line, indexed by x & 7
+template <typename T, uint32_t mix>
+static void XGA_PatternSpan(T *dst, const T *pattern, Bits x, const Bits len,
+                            const Bits dir, const uint32_t mask)
+{
+	for (Bits i = 0; i < len; ++i, dst += dir, x += dir)
+		*dst = static_cast<T>(MixPixel<mix>(pattern[x & 7], *dst) & mask);
+}
+
+#define XGA_MIX_TABLE(kernel, T) \
+	{kernel<T, 0x0>, kernel<T, 0x1>, kernel<T, 0x2>, kernel<T, 0x3>, \
+	 kernel<T, 0x4>, kernel<T, 0x5>, kernel<T, 0x6>, kernel<T, 0x7>, \
+	 kernel<T, 0x8>, kernel<T, 0x9>, kernel<T, 0xa>, kernel<T, 0xb>, \
+	 kernel<T, 0xc>, kernel<T, 0xd>, kernel<T, 0xe>, kernel<T, 0xf>}
+
+// The destination of a command clipped to the scissors: the first pixel in
+// drawing order, how many pixels and lines are left and how many were
+// skipped at the start, which also applies to the source.
+struct XGA_ClippedRect {
+	Bits x = 0, y = 0;
+	Bits width = 0, height = 0;
+	Bits skipx = 0, skipy = 0;
+};
+
+// Clips one axis, returns false if the range can't be handled by the span
+// kernels
+static bool XGA_ClipAxis(const Bits start, const Bits count, const Bits dir,
+                         const Bits lo, const Bits hi, Bits &first,
+                         Bits &len, Bits &skip)
+{
+	const Bits from = dir > 0 ? start : start - (count - 1);
+	const Bits to = from + count - 1;
+	if (from < 0)
+		return false;
+	const Bits clip_from = std::max(from, lo);
+	const Bits clip_to = std::min(to, hi);
+	len = std::max<Bits>(clip_to - clip_from + 1, 0);
+	skip = dir > 0 ? clip_from - from : to - clip_to;
+	first = dir > 0 ? clip_from : clip_to;
+	return true;
+}
+
+// Returns the number of bytes per pixel of the current mode, or 0 if the
+// command can't be drawn with the span kernels
+static Bitu XGA_ClipRect(const Bits x, const Bits y, const Bits width,
+                         const Bits height, const Bits dx, const Bits dy,
+                         XGA_ClippedRect &rect)
+{
+	Bitu bpp = 0;
+	switch (XGA_COLOR_MODE) {
+	case M_LIN8: bpp = 1; break;
+	case M_LIN15:
+	case M_LIN16: bpp = 2; break;
+	case M_LIN32: bpp = 4; break;
+	default: return 0;
+	}
+	if (!XGA_ClipAxis(x, width, dx, xga.scissors.x1, xga.scissors.x2,
+	                  rect.x, rect.width, rect.skipx) ||
+	    !XGA_ClipAxis(y, height, dy, xga.scissors.y1, xga.scissors.y2,
+	                  rect.y, rect.height, rect.skipy))
+		return 0;
+	return bpp;
+}
+
+// Checks that a rectangle of pixels lies completely within video memory
+static bool XGA_InVideoMemory(const Bits x, const Bits y, const Bits width,
+                              const Bits height, const Bits dx,
+                              const Bits dy, const Bitu bpp)
+{
+	if (width <= 0 || height <= 0)
+		return true;
+	const Bits left = dx > 0 ? x : x - (width - 1);
+	const Bits top = dy > 0 ? y : y - (height - 1);
+	if (left < 0 || top < 0)
+		return false;
+	const auto last = static_cast<Bitu>((top + height - 1) * XGA_SCREEN_WIDTH +
+	                                    left + width - 1);
+	return (last + 1) * bpp <= vga.vmemsize;
+}
+
+static uint32_t XGA_StoreMask()
+{
+	switch (XGA_COLOR_MODE) {
+	case M_LIN8: return 0xff;
+	case M_LIN15: return 0x7fff;
+	case M_LIN16: return 0xffff;
+	default: return 0xffffffff;
+	}
+}
+
+template <typename T>
+static T *XGA_PixelPtr(const Bits x, const Bits y)
+{
+	return reinterpret_cast<T *>(vga.mem.linear) + y * XGA_SCREEN_WIDTH + x;
+}
+
+// The span kernels write video memory behind the page handlers' back, so
+// the renderer has to be told which part of it changed
+static void XGA_MarkDirtyRect(const XGA_ClippedRect &rect, const Bits dx,
+                              const Bits dy, const Bitu bpp)
+{
+	if (rect.width <= 0 || rect.height <= 0)
+		return;
+	const Bits left = dx > 0 ? rect.x : rect.x - (rect.width - 1);
+	const Bits top = dy > 0 ? rect.y : rect.y - (rect.height - 1);
+	const Bits bottom = top + rect.height - 1;
+	const auto first = static_cast<uint32_t>((top * XGA_SCREEN_WIDTH + left) * bpp);
+	const auto end = static_cast<uint32_t>(
+	        (bottom * XGA_SCREEN_WIDTH + left + rect.width) * bpp);
+	VGA_MarkDirty(first, end - first);
+}
+
+// XGA_DrawPoint doesn't draw at all unless these command bits are set
+static bool XGA_CommandDraws()
+{
+	return (xga.curcommand & 0x1) && (xga.curcommand & 0x10);
+}
+
+template <typename T>
+static void XGA_FillRectSpans(const XGA_ClippedRect &rect, const Bits dx,
+                              const Bits dy, const uint32_t mix,
+                              const uint32_t src)
+{
+	using fill_fn = void (*)(T *, Bits, Bits, uint32_t, uint32_t);
+	static constexpr fill_fn fills[16] = XGA_MIX_TABLE(XGA_FillSpan, T);
+	const auto fill = fills[mix & 0xf];
+	const auto mask = XGA_StoreMask();
+	for (Bits line = 0; line < rect.height; ++line)
+		fill(XGA_PixelPtr<T>(rect.x, rect.y + line * dy), rect.width,
+		     dx, src, mask);
+}
+
+// Fills width x height pixels starting at x/y with the foreground mix and
+// a color source, returns false if the per-pixel code has to do it
+static bool XGA_FillRectWithSpans(const Bits x, const Bits y, const Bits width,
+                                  const Bits height, const Bits dx, const Bits dy)
+{
+	if ((xga.pix_cntl >> 6) & 0x3)
+		return false;
+	const uint32_t mixmode = xga.foremix;
+	uint32_t src = 0;
+	switch ((mixmode >> 5) & 0x03) {
+	case 0x00: src = xga.backcolor; break;
+	case 0x01: src = xga.forecolor; break;
+	default: return false;
+	}
+	if (!XGA_CommandDraws())
+		return true;
+
+	XGA_ClippedRect rect;
+	const auto bpp = XGA_ClipRect(x, y, width, height, dx, dy, rect);
+	if (!bpp || !XGA_InVideoMemory(rect.x, rect.y, rect.width,
+	                               rect.height, dx, dy, bpp))
+		return false;
+
+	switch (bpp) {
+	case 1: XGA_FillRectSpans<uint8_t>(rect, dx, dy, mixmode, src); break;
+	case 2: XGA_FillRectSpans<uint16_t>(rect, dx, dy, mixmode, src); break;
+	case 4: XGA_FillRectSpans<uint32_t>(rect, dx, dy, mixmode, src); break;
+	}
+	XGA_MarkDirtyRect(rect, dx, dy, bpp);
+	return true;
+}
+
+template <typename T>
+static void XGA_BlitRectSpans(const XGA_ClippedRect &rect, const Bits srcx,
+                              const Bits srcy, const Bits dx, const Bits dy,
+                              const uint32_t mix)
+{
+	using copy_fn = void (*)(T *, const T *, Bits, Bits, uint32_t);
+	static constexpr copy_fn copies[16] = XGA_MIX_TABLE(XGA_CopySpan, T);
+	const auto copy = copies[mix & 0xf];
+	const auto mask = XGA_StoreMask();
+	for (Bits line = 0; line < rect.height; ++line)
+		copy(XGA_PixelPtr<T>(rect.x, rect.y + line * dy),
+		     XGA_PixelPtr<T>(srcx, srcy + line * dy), rect.width, dx, mask);
+}
+
+// Draws XGA_BlitRect, returns false if the per-pixel code has to do it
+static bool XGA_BlitRectWithSpans(const Bits dx, const Bits dy)
+{
+	const Bits width = xga.MAPcount + 1;
+	const Bits height = xga.MIPcount + 1;
+	if ((xga.pix_cntl >> 6) & 0x3)
+		return false;
+	const uint32_t mixmode = xga.foremix;
+	if (((mixmode >> 5) & 0x03) != 0x03)
+		return XGA_FillRectWithSpans(xga.destx, xga.desty, width, height, dx, dy);
+	if (!XGA_CommandDraws())
+		return true;
+
+	XGA_ClippedRect rect;
+	const auto bpp = XGA_ClipRect(xga.destx, xga.desty, width, height, dx, dy, rect);
+	if (!bpp)
+		return false;
+	const Bits srcx = xga.curx + rect.skipx * dx;
+	const Bits srcy = xga.cury + rect.skipy * dy;
+	if (!XGA_InVideoMemory(rect.x, rect.y, rect.width, rect.height, dx, dy, bpp) ||
+	    !XGA_InVideoMemory(srcx, srcy, rect.width, rect.height, dx, dy, bpp))
+		return false;
+
+	switch (bpp) {
+	case 1: XGA_BlitRectSpans<uint8_t>(rect, srcx, srcy, dx, dy, mixmode); break;
+	case 2: XGA_BlitRectSpans<uint16_t>(rect, srcx, srcy, dx, dy, mixmode); break;
+	case 4: XGA_BlitRectSpans<uint32_t>(rect, srcx, srcy, dx, dy, mixmode); break;
+	}
+	XGA_MarkDirtyRect(rect, dx, dy, bpp);
+	return true;
+}
+
+template <typename T>
+static void XGA_PatternRectSpans(const XGA_ClippedRect &rect, const Bits patx,
+                                 const Bits paty, const Bits dx,
+                                 const Bits dy, const uint32_t mix)
+{
+	using pattern_fn = void (*)(T *, const T *, Bits, Bits, Bits, uint32_t);
+	static constexpr pattern_fn patterns[16] = XGA_MIX_TABLE(XGA_PatternSpan, T);
+	const auto draw = patterns[mix & 0xf];
+	const auto mask = XGA_StoreMask();
+	for (Bits line = 0; line < rect.height; ++line) {
+		const Bits y = rect.y + line * dy;
+		const T *pattern = XGA_PixelPtr<T>(patx, paty + (y & 7));
+		draw(XGA_PixelPtr<T>(rect.x, y), pattern, rect.x, rect.width, dx, mask);
+	}
+}
+
+// Draws XGA_DrawPattern, returns false if the per-pixel code has to do it
+static bool XGA_DrawPatternWithSpans(const Bits dx, const Bits dy)
+{
+	const Bits width = xga.MAPcount + 1;
+	const Bits height = xga.MIPcount + 1;
+	if ((xga.pix_cntl >> 6) & 0x3)
+		return false;
+	const uint32_t mixmode = xga.foremix;
+	if (((mixmode >> 5) & 0x03) != 0x03)
+		return XGA_FillRectWithSpans(xga.destx, xga.desty, width, height, dx, dy);
+	if (!XGA_CommandDraws())
+		return true;
+
+	XGA_ClippedRect rect;
+	const auto bpp = XGA_ClipRect(xga.destx, xga.desty, width, height, dx, dy, rect);
+	if (!bpp || !XGA_InVideoMemory(rect.x, rect.y, rect.width, rect.height, dx, dy, bpp) ||
+	    !XGA_InVideoMemory(xga.curx, xga.cury, 8, 8, 1, 1, bpp))
+		return false;
+	if (rect.width <= 0 || rect.height <= 0)
+		return true;
+
+	// the pattern is read while drawing, so it must not be drawn over
+	const auto address = [](const Bits x, const Bits y) {
+		return y * XGA_SCREEN_WIDTH + x;
+	};
+	const Bits left = dx > 0 ? rect.x : rect.x - (rect.width - 1);
+	const Bits top = dy > 0 ? rect.y : rect.y - (rect.height - 1);
+	const Bits dest_first = address(left, top);
+	const Bits dest_last = address(left + rect.width - 1, top + rect.height - 1);
+	const Bits pattern_first = address(xga.curx, xga.cury);
+	const Bits pattern_last = address(xga.curx + 7, xga.cury + 7);
+	if (pattern_first <= dest_last && dest_first <= pattern_last)
+		return false;
+
+	switch (bpp) {
+	case 1: XGA_PatternRectSpans<uint8_t>(rect, xga.curx, xga.cury, dx, dy, mixmode); break;
+	case 2: XGA_PatternRectSpans<uint16_t>(rect, xga.curx, xga.cury, dx, dy, mixmode); break;
+	case 4: XGA_PatternRectSpans<uint32_t>(rect, xga.curx, xga.cury, dx, dy, mixmode); break;
+	}
+	XGA_MarkDirtyRect(rect, dx, dy, bpp);
+	return true;
+}
+
 static void XGA_DrawLineVector(const uint32_t val, const bool skip_last_pixel)
 {
 	// No work to do with a zero-length line
@@ -515,6 +867,12 @@ static void XGA_DrawRectangle(const uint32_t val, const bool skip_last_pixel)
 	// one pixel too wide (but don't underflow below zero).
 	const auto xrun = xga.MAPcount - (xga.MAPcount && skip_last_pixel);
 
+	if (XGA_FillRectWithSpans(xga.curx, xga.cury, xrun + 1, xga.MIPcount + 1, dx, dy)) {
+		xga.curx = static_cast<uint16_t>(xga.curx + (xrun + 1) * dx);
+		xga.cury = static_cast<uint16_t>(xga.cury + (xga.MIPcount + 1) * dy);
+		return;
+	}
+
 	for (auto yat = 0; yat <= xga.MIPcount; ++yat) {
 		srcx = xga.curx;
 		for (auto xat = 0; xat <= xrun; ++xat) {
@@ -803,6 +1161,9 @@ void XGA_BlitRect(Bitu val) {
 	if(((val >> 5) & 0x01) != 0) dx = 1;
 	if(((val >> 7) & 0x01) != 0) dy = 1;
 
+	if (XGA_BlitRectWithSpans(dx, dy))
+		return;
+
 	Bitu mixselect = (xga.pix_cntl >> 6) & 0x3;
 	uint32_t mixmode = 0x67; /* Source is bitmap data, mix mode is src */
 	switch(mixselect) {
@@ -889,6 +1250,9 @@ void XGA_DrawPattern(Bitu val) {
 	if(((val >> 5) & 0x01) != 0) dx = 1;
 	if(((val >> 7) & 0x01) != 0) dy = 1;
 
+	if (XGA_DrawPatternWithSpans(dx, dy))
+		return;
+
 	srcx = xga.curx;
 	srcy = xga.cury;
 
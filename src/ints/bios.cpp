@@ -30,15 +30,10 @@
 #include "joystick.h"
 #include "mouse.h"
 #include "setup.h"
+#include "replay.h"
 #include "serialport.h"
 #include <time.h>
 
-#if defined(HAVE_CLOCK_GETTIME) && !defined(WIN32)
-//time.h is already included
-#else
-#include <sys/timeb.h>
-#endif
-
 /* if mem_systems 0 then size_extended is reported as the real size else 
  * zero is reported. ems and xms can increase or decrease the other_memsystems
  * counter using the BIOS_ZeroExtendedSize call */
@@ -499,25 +494,13 @@ static Bitu INT11_Handler(void) {
 #endif
 
 static void BIOS_HostTimeSync() {
-	uint32_t milli = 0;
-	// TODO investigate if clock_gettime and ftime can be replaced
-	// by using C++11 chrono
-#if defined(HAVE_CLOCK_GETTIME) && !defined(WIN32)
-	struct timespec tp;
-	clock_gettime(CLOCK_REALTIME,&tp);
+	/* Setup time and date, following the emulated clock when replaying */
+	const auto now_ms = REPLAY_GetTimeMs();
+	const time_t now = static_cast<time_t>(now_ms / 1000);
+	const auto milli = static_cast<uint32_t>(now_ms % 1000);
 
 	struct tm *loctime;
-	loctime = localtime(&tp.tv_sec);
-	milli = (uint32_t) (tp.tv_nsec / 1000000);
-#else
-	/* Setup time and date */
-	struct timeb timebuffer;
-	ftime(&timebuffer);
-
-	struct tm *loctime;
-	loctime = localtime (&timebuffer.time);
-	milli = (uint32_t) timebuffer.millitm;
-#endif
+	loctime = localtime(&now);
 	/*
 	loctime->tm_hour = 23;
 	loctime->tm_min = 59;
@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <cassert>
 #include <utility>
+#include <vector>
 
 #include "callback.h"
 #include "regs.h"
@@ -163,8 +164,24 @@ uint8_t imageDisk::Read_Sector(uint32_t head,uint32_t cylinder,uint32_t sector,v
 }
 
 uint8_t imageDisk::Read_AbsoluteSector(uint32_t sectnum, void *data)
+{
+	return Read_AbsoluteSectors(sectnum, 1, data);
+}
+
+uint8_t imageDisk::Read_Sectors(uint32_t head, uint32_t cylinder,
+                                uint32_t sector, uint32_t count, void *data)
+{
+	const uint32_t sectnum = ((cylinder * heads + head) * sectors) + sector - 1L;
+
+	return Read_AbsoluteSectors(sectnum, count, data);
+}
+
+// consecutive sectors are read with a single seek and read, the part past the
+// end of the image reads as zeroes
+uint8_t imageDisk::Read_AbsoluteSectors(uint32_t sectnum, uint32_t count, void *data)
 {
 	const uint32_t bytenum = sectnum * sector_size;
+	const size_t bytes = static_cast<size_t>(count) * sector_size;
 
 	if (last_action == WRITE || bytenum != current_fpos) {
 		if (fseek(diskimg, bytenum, SEEK_SET) != 0) {
@@ -173,8 +190,10 @@ uint8_t imageDisk::Read_AbsoluteSector(uint32_t sectnum, void *data)
 			return 0xff;
 		}
 	}
-	size_t ret = fread(data, 1, sector_size, diskimg);
-	current_fpos=bytenum+ret;
+	const size_t ret = fread(data, 1, bytes, diskimg);
+	if (ret < bytes)
+		memset(static_cast<uint8_t *>(data) + ret, 0, bytes - ret);
+	current_fpos = bytenum + static_cast<uint32_t>(ret);
 	last_action=READ;
 
 	return 0x00;
@@ -408,10 +427,13 @@ static Bitu INT13_DiskHandler(void) {
 			return CBRET_NONE;
 		}
 
-		segat = SegValue(es);
-		bufptr = reg_bx;
-		for (Bitu i = 0; i < reg_al; i++) {
-			last_status = imageDiskList[drivenum]->Read_Sector((uint32_t)reg_dh, (uint32_t)(reg_ch | ((reg_cl & 0xc0)<< 2)), (uint32_t)((reg_cl & 63)+i), sectbuf);
+		{
+			// read all sectors at once and copy them to the buffer,
+			// which wraps around at the end of the segment
+			static std::vector<uint8_t> readbuf;
+			const auto &disk = imageDiskList[drivenum];
+			readbuf.resize(static_cast<size_t>(reg_al) * disk->getSectSize());
+			last_status = disk->Read_Sectors((uint32_t)reg_dh, (uint32_t)(reg_ch | ((reg_cl & 0xc0)<< 2)), (uint32_t)(reg_cl & 63), reg_al, readbuf.data());
 			if((last_status != 0x00) || (killRead)) {
 				LOG_MSG("Error in disk read");
 				killRead = false;
@@ -419,9 +441,16 @@ static Bitu INT13_DiskHandler(void) {
 				CALLBACK_SCF(true);
 				return CBRET_NONE;
 			}
-			for(t=0;t<512;t++) {
-				real_writeb(segat,bufptr,sectbuf[t]);
-				bufptr++;
+			segat = SegValue(es);
+			bufptr = reg_bx;
+			const uint8_t *data = readbuf.data();
+			size_t remaining = readbuf.size();
+			while (remaining) {
+				const size_t chunk = std::min(remaining, static_cast<size_t>(0x10000 - bufptr));
+				MEM_BlockWrite(PhysMake(segat, bufptr), data, chunk);
+				bufptr = static_cast<uint16_t>(bufptr + chunk);
+				data += chunk;
+				remaining -= chunk;
 			}
 		}
 		reg_ah = 0x00;
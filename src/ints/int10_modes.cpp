@@ -556,6 +556,7 @@ static void FinishSetMode(bool clearmem) {
 			//  Hack we just access the memory directly
 			memset(vga.mem.linear,0,vga.vmemsize);
 			memset(vga.fastmem, 0, vga.vmemsize<<1);
+			VGA_MarkDirty(0, vga.vmemsize);
 			break;
 		case M_ERROR:
 			assert(false);
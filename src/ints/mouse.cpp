@@ -18,12 +18,14 @@
 
 #include "mouse.h"
 
+#include <array>
 #include <string.h>
 #include <math.h>
 
 #include "callback.h"
 #include "mem.h"
 #include "regs.h"
+#include "replay.h"
 #include "cpu.h"
 #include "pic.h"
 #include "inout.h"
@@ -39,6 +41,7 @@ static RealPt ps2_callback,uir_callback;
 static int16_t oldmouseX, oldmouseY;
 // forward
 void WriteMouseIntVector(void);
+void DrawCursor();
 
 struct button_event {
 	uint8_t type;
@@ -96,6 +99,8 @@ static struct {
 	bool	background;
 	int16_t	backposx, backposy;
 	uint8_t	backData[CURSORX*CURSORY];
+	PhysPt	backaddr;      // text cell holding the cursor
+	uint16_t	textCursorData; // char and attribute written there
 	uint16_t*	screenMask;
 	uint16_t* cursorMask;
 	int16_t	clipx,clipy;
@@ -121,6 +126,7 @@ static struct {
 	bool enabled;
 	bool inhibit_draw;
 	bool timer_in_progress;
+	bool redraw_pending;
 	bool in_UIR;
 	uint8_t mode;
 	int16_t gran_x,gran_y;
@@ -227,50 +233,82 @@ inline void Mouse_AddEvent(uint8_t type) {
 	}
 }
 
+// High-rate host mice move the cursor far more often than it can be seen, so
+// redraws are batched and done at most once per mouse sample period
+static void MOUSE_Redraw_Cursor(uint32_t /*val*/)
+{
+	mouse.redraw_pending = false;
+	DrawCursor();
+}
+
+static void Mouse_ScheduleRedraw()
+{
+	if (mouse.redraw_pending)
+		return;
+	mouse.redraw_pending = true;
+	PIC_AddEvent(MOUSE_Redraw_Cursor, MOUSE_DELAY);
+}
+
 // ***************************************************************************
 // Mouse cursor - text mode
 // ***************************************************************************
 /* Write and read directly to the screen. Do no use int_setcursorpos (LOTUS123) */
-extern void WriteChar(uint16_t col,uint16_t row,uint8_t page,uint8_t chr,uint8_t attr,bool useattr);
-extern void ReadCharAttr(uint16_t col,uint16_t row,uint8_t page,uint16_t * result);
+static PhysPt TextCellAddress(uint16_t col, uint16_t row, uint8_t page) {
+	uint16_t address=page*real_readw(BIOSMEM_SEG,BIOSMEM_PAGE_SIZE);
+	address+=(row*real_readw(BIOSMEM_SEG,BIOSMEM_NB_COLS)+col)*2;
+	return CurMode->pstart+address;
+}
 
 void RestoreCursorBackgroundText() {
 	if (mouse.hidden || mouse.inhibit_draw) return;
 
 	if (mouse.background) {
-		WriteChar(mouse.backposx,mouse.backposy,real_readb(BIOSMEM_SEG,BIOSMEM_CURRENT_PAGE),mouse.backData[0],mouse.backData[1],true);
+		mem_writew(mouse.backaddr,mouse.backData[0] | (mouse.backData[1] << 8));
 		mouse.background = false;
 	}
 }
 
 void DrawCursorText() {	
-	// Restore Background
-	RestoreCursorBackgroundText();
-
 	// Check if cursor in update region
 	if ((POS_Y <= mouse.updateRegion_y[1]) && (POS_Y >= mouse.updateRegion_y[0]) &&
 		(POS_X <= mouse.updateRegion_x[1]) && (POS_X >= mouse.updateRegion_x[0])) {
+		RestoreCursorBackgroundText();
 		return;
 	}
 
-	// Save Background
-	mouse.backposx		= POS_X>>3;
-	mouse.backposy		= POS_Y>>3;
-	if (mouse.mode < 2) mouse.backposx >>= 1; 
+	int16_t posx = POS_X>>3;
+	const int16_t posy = POS_Y>>3;
+	if (mouse.mode < 2) posx >>= 1;
 
 	//use current page (CV program)
 	uint8_t page = real_readb(BIOSMEM_SEG,BIOSMEM_CURRENT_PAGE);
 	
 	if (mouse.cursorType == 0) {
-		uint16_t result;
-		ReadCharAttr(mouse.backposx,mouse.backposy,page,&result);
+		const PhysPt where = TextCellAddress(posx,posy,page);
+		// Nothing to redraw if the cursor is still intact in its cell
+		const uint16_t back = mouse.backData[0] | (mouse.backData[1] << 8);
+		if (mouse.background && where == mouse.backaddr &&
+		    mem_readw(where) == mouse.textCursorData &&
+		    mouse.textCursorData == ((back & mouse.textAndMask) ^ mouse.textXorMask))
+			return;
+
+		// Restore and save Background
+		RestoreCursorBackgroundText();
+		mouse.backposx		= posx;
+		mouse.backposy		= posy;
+		mouse.backaddr		= where;
+		uint16_t result = mem_readw(where);
 		mouse.backData[0]	= (uint8_t)(result & 0xFF);
 		mouse.backData[1]	= (uint8_t)(result>>8);
 		mouse.background	= true;
 		// Write Cursor
 		result = (result & mouse.textAndMask) ^ mouse.textXorMask;
-		WriteChar(mouse.backposx,mouse.backposy,page,(uint8_t)(result&0xFF),(uint8_t)(result>>8),true);
+		mem_writew(where,result);
+		mouse.textCursorData = result;
 	} else {
+		RestoreCursorBackgroundText();
+		mouse.backposx		= posx;
+		mouse.backposy		= posy;
 		uint16_t address=page * real_readw(BIOSMEM_SEG,BIOSMEM_PAGE_SIZE);
 		address += (mouse.backposy * real_readw(BIOSMEM_SEG,BIOSMEM_NB_COLS) + mouse.backposx) * 2;
 		address /= 2;
@@ -375,6 +413,11 @@ void RestoreCursorBackground() {
 }
 
 void DrawCursor() {
+	// Any batched redraw is done by this one
+	if (mouse.redraw_pending) {
+		mouse.redraw_pending = false;
+		PIC_RemoveEvents(MOUSE_Redraw_Cursor);
+	}
 	if (mouse.hidden || mouse.inhibit_draw) return;
 	INT10_SetCurMode();
 	// In Textmode ?
@@ -461,7 +504,24 @@ void DrawCursor() {
 	RestoreVgaRegisters();
 }
 
+// The position and motion counters as reported to the guest
+static std::array<int16_t, 4> GuestMouseState()
+{
+	if (useps2callback)
+		return {static_cast<int16_t>(mouse.x), static_cast<int16_t>(mouse.y),
+		        static_cast<int16_t>(mouse.mickey_x),
+		        static_cast<int16_t>(mouse.mickey_y)};
+	return {static_cast<int16_t>(POS_X), static_cast<int16_t>(POS_Y),
+	        static_cast<int16_t>(mouse.mickey_x),
+	        static_cast<int16_t>(mouse.mickey_y)};
+}
+
 void Mouse_CursorMoved(float xrel,float yrel,float x,float y,bool emulate) {
+	if (!REPLAY_AcceptMouseMove(xrel, yrel, x, y, emulate))
+		return;
+
+	const auto old_state = GuestMouseState();
+
 	float dx = xrel * mouse.pixelPerMickey_x;
 	float dy = yrel * mouse.pixelPerMickey_y;
 
@@ -509,8 +569,14 @@ void Mouse_CursorMoved(float xrel,float yrel,float x,float y,bool emulate) {
 		if (mouse.y >= 32768.0) mouse.y -= 65536.0;
 		else if (mouse.y <= -32769.0) mouse.y += 65536.0;
 	}
+
+	// Motion that doesn't change what the guest sees, like sub-pixel
+	// steps from high resolution mice, needs no event or redraw
+	if (GuestMouseState() == old_state)
+		return;
+
 	Mouse_AddEvent(MOUSE_HAS_MOVED);
-	DrawCursor();
+	Mouse_ScheduleRedraw();
 }
 
 void Mouse_CursorSet(float x,float y) {
@@ -520,6 +586,8 @@ void Mouse_CursorSet(float x,float y) {
 }
 
 void Mouse_ButtonPressed(uint8_t button) {
+	if (!REPLAY_AcceptMouseButton(button, true))
+		return;
 	switch (button) {
 #if (MOUSE_BUTTONS >= 1)
 	case 0:
@@ -551,6 +619,8 @@ void Mouse_ButtonPressed(uint8_t button) {
 }
 
 void Mouse_ButtonReleased(uint8_t button) {
+	if (!REPLAY_AcceptMouseButton(button, false))
+		return;
 	switch (button) {
 #if (MOUSE_BUTTONS >= 1)
 	case 0:
@@ -674,6 +744,8 @@ void Mouse_AfterNewVideoMode(bool setmode) {
 	mouse.events = 0;
 	mouse.timer_in_progress = false;
 	PIC_RemoveEvents(MOUSE_Limit_Events);
+	mouse.redraw_pending = false;
+	PIC_RemoveEvents(MOUSE_Redraw_Cursor);
 
 	mouse.hotx		 = 0;
 	mouse.hoty		 = 0;
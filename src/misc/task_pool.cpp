@@ -0,0 +1,153 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "task_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "support.h"
+
+static int64_t elapsed_us(const std::chrono::steady_clock::time_point from,
+                          const std::chrono::steady_clock::time_point to)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+TaskPool::TaskPool(const char *thread_name, const int num_workers)
+{
+	auto count = num_workers;
+	if (count <= 0)
+		count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+	workers.reserve(static_cast<size_t>(count));
+	for (int i = 0; i < count; ++i) {
+		workers.emplace_back(&TaskPool::WorkerLoop, this);
+		set_thread_name(workers.back(), thread_name);
+	}
+}
+
+TaskPool::~TaskPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	has_tasks.notify_all();
+	for (auto &worker : workers)
+		worker.join();
+}
+
+int TaskPool::NumWorkers() const
+{
+	return static_cast<int>(workers.size());
+}
+
+size_t TaskPool::NumQueued()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return audio_queue.size() + background_queue.size();
+}
+
+std::map<std::string, TaskStats> TaskPool::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void TaskPool::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.clear();
+}
+
+void TaskPool::Enqueue(const char *task_name, const TaskLane lane, runner_t &&run)
+{
+	assert(task_name);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto &queue = (lane == TaskLane::Audio) ? audio_queue
+		                                        : background_queue;
+		queue.push_back({task_name, std::move(run), clock::now()});
+	}
+	// Not every idle worker may take a background task, so wake them all
+	// and let them sort it out
+	has_tasks.notify_all();
+}
+
+// Keep the last idle worker free for audio tasks, unless it's the only
+// worker or the pool is draining its queues
+bool TaskPool::CanTakeBackground() const
+{
+	return !background_queue.empty() &&
+	       (workers.size() == 1 || idle_workers > 1 || stopping);
+}
+
+void TaskPool::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	++idle_workers;
+	while (true) {
+		has_tasks.wait(lock, [this] {
+			return stopping || !audio_queue.empty() ||
+			       CanTakeBackground();
+		});
+
+		QueuedTask task;
+		if (!audio_queue.empty()) {
+			task = std::move(audio_queue.front());
+			audio_queue.pop_front();
+		} else if (CanTakeBackground()) {
+			task = std::move(background_queue.front());
+			background_queue.pop_front();
+		} else if (stopping) {
+			break;
+		} else {
+			continue;
+		}
+		--idle_workers;
+		lock.unlock();
+
+		const auto started_at = clock::now();
+		const auto publish = task.run();
+		const auto finished_at = clock::now();
+
+		lock.lock();
+		auto &task_stats = stats[task.name];
+		const auto run_us = elapsed_us(started_at, finished_at);
+		++task_stats.runs;
+		task_stats.total_us += run_us;
+		task_stats.max_us = std::max(task_stats.max_us, run_us);
+		task_stats.total_wait_us += elapsed_us(task.queued_at, started_at);
+		lock.unlock();
+
+		publish();
+
+		lock.lock();
+		++idle_workers;
+	}
+	--idle_workers;
+}
+
+TaskPool &TASK_GetPool()
+{
+	static TaskPool pool("dosbox:task");
+	return pool;
+}
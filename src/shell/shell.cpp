@@ -28,6 +28,7 @@
 #include "fs_utils.h"
 #include "mapper.h"
 #include "regs.h"
+#include "replay.h"
 #include "string_utils.h"
 #include "timer.h"
 
@@ -333,7 +334,7 @@ void open_console_device(const bool condition = true)
 
 uint16_t get_tick_random_number() {
 	constexpr uint16_t random_uplimit = 10000;
-	return (uint16_t)(GetTicks() % random_uplimit);
+	return (uint16_t)(REPLAY_GetTicks() % random_uplimit);
 }
 
 void DOS_Shell::ParseLine(char *line)
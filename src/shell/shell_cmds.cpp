@@ -42,6 +42,7 @@
 #include "drives.h"
 #include "paging.h"
 #include "regs.h"
+#include "replay.h"
 #include "string_utils.h"
 #include "support.h"
 #include "timer.h"
@@ -1756,7 +1757,7 @@ void DOS_Shell::CMD_DATE(char *args)
 	}
 	if (ScanCMDBool(args, "H")) {
 		// synchronize date with host
-		const time_t curtime = time(nullptr);
+		const time_t curtime = REPLAY_GetTime();
 		struct tm datetime;
 		cross::localtime_r(&curtime, &datetime);
 		reg_ah = 0x2b; // set system date
@@ -1839,7 +1840,7 @@ void DOS_Shell::CMD_TIME(char * args) {
 	}
 	if (ScanCMDBool(args, "H")) {
 		// synchronize time with host
-		const time_t curtime = time(NULL);
+		const time_t curtime = REPLAY_GetTime();
 		struct tm datetime;
 		cross::localtime_r(&curtime, &datetime);
 		reg_ah = 0x2d; // set system time
@@ -0,0 +1,525 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Measures what each emulated sound device costs. The devices are brought up
+// headless with the mixer in nosound mode, then fed a stream of port writes
+// one emulated millisecond at a time, exactly as the guest would between
+// timer ticks. Each configuration reports the mixed frames per wall-clock
+// second and the CPU time spent per emulated second, which includes the
+// MT-32 and FluidSynth render threads.
+//
+// The built-in streams keep every voice of a device busy. OPL backends can
+// instead replay a DOSBox DRO capture:
+//
+//   audio_synth_benchmark [--seconds N] [--dro FILE]
+//                         [--mt32-romdir DIR] [--soundfont FILE]
+
+#define SDL_MAIN_HANDLED
+
+#include "control.h"
+#include "cross.h"
+#include "dosbox.h"
+#include "inout.h"
+#include "setup.h"
+#include "timer.h"
+#include "video.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int mixer_rate_hz = 48000;
+
+struct PortWrite {
+	uint32_t ms = 0;
+	io_port_t port = 0;
+	uint16_t value = 0;
+	io_width_t width = io_width_t::byte;
+};
+
+using port_stream_t = std::vector<PortWrite>;
+
+struct Setting {
+	const char *section = nullptr;
+	std::string line = {};
+};
+
+struct Scenario {
+	std::string name = {};
+	std::vector<Setting> settings = {};
+	port_stream_t stream = {};
+	uint32_t duration_ms = 0;
+};
+
+// Sections brought up once, and the device sections re-initialised for
+// every scenario. The mixer can't be restarted because it registers its
+// tick handler again on every init.
+const std::vector<std::string> base_sections = {"dosbox", "cpu", "mixer"};
+const std::vector<std::string> device_sections = {"midi", "sblaster", "gus",
+                                                  "innovation", "speaker"};
+
+// Leaves every device off, so each scenario only enables its own
+const std::vector<Setting> quiet_settings = {
+        {"sblaster", "sbtype=none"},   {"sblaster", "oplmode=none"},
+        {"sblaster", "oplemu=default"}, {"gus", "gus=false"},
+        {"innovation", "sidmodel=none"}, {"speaker", "pcspeaker=false"},
+        {"speaker", "tandy=off"},       {"speaker", "ps1audio=false"},
+        {"midi", "mididevice=none"},    {"midi", "mpu401=uart"},
+};
+
+// Rotates through a scale so every voice keeps retriggering, with each voice
+// on a slightly different period to avoid lockstep writes
+template <typename Note>
+void play_notes(const uint32_t duration_ms, const int voices, Note &&note)
+{
+	for (uint32_t ms = 0; ms < duration_ms; ++ms) {
+		for (int v = 0; v < voices; ++v) {
+			const auto period = static_cast<uint32_t>(120 + 15 * v);
+			const auto pos = ms % period;
+			if (pos == 0)
+				note(ms, v, static_cast<int>((ms / period + v * 3) % 12), true);
+			else if (pos == period * 3 / 4)
+				note(ms, v, 0, false);
+		}
+	}
+}
+
+// OPL registers 0x000-0x0ff are written through 0x388/0x389, and the OPL3's
+// second bank through 0x38a/0x38b
+void push_opl(port_stream_t &stream, const uint32_t ms, const uint16_t reg,
+              const uint8_t val)
+{
+	const auto bank = static_cast<io_port_t>((reg >> 8) * 2);
+	stream.push_back({ms, static_cast<io_port_t>(0x388 + bank),
+	                  static_cast<uint16_t>(reg & 0xff)});
+	stream.push_back({ms, static_cast<io_port_t>(0x389 + bank), val});
+}
+
+port_stream_t make_opl_stream(const uint32_t duration_ms, const bool is_opl3)
+{
+	constexpr uint8_t op_offsets[9] = {0, 1, 2, 8, 9, 10, 16, 17, 18};
+	constexpr uint16_t fnums[12] = {0x158, 0x16b, 0x181, 0x198,
+	                                0x1b0, 0x1ca, 0x1e5, 0x202,
+	                                0x220, 0x241, 0x263, 0x287};
+	port_stream_t stream;
+	push_opl(stream, 0, 0x01, 0x20); // waveform select
+	if (is_opl3)
+		push_opl(stream, 0, 0x105, 0x01);
+
+	const auto voices = is_opl3 ? 18 : 9;
+	for (int v = 0; v < voices; ++v) {
+		const auto bank = static_cast<uint16_t>((v / 9) << 8);
+		const auto op = static_cast<uint16_t>(bank + op_offsets[v % 9]);
+		for (const auto o : {op, static_cast<uint16_t>(op + 3)}) {
+			push_opl(stream, 0, 0x20 + o, 0x01);
+			push_opl(stream, 0, 0x40 + o, o == op ? 0x18 : 0x00);
+			push_opl(stream, 0, 0x60 + o, 0xf4);
+			push_opl(stream, 0, 0x80 + o, 0x55);
+			push_opl(stream, 0, 0xe0 + o, static_cast<uint8_t>(v & 3));
+		}
+		// Feedback with output to both speakers on the OPL3
+		push_opl(stream, 0, bank + 0xc0 + v % 9, 0x3e);
+	}
+	play_notes(duration_ms, voices, [&](uint32_t ms, int v, int note, bool on) {
+		const auto bank = static_cast<uint16_t>((v / 9) << 8);
+		const auto ch = static_cast<uint16_t>(bank + v % 9);
+		const auto fnum = fnums[note];
+		const auto block = 3 + v % 3;
+		push_opl(stream, ms, 0xa0 + ch, static_cast<uint8_t>(fnum & 0xff));
+		push_opl(stream, ms, 0xb0 + ch,
+		         static_cast<uint8_t>((on ? 0x20 : 0) | (block << 2) |
+		                              (fnum >> 8)));
+	});
+	return stream;
+}
+
+uint16_t read_le16(const uint8_t *p)
+{
+	return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+// Converts a DOSBox raw OPL capture (DRO version 2) into port writes. The
+// capture's own delays set the time of each write.
+bool load_dro(const std::string &path, port_stream_t &stream, uint32_t &duration_ms)
+{
+	std::ifstream file(path, std::ios::binary);
+	const std::vector<uint8_t> data(std::istreambuf_iterator<char>(file), {});
+	constexpr size_t header_size = 26;
+	if (data.size() < header_size || memcmp(data.data(), "DBRAWOPL", 8) != 0 ||
+	    read_le16(&data[8]) != 2) {
+		fprintf(stderr, "%s is not a DRO version 2 capture\n", path.c_str());
+		return false;
+	}
+	const auto short_delay = data[23];
+	const auto long_delay = data[24];
+	const auto codemap_size = data[25];
+	if (data.size() < header_size + codemap_size)
+		return false;
+	const uint8_t *codemap = &data[header_size];
+
+	uint32_t ms = 0;
+	for (auto i = header_size + codemap_size; i + 1 < data.size(); i += 2) {
+		const auto code = data[i];
+		const auto val = data[i + 1];
+		if (code == short_delay) {
+			ms += val + 1u;
+		} else if (code == long_delay) {
+			ms += (val + 1u) << 8;
+		} else if ((code & 0x7f) < codemap_size) {
+			const auto reg = codemap[code & 0x7f] | ((code & 0x80) << 1);
+			push_opl(stream, ms, static_cast<uint16_t>(reg), val);
+		}
+	}
+	duration_ms = ms + 1;
+	return true;
+}
+
+// The GUS's registers are selected through gusbase+0x103 and written through
+// gusbase+0x104 (word) or gusbase+0x105 (high byte). Every voice loops the
+// same 8-bit sample at its own rate.
+port_stream_t make_gus_stream(const int voices)
+{
+	constexpr io_port_t voice_select = 0x342;
+	constexpr io_port_t register_select = 0x343;
+	constexpr io_port_t data_word = 0x344;
+	constexpr io_port_t data_high = 0x345;
+	constexpr io_port_t dram_poke = 0x347;
+	constexpr int sample_size = 1024;
+
+	port_stream_t stream;
+	auto write_word = [&](uint8_t reg, uint16_t val) {
+		stream.push_back({0, register_select, reg});
+		stream.push_back({0, data_word, val, io_width_t::word});
+	};
+	auto write_byte = [&](uint8_t reg, uint8_t val) {
+		stream.push_back({0, register_select, reg});
+		stream.push_back({0, data_high, val});
+	};
+	// Wave addresses carry 9 fractional bits
+	auto write_address = [&](uint8_t msw_reg, uint32_t byte_addr) {
+		const auto addr = byte_addr << 9;
+		write_word(msw_reg, static_cast<uint16_t>(addr >> 16));
+		write_word(msw_reg + 1, static_cast<uint16_t>(addr & 0xffff));
+	};
+
+	write_byte(0x4c, 0x00); // reset
+	write_byte(0x4c, 0x01); // run
+	for (int i = 0; i < sample_size; ++i) {
+		write_word(0x43, static_cast<uint16_t>(i));
+		write_byte(0x44, 0);
+		const auto tri = i < sample_size / 2 ? i : sample_size - i;
+		stream.push_back({0, dram_poke, static_cast<uint16_t>((tri / 2 - 128) & 0xff)});
+	}
+	write_byte(0x0e, static_cast<uint8_t>(voices - 1));
+	for (int v = 0; v < voices; ++v) {
+		stream.push_back({0, voice_select, static_cast<uint16_t>(v)});
+		write_byte(0x00, 0x03); // stop the voice while it's set up
+		write_word(0x01, static_cast<uint16_t>(0x300 + v * 0x28));
+		write_address(0x02, 0);
+		write_address(0x04, sample_size - 1);
+		write_address(0x0a, 0);
+		write_word(0x09, 0xd000);
+		write_byte(0x0c, static_cast<uint8_t>(v % 16));
+		write_byte(0x0d, 0x03); // no volume ramp
+		write_byte(0x00, 0x08); // loop forward, 8-bit
+	}
+	write_byte(0x4c, 0x03); // run with the DAC enabled
+	return stream;
+}
+
+port_stream_t make_sid_stream(const uint32_t duration_ms)
+{
+	constexpr io_port_t base = 0x280;
+	constexpr uint8_t waveforms[3] = {0x40, 0x20, 0x10};
+	port_stream_t stream;
+	auto write = [&](uint32_t ms, uint8_t reg, uint8_t val) {
+		stream.push_back({ms, static_cast<io_port_t>(base + reg), val});
+	};
+	write(0, 0x18, 0x1f); // low-pass, full volume
+	write(0, 0x17, 0xf7); // full resonance, filter all voices
+	for (uint8_t v = 0; v < 3; ++v) {
+		const auto r = static_cast<uint8_t>(v * 7);
+		write(0, r + 2, 0x00);
+		write(0, r + 3, 0x08); // 50% pulse width
+		write(0, r + 5, 0x09);
+		write(0, r + 6, 0x89);
+	}
+	play_notes(duration_ms, 3, [&](uint32_t ms, int v, int note, bool on) {
+		const auto r = static_cast<uint8_t>(v * 7);
+		if (on) {
+			// Frequency register for a PAL clock, from middle C up
+			const auto hz = 261.63 * std::pow(2.0, (note + 12 * v) / 12.0);
+			const auto freq = static_cast<uint16_t>(hz * 16777216 / 985248);
+			write(ms, r + 0, freq & 0xff);
+			write(ms, r + 1, static_cast<uint8_t>(freq >> 8));
+		}
+		write(ms, r + 4, static_cast<uint8_t>(waveforms[v] | (on ? 1 : 0)));
+	});
+	// Sweep the filter cutoff
+	for (uint32_t ms = 0; ms < duration_ms; ms += 10)
+		write(ms, 0x16, static_cast<uint8_t>(ms / 10));
+	std::stable_sort(stream.begin(), stream.end(),
+	                 [](const PortWrite &a, const PortWrite &b) {
+		                 return a.ms < b.ms;
+	                 });
+	return stream;
+}
+
+// Drives both SAA1099s: the left chip through base+0/1 and the right one
+// through base+2/3, writing the register number to the odd port
+port_stream_t make_saa1099_stream(const uint32_t duration_ms)
+{
+	constexpr io_port_t base = 0x220;
+	port_stream_t stream;
+	auto write = [&](uint32_t ms, int chip, uint8_t reg, uint8_t val) {
+		const auto port = static_cast<io_port_t>(base + chip * 2);
+		stream.push_back({ms, static_cast<io_port_t>(port + 1), reg});
+		stream.push_back({ms, port, val});
+	};
+	for (int chip = 0; chip < 2; ++chip) {
+		write(0, chip, 0x1c, 0x02); // reset
+		write(0, chip, 0x1c, 0x01); // sound enable
+		write(0, chip, 0x10, 0x33);
+		write(0, chip, 0x11, 0x44);
+		write(0, chip, 0x12, 0x55);
+		write(0, chip, 0x14, 0x3f); // tone on all channels
+		write(0, chip, 0x15, 0x20); // noise on the last channel
+		write(0, chip, 0x16, 0x01);
+	}
+	play_notes(duration_ms, 12, [&](uint32_t ms, int v, int note, bool on) {
+		const auto chip = v / 6;
+		const auto ch = static_cast<uint8_t>(v % 6);
+		if (on)
+			write(ms, chip, 0x08 + ch, static_cast<uint8_t>(note * 21));
+		write(ms, chip, ch, on ? 0xcc : 0x00);
+	});
+	return stream;
+}
+
+// SN76496-style PSG at the given port: three tone channels and noise
+port_stream_t make_psg_stream(const io_port_t port, const uint32_t duration_ms)
+{
+	port_stream_t stream;
+	auto write = [&](uint32_t ms, uint8_t val) {
+		stream.push_back({ms, port, val});
+	};
+	write(0, 0xe4); // white noise
+	play_notes(duration_ms, 4, [&](uint32_t ms, int v, int note, bool on) {
+		const auto ch = static_cast<uint8_t>(v << 5);
+		if (on && v < 3) {
+			const auto hz = 261.63 * std::pow(2.0, (note + 12 * v) / 12.0);
+			const auto div = static_cast<uint16_t>(3579545 / (32 * hz));
+			write(ms, static_cast<uint8_t>(0x80 | ch | (div & 0x0f)));
+			write(ms, static_cast<uint8_t>((div >> 4) & 0x3f));
+		}
+		write(ms, static_cast<uint8_t>(0x90 | ch | (on ? 2 : 0x0f)));
+	});
+	return stream;
+}
+
+// General MIDI notes on channels 2 to 9, which are also the MT-32's melodic
+// parts, sent through the MPU-401's data port in UART mode
+port_stream_t make_midi_stream(const uint32_t duration_ms)
+{
+	constexpr io_port_t data_port = 0x330;
+	constexpr uint8_t programs[8] = {0, 24, 32, 40, 48, 56, 64, 80};
+	port_stream_t stream;
+	auto write = [&](uint32_t ms, std::initializer_list<uint8_t> bytes) {
+		for (const auto b : bytes)
+			stream.push_back({ms, data_port, b});
+	};
+	for (uint8_t ch = 1; ch <= 8; ++ch)
+		write(0, {static_cast<uint8_t>(0xc0 | ch), programs[ch - 1]});
+
+	std::vector<uint8_t> playing(8);
+	play_notes(duration_ms, 8, [&](uint32_t ms, int v, int note, bool on) {
+		const auto status = static_cast<uint8_t>(0x90 | (v + 1));
+		if (on) {
+			playing[v] = static_cast<uint8_t>(48 + 12 * (v % 3) + note);
+			write(ms, {status, playing[v], 100});
+		} else {
+			write(ms, {status, playing[v], 0});
+		}
+	});
+	return stream;
+}
+
+void apply(const std::vector<Setting> &settings)
+{
+	for (const auto &s : settings)
+		control->GetSection(s.section)->HandleInputline(s.line);
+}
+
+void run_scenario(const Scenario &scenario)
+{
+	apply(quiet_settings);
+	apply(scenario.settings);
+	for (const auto &name : device_sections)
+		control->GetSection(name)->ExecuteEarlyInit();
+	for (const auto &name : device_sections)
+		control->GetSection(name)->ExecuteInit();
+
+	const auto wall_start = std::chrono::steady_clock::now();
+	const auto cpu_start = std::clock();
+
+	const auto &stream = scenario.stream;
+	auto next = stream.begin();
+	for (uint32_t ms = 0; ms < scenario.duration_ms; ++ms) {
+		for (; next != stream.end() && next->ms <= ms; ++next) {
+			if (next->width == io_width_t::word)
+				IO_WriteW(next->port, next->value);
+			else
+				IO_WriteB(next->port, static_cast<uint8_t>(next->value));
+		}
+		TIMER_AddTick();
+	}
+
+	const auto cpu_s = static_cast<double>(std::clock() - cpu_start) /
+	                   CLOCKS_PER_SEC;
+	const auto wall_s = std::chrono::duration<double>(
+	                            std::chrono::steady_clock::now() - wall_start)
+	                            .count();
+
+	for (auto r = device_sections.rbegin(); r != device_sections.rend(); ++r)
+		control->GetSection(*r)->ExecuteDestroy();
+
+	const auto emulated_s = scenario.duration_ms / 1000.0;
+	printf("%-24s %12.0f frames/s %8.1fx realtime %8.2f CPU ms per emulated s\n",
+	       scenario.name.c_str(), mixer_rate_hz * emulated_s / wall_s,
+	       emulated_s / wall_s, cpu_s * 1000.0 / emulated_s);
+	fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	uint32_t duration_ms = 10000;
+	std::string dro_path = {};
+	std::string mt32_romdir = {};
+	std::string soundfont = {};
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const std::string arg = argv[i];
+		if (arg == "--seconds")
+			duration_ms = static_cast<uint32_t>(atoi(argv[i + 1]) * 1000);
+		else if (arg == "--dro")
+			dro_path = argv[i + 1];
+		else if (arg == "--mt32-romdir")
+			mt32_romdir = argv[i + 1];
+		else if (arg == "--soundfont")
+			soundfont = argv[i + 1];
+	}
+
+	port_stream_t opl_streams[2] = {make_opl_stream(duration_ms, false),
+	                                make_opl_stream(duration_ms, true)};
+	uint32_t opl_duration_ms = duration_ms;
+	if (!dro_path.empty()) {
+		port_stream_t dro_stream;
+		if (!load_dro(dro_path, dro_stream, opl_duration_ms))
+			return 1;
+		opl_streams[0] = dro_stream;
+		opl_streams[1] = dro_stream;
+	}
+
+	std::vector<Scenario> scenarios;
+	for (const auto *emu : {"fast", "compat", "mame", "nuked"}) {
+		for (const auto is_opl3 : {false, true}) {
+			const auto mode = is_opl3 ? "opl3" : "opl2";
+			scenarios.push_back({std::string("OPL ") + emu + " " + mode,
+			                     {{"sblaster", std::string("oplmode=") + mode},
+			                      {"sblaster", std::string("oplemu=") + emu}},
+			                     opl_streams[is_opl3],
+			                     opl_duration_ms});
+		}
+	}
+	for (const auto voices : {14, 32}) {
+		scenarios.push_back({"GUS " + std::to_string(voices) + " voices",
+		                     {{"gus", "gus=true"}},
+		                     make_gus_stream(voices),
+		                     duration_ms});
+	}
+	for (const auto *model : {"6581", "8580"}) {
+		scenarios.push_back({std::string("SID ") + model,
+		                     {{"innovation", std::string("sidmodel=") + model}},
+		                     make_sid_stream(duration_ms),
+		                     duration_ms});
+	}
+	scenarios.push_back({"Game Blaster",
+	                     {{"sblaster", "sbtype=gb"}, {"sblaster", "oplmode=cms"}},
+	                     make_saa1099_stream(duration_ms),
+	                     duration_ms});
+	scenarios.push_back({"Tandy PSG",
+	                     {{"speaker", "tandy=on"}},
+	                     make_psg_stream(0xc0, duration_ms),
+	                     duration_ms});
+	scenarios.push_back({"PS/1 PSG",
+	                     {{"speaker", "ps1audio=true"}},
+	                     make_psg_stream(0x205, duration_ms),
+	                     duration_ms});
+#if C_MT32EMU
+	if (!mt32_romdir.empty())
+		scenarios.push_back({"MT-32",
+		                     {{"midi", "mididevice=mt32"},
+		                      {"mt32", "romdir=" + mt32_romdir}},
+		                     make_midi_stream(duration_ms),
+		                     duration_ms});
+#endif
+#if C_FLUIDSYNTH
+	if (!soundfont.empty())
+		scenarios.push_back({"FluidSynth",
+		                     {{"midi", "mididevice=fluidsynth"},
+		                      {"fluidsynth", "soundfont=" + soundfont}},
+		                     make_midi_stream(duration_ms),
+		                     duration_ms});
+#endif
+
+	const char *dosbox_argv[] = {"dosbox", "-noprimaryconf", "-nolocalconf"};
+	CommandLine com_line(3, dosbox_argv);
+	control = std::make_unique<Config>(&com_line);
+	CROSS_DetermineConfigPaths();
+	SETUP_ParseConfigFiles(CROSS_GetPlatformConfigDir());
+	DOSBOX_Init();
+
+	apply({{"mixer", "nosound=true"},
+	       {"mixer", "rate=" + std::to_string(mixer_rate_hz)}});
+	for (const auto &name : base_sections)
+		control->GetSection(name)->ExecuteEarlyInit();
+	for (const auto &name : base_sections)
+		control->GetSection(name)->ExecuteInit();
+
+	for (const auto &scenario : scenarios)
+		run_scenario(scenario);
+
+	for (auto r = base_sections.rbegin(); r != base_sections.rend(); ++r)
+		control->GetSection(*r)->ExecuteDestroy();
+	GFX_RequestExit(true);
+	return 0;
+}
@@ -0,0 +1,913 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Differential tests for the CPU cores: every instruction sequence is run
+// on each available core from the same registers, flags and memory window,
+// and the resulting states are compared against the normal core's.
+//
+// Only one dynamic core is built in: x86 and x86_64 hosts default to
+// dynamic_x86, so the dynrec backend is only covered by builds configured
+// with -Ddynamic_core=dynrec, like the one in the Linux CI workflow.
+
+#include "cpu.h"
+
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mem.h"
+#include "paging.h"
+#include "pic.h"
+#include "regs.h"
+#include "../src/cpu/lazyflags.h"
+
+#include "dosbox_test_fixture.h"
+
+#if C_DYNAMIC_X86
+void CPU_Core_Dyn_X86_Cache_Init(bool enable_cache);
+#endif
+#if C_DYNREC
+void CPU_Core_Dynrec_Cache_Init(bool enable_cache);
+void CPU_Core_Dynrec_SetHotThreshold(int threshold);
+uint64_t CPU_Core_Dynrec_TranslatedBlocks();
+#endif
+
+namespace {
+
+constexpr uint32_t flags_arith = FLAG_CF | FLAG_PF | FLAG_AF | FLAG_ZF |
+                                 FLAG_SF | FLAG_OF;
+
+// Every sequence gets its own code slot, so the dynamic cores never find
+// stale translations and nothing has to be invalidated between runs. Their
+// code caches outlive the test fixtures, so the slots aren't reused by
+// later tests either.
+constexpr uint16_t code_segment = 0x2000;
+constexpr uint32_t code_slot_size = 512;
+constexpr uint32_t code_slots = (0x80000 - (code_segment << 4)) / code_slot_size;
+constexpr uint32_t max_code_size = 256;
+uint32_t next_code_slot = 0;
+
+// Data, extra and stack segment
+constexpr uint16_t data_segment = 0x9000;
+constexpr uint32_t data_window = 0x1000;
+constexpr uint16_t stack_top = 0x0f00;
+
+// The sequences end with the callback instruction, which makes every core
+// return to its caller with the callback number
+constexpr uint16_t end_callback = 0x1234;
+
+struct CpuState {
+	std::array<uint32_t, 8> regs = {};
+	uint32_t eip = 0;
+	uint32_t flags = 0;
+	std::vector<uint8_t> memory = std::vector<uint8_t>(data_window);
+};
+
+struct Sequence {
+	std::string name = {};
+	std::vector<uint8_t> code = {};
+	// Flags the sequence leaves in a defined state
+	uint32_t flags_mask = flags_arith;
+};
+
+struct Core {
+	const char *name;
+	Bits (*run)();
+};
+
+std::vector<Core> available_cores()
+{
+	std::vector<Core> cores = {
+	        {"normal", CPU_Core_Normal_Run},
+	        {"simple", CPU_Core_Simple_Run},
+	        {"full", CPU_Core_Full_Run},
+	};
+#if C_DYNAMIC_X86
+	CPU_Core_Dyn_X86_Cache_Init(true);
+	cores.push_back({"dynamic_x86", CPU_Core_Dyn_X86_Run});
+#endif
+#if C_DYNREC
+	CPU_Core_Dynrec_Cache_Init(true);
+	// Translate everything on first sight, else the normal core would
+	// run most of the short sequences
+	CPU_Core_Dynrec_SetHotThreshold(1);
+	cores.push_back({"dynrec", CPU_Core_Dynrec_Run});
+#endif
+	return cores;
+}
+
+void load_state(const CpuState &state, const uint32_t slot)
+{
+	for (size_t i = 0; i < state.regs.size(); ++i)
+		cpu_regs.regs[i].dword[DW_INDEX] = state.regs[i];
+	const auto cs = static_cast<uint16_t>(code_segment +
+	                                      slot * (code_slot_size >> 4));
+	SegSet16(cs, cs);
+	for (const auto seg : {ds, es, fs, gs, ss})
+		SegSet16(seg, data_segment);
+	reg_eip = 0;
+	CPU_SetFlags(state.flags, FMASK_ALL);
+	lflags.type = t_UNKNOWN;
+
+	const PhysPt data = data_segment << 4;
+	for (uint32_t i = 0; i < data_window; ++i)
+		phys_writeb(data + i, state.memory[i]);
+}
+
+CpuState save_state()
+{
+	CpuState state;
+	for (size_t i = 0; i < state.regs.size(); ++i)
+		state.regs[i] = cpu_regs.regs[i].dword[DW_INDEX];
+	state.eip = reg_eip;
+	state.flags = FillFlags();
+
+	const PhysPt data = data_segment << 4;
+	for (uint32_t i = 0; i < data_window; ++i)
+		state.memory[i] = phys_readb(data + i);
+	return state;
+}
+
+CpuState run_on_core(const Core &core, const CpuState &initial, const uint32_t slot)
+{
+	load_state(initial, slot);
+	// Give the dynamic cores a fresh translation budget for every run
+	++PIC_Ticks;
+	Bits ret = 0;
+	for (int i = 0; i < 100 && !ret; ++i) {
+		CPU_Cycles = 100000;
+		CPU_CycleLeft = 0;
+		ret = core.run();
+	}
+	EXPECT_EQ(ret, end_callback) << core.name << " didn't reach the end";
+	return save_state();
+}
+
+std::string hex_dump(const std::vector<uint8_t> &code)
+{
+	std::string out;
+	char byte[4];
+	for (const auto b : code) {
+		snprintf(byte, sizeof(byte), "%02x ", b);
+		out += byte;
+	}
+	return out;
+}
+
+void compare_states(const Sequence &seq, const Core &core,
+                    const CpuState &expected, const CpuState &actual)
+{
+	static const char *reg_names[] = {"eax", "ecx", "edx", "ebx",
+	                                  "esp", "ebp", "esi", "edi"};
+	SCOPED_TRACE(seq.name + " on " + core.name + ": " + hex_dump(seq.code));
+	for (size_t i = 0; i < expected.regs.size(); ++i)
+		EXPECT_EQ(expected.regs[i], actual.regs[i]) << reg_names[i];
+	EXPECT_EQ(expected.eip, actual.eip) << "eip";
+	EXPECT_EQ(expected.flags & seq.flags_mask, actual.flags & seq.flags_mask)
+	        << "flags";
+	for (uint32_t i = 0; i < data_window; ++i)
+		if (expected.memory[i] != actual.memory[i]) {
+			ADD_FAILURE() << "memory differs at offset " << i;
+			break;
+		}
+}
+
+// Randomized sequences
+// --------------------
+// The generator tracks which flags are undefined after each instruction, so
+// conditional instructions only read defined flags and the final compare
+// skips the rest.
+
+enum Operand { Byte, Word, Dword };
+
+class SequenceGenerator {
+public:
+	explicit SequenceGenerator(const uint32_t seed) : rng(seed) {}
+
+	Sequence Generate(const int instructions)
+	{
+		code.clear();
+		undefined = 0;
+		for (int i = 0; i < instructions && code.size() < max_code_size - 32; ++i)
+			EmitInstruction();
+		Emit({0xfe, 0x38, end_callback & 0xff, end_callback >> 8});
+		return {"random", code, flags_arith & ~undefined};
+	}
+
+	CpuState RandomState()
+	{
+		CpuState state;
+		for (auto &reg : state.regs)
+			reg = Next32();
+		state.regs[REGI_SP] = stack_top;
+		state.flags = (Next32() & flags_arith) | 0x2;
+		for (auto &b : state.memory)
+			b = static_cast<uint8_t>(Next32());
+		return state;
+	}
+
+private:
+	uint32_t Next32()
+	{
+		return static_cast<uint32_t>(rng());
+	}
+
+	uint32_t Below(const uint32_t n)
+	{
+		return Next32() % n;
+	}
+
+	void Emit(std::initializer_list<uint8_t> bytes)
+	{
+		code.insert(code.end(), bytes);
+	}
+
+	void EmitImm(const uint32_t value, const Operand size)
+	{
+		code.push_back(static_cast<uint8_t>(value));
+		if (size == Byte)
+			return;
+		code.push_back(static_cast<uint8_t>(value >> 8));
+		if (size == Word)
+			return;
+		code.push_back(static_cast<uint8_t>(value >> 16));
+		code.push_back(static_cast<uint8_t>(value >> 24));
+	}
+
+	// Picks an operand size and emits the operand size prefix for dwords,
+	// returns the opcode's width bit
+	Operand PickSize()
+	{
+		const auto size = static_cast<Operand>(Below(3));
+		if (size == Dword)
+			code.push_back(0x66);
+		return size;
+	}
+
+	// Any register, except the stack pointer as a full-width destination
+	uint8_t DestReg(const Operand size)
+	{
+		uint8_t reg = 0;
+		do
+			reg = static_cast<uint8_t>(Below(8));
+		while (size != Byte && reg == REGI_SP);
+		return reg;
+	}
+
+	// A [disp16] operand inside the data window, with room for a dword
+	void EmitMemModrm(const uint8_t reg)
+	{
+		Emit({static_cast<uint8_t>(0x06 | (reg << 3))});
+		EmitImm(Below(data_window - 4), Word);
+	}
+
+	void Flags(const uint32_t written, const uint32_t left_undefined)
+	{
+		undefined = (undefined & ~written) | left_undefined;
+	}
+
+	bool Defined(const uint32_t flags) const
+	{
+		return !(undefined & flags);
+	}
+
+	static uint32_t ConditionFlags(const uint8_t cc)
+	{
+		switch (cc >> 1) {
+		case 0: return FLAG_OF;
+		case 1: return FLAG_CF;
+		case 2: return FLAG_ZF;
+		case 3: return FLAG_CF | FLAG_ZF;
+		case 4: return FLAG_SF;
+		case 5: return FLAG_PF;
+		case 6: return FLAG_SF | FLAG_OF;
+		default: return FLAG_SF | FLAG_OF | FLAG_ZF;
+		}
+	}
+
+	void EmitAlu()
+	{
+		const auto op = static_cast<uint8_t>(Below(8));
+		// adc and sbb consume the carry
+		if ((op == 2 || op == 3) && !Defined(FLAG_CF))
+			return EmitMov();
+		const auto size = PickSize();
+		const uint8_t w = size == Byte ? 0 : 1;
+		const auto dest = op == 7 ? static_cast<uint8_t>(Below(8)) : DestReg(size);
+		switch (Below(4)) {
+		case 0: // reg, reg
+			Emit({static_cast<uint8_t>((op << 3) | w),
+			      static_cast<uint8_t>(0xc0 | (Below(8) << 3) | dest)});
+			break;
+		case 1: // reg, imm
+			Emit({static_cast<uint8_t>(0x80 | w),
+			      static_cast<uint8_t>(0xc0 | (op << 3) | dest)});
+			EmitImm(Next32(), size);
+			break;
+		case 2: // mem, reg
+			Emit({static_cast<uint8_t>((op << 3) | w)});
+			EmitMemModrm(static_cast<uint8_t>(Below(8)));
+			break;
+		default: // reg, mem
+			Emit({static_cast<uint8_t>((op << 3) | 2 | w)});
+			EmitMemModrm(dest);
+			break;
+		}
+		const bool logic = op == 1 || op == 4 || op == 6;
+		Flags(flags_arith, logic ? FLAG_AF : 0);
+	}
+
+	void EmitIncDec()
+	{
+		const auto size = PickSize();
+		const auto reg = DestReg(size);
+		const auto dec = static_cast<uint8_t>(Below(2));
+		if (size == Byte)
+			Emit({0xfe, static_cast<uint8_t>(0xc0 | (dec << 3) | reg)});
+		else
+			Emit({static_cast<uint8_t>(0x40 | (dec << 3) | reg)});
+		Flags(flags_arith & ~FLAG_CF, 0);
+	}
+
+	void EmitUnary()
+	{
+		const auto size = PickSize();
+		const uint8_t w = size == Byte ? 0 : 1;
+		const auto neg = Below(2);
+		Emit({static_cast<uint8_t>(0xf6 | w),
+		      static_cast<uint8_t>(0xc0 | ((neg ? 3 : 2) << 3) | DestReg(size))});
+		if (neg)
+			Flags(flags_arith, 0);
+	}
+
+	void EmitShift()
+	{
+		auto op = static_cast<uint8_t>(Below(8));
+		if (op == 6)
+			op = 4; // undocumented alias of shl
+		const bool rotate = op < 4;
+		// rcl and rcr rotate through the carry
+		if ((op == 2 || op == 3) && !Defined(FLAG_CF))
+			return EmitMov();
+		const auto size = PickSize();
+		const uint8_t w = size == Byte ? 0 : 1;
+		const uint32_t width = 8u << size;
+		const auto reg = DestReg(size);
+		const bool by_one = Below(2);
+		if (by_one) {
+			Emit({static_cast<uint8_t>(0xd0 | w),
+			      static_cast<uint8_t>(0xc0 | (op << 3) | reg)});
+		} else {
+			Emit({static_cast<uint8_t>(0xc0 | w),
+			      static_cast<uint8_t>(0xc0 | (op << 3) | reg),
+			      static_cast<uint8_t>(2 + Below(width - 2))});
+		}
+		// The overflow flag is only defined for single bit shifts
+		const uint32_t overflow = by_one ? 0 : FLAG_OF;
+		if (rotate)
+			Flags(FLAG_CF | FLAG_OF, overflow);
+		else
+			Flags(flags_arith, FLAG_AF | overflow);
+	}
+
+	void EmitMul()
+	{
+		const auto size = PickSize();
+		if (size != Byte && Below(2)) {
+			// imul reg, reg, imm
+			const auto imm8 = Below(2);
+			Emit({static_cast<uint8_t>(imm8 ? 0x6b : 0x69),
+			      static_cast<uint8_t>(0xc0 | (DestReg(size) << 3) | Below(8))});
+			EmitImm(Next32(), imm8 ? Byte : size);
+		} else {
+			const uint8_t w = size == Byte ? 0 : 1;
+			const auto op = static_cast<uint8_t>(4 + Below(2));
+			Emit({static_cast<uint8_t>(0xf6 | w),
+			      static_cast<uint8_t>(0xc0 | (op << 3) | Below(8))});
+		}
+		Flags(flags_arith, FLAG_PF | FLAG_AF | FLAG_ZF | FLAG_SF);
+	}
+
+	void EmitMov()
+	{
+		const auto size = PickSize();
+		const uint8_t w = size == Byte ? 0 : 1;
+		const auto dest = DestReg(size);
+		switch (Below(5)) {
+		case 0:
+			Emit({static_cast<uint8_t>(0x88 | w),
+			      static_cast<uint8_t>(0xc0 | (Below(8) << 3) | dest)});
+			break;
+		case 1:
+			Emit({static_cast<uint8_t>(0xb0 | (w << 3) | dest)});
+			EmitImm(Next32(), size);
+			break;
+		case 2:
+			Emit({static_cast<uint8_t>(0x88 | w)});
+			EmitMemModrm(static_cast<uint8_t>(Below(8)));
+			break;
+		case 3:
+			Emit({static_cast<uint8_t>(0x8a | w)});
+			EmitMemModrm(dest);
+			break;
+		default: {
+			const auto other = DestReg(size);
+			Emit({static_cast<uint8_t>(0x86 | w),
+			      static_cast<uint8_t>(0xc0 | (other << 3) | dest)});
+			break;
+		}
+		}
+	}
+
+	// lea exercises the 16-bit address decoders without touching memory
+	void EmitLea()
+	{
+		const auto size = PickSize();
+		const auto dest = DestReg(size == Byte ? Word : size);
+		const auto mod = static_cast<uint8_t>(Below(3));
+		const auto rm = static_cast<uint8_t>(Below(8));
+		Emit({0x8d, static_cast<uint8_t>((mod << 6) | (dest << 3) | rm)});
+		if (mod == 1)
+			EmitImm(Next32(), Byte);
+		else if (mod == 2 || rm == 6)
+			EmitImm(Next32(), Word);
+	}
+
+	void EmitExtend()
+	{
+		const auto size = Below(2) ? Dword : Word;
+		if (size == Dword)
+			code.push_back(0x66);
+		const auto op = static_cast<uint8_t>(0xb6 | (Below(2) << 3) | Below(2));
+		Emit({0x0f, op,
+		      static_cast<uint8_t>(0xc0 | (DestReg(size) << 3) | Below(8))});
+	}
+
+	void EmitSetcc()
+	{
+		const auto cc = static_cast<uint8_t>(Below(16));
+		if (!Defined(ConditionFlags(cc)))
+			return EmitMov();
+		Emit({0x0f, static_cast<uint8_t>(0x90 | cc),
+		      static_cast<uint8_t>(0xc0 | Below(8))});
+	}
+
+	void EmitBitTest()
+	{
+		const auto size = Below(2) ? Dword : Word;
+		if (size == Dword)
+			code.push_back(0x66);
+		const auto op = static_cast<uint8_t>(4 + Below(4));
+		Emit({0x0f, 0xba, static_cast<uint8_t>(0xc0 | (op << 3) | DestReg(size)),
+		      static_cast<uint8_t>(Below(8u << size))});
+		Flags(FLAG_CF | FLAG_OF | FLAG_SF | FLAG_AF | FLAG_PF,
+		      FLAG_OF | FLAG_SF | FLAG_AF | FLAG_PF);
+	}
+
+	void EmitPushPop()
+	{
+		if (Below(2))
+			code.push_back(0x66);
+		Emit({static_cast<uint8_t>(0x50 | Below(8)),
+		      static_cast<uint8_t>(0x58 | DestReg(Word))});
+	}
+
+	void EmitCarry()
+	{
+		static constexpr uint8_t ops[] = {0xf5, 0xf8, 0xf9}; // cmc clc stc
+		const auto op = ops[Below(3)];
+		if (op == 0xf5 && !Defined(FLAG_CF))
+			return EmitMov();
+		Emit({op});
+		Flags(FLAG_CF, 0);
+	}
+
+	// A forward conditional jump over the instruction that follows it
+	void EmitJcc()
+	{
+		const auto cc = static_cast<uint8_t>(Below(16));
+		if (!Defined(ConditionFlags(cc)))
+			return EmitMov();
+		const auto jump_at = code.size();
+		Emit({static_cast<uint8_t>(0x70 | cc), 0});
+		const auto undefined_if_taken = undefined;
+		EmitSimple();
+		code[jump_at + 1] = static_cast<uint8_t>(code.size() - jump_at - 2);
+		undefined |= undefined_if_taken;
+	}
+
+	void EmitSimple()
+	{
+		switch (Below(12)) {
+		case 0:
+		case 1: EmitAlu(); break;
+		case 2: EmitIncDec(); break;
+		case 3: EmitUnary(); break;
+		case 4: EmitShift(); break;
+		case 5: EmitMul(); break;
+		case 6: EmitMov(); break;
+		case 7: EmitLea(); break;
+		case 8: EmitExtend(); break;
+		case 9: EmitSetcc(); break;
+		case 10: EmitBitTest(); break;
+		default: EmitCarry(); break;
+		}
+	}
+
+	void EmitInstruction()
+	{
+		switch (Below(8)) {
+		case 0: EmitJcc(); break;
+		case 1: EmitPushPop(); break;
+		default: EmitSimple(); break;
+		}
+	}
+
+	std::mt19937 rng;
+	std::vector<uint8_t> code = {};
+	uint32_t undefined = 0;
+};
+
+// Curated sequences
+// -----------------
+// Instructions the generator doesn't produce: string operations, control
+// transfers, BCD adjustment, 32-bit addressing, the FPU and so on.
+
+#define END_SEQUENCE 0xfe, 0x38, (end_callback & 0xff), (end_callback >> 8)
+
+const std::vector<Sequence> curated_sequences = {
+        {"string copy and fill",
+         {0xfc,                   // cld
+          0xbe, 0x20, 0x00,       // mov si, 0x20
+          0xbf, 0x80, 0x00,       // mov di, 0x80
+          0xb9, 0x10, 0x00,       // mov cx, 0x10
+          0xf3, 0xa4,             // rep movsb
+          0xb8, 0xa5, 0xa5,       // mov ax, 0xa5a5
+          0xb9, 0x08, 0x00,       // mov cx, 8
+          0xf3, 0xab,             // rep stosw
+          0xad,                   // lodsw
+          0xaf,                   // scasw
+          END_SEQUENCE}},
+        {"string compare and scan",
+         {0xfc,                   // cld
+          0xbe, 0x00, 0x00,       // mov si, 0
+          0xbf, 0x40, 0x00,       // mov di, 0x40
+          0xb9, 0x20, 0x00,       // mov cx, 0x20
+          0xf3, 0xa6,             // repe cmpsb
+          0x89, 0xca,             // mov dx, cx
+          0xb9, 0x10, 0x00,       // mov cx, 0x10
+          0xb0, 0x00,             // mov al, 0
+          0xf2, 0xae,             // repne scasb
+          END_SEQUENCE}},
+        {"loop, call and ret",
+         {0xb9, 0x05, 0x00,       // mov cx, 5
+          0x31, 0xc0,             // xor ax, ax
+          0x01, 0xc8,             // again: add ax, cx
+          0xc1, 0xc0, 0x03,       // rol ax, 3
+          0xe2, 0xf9,             // loop again
+          0xe8, 0x02, 0x00,       // call sub
+          0xeb, 0x06,             // jmp done
+          0x60,                   // sub: pusha
+          0xf7, 0xd3,             // not bx
+          0x61,                   // popa
+          0x92,                   // xchg ax, dx
+          0xc3,                   // ret
+          0x40,                   // done: inc ax
+          END_SEQUENCE}},
+        {"32-bit arithmetic",
+         {0x66, 0xb8, 0x78, 0x56, 0x34, 0x12,       // mov eax, 0x12345678
+          0x66, 0xbb, 0xf0, 0xde, 0xbc, 0x9a,       // mov ebx, 0x9abcdef0
+          0x66, 0x01, 0xd8,                         // add eax, ebx
+          0x66, 0x81, 0xd3, 0x11, 0x11, 0x11, 0x11, // adc ebx, 0x11111111
+          0x66, 0x99,                               // cdq
+          0x66, 0x0f, 0xaf, 0xc3,                   // imul eax, ebx
+          0x66, 0x0f, 0xa4, 0xd8, 0x07,             // shld eax, ebx, 7
+          0x66, 0x0f, 0xac, 0xc2, 0x05,             // shrd edx, eax, 5
+          0x66, 0x0f, 0xc9,                         // bswap ecx
+          0x66, 0x0f, 0xbe, 0xf0,                   // movsx esi, al
+          0x66, 0x0f, 0xb7, 0xfb,                   // movzx edi, bx
+          END_SEQUENCE},
+         flags_arith & ~(FLAG_OF | FLAG_AF)},
+        {"BCD adjustment",
+         {0xb8, 0x09, 0x09,       // mov ax, 0x0909
+          0x04, 0x08,             // add al, 8
+          0x27,                   // daa
+          0x88, 0xc3,             // mov bl, al
+          0xb0, 0x15,             // mov al, 0x15
+          0x2c, 0x07,             // sub al, 7
+          0x2f,                   // das
+          0x88, 0xc7,             // mov bh, al
+          0xb0, 0x0f,             // mov al, 0x0f
+          0x04, 0x01,             // add al, 1
+          0x37,                   // aaa
+          0x9e,                   // sahf
+          0x9f,                   // lahf
+          END_SEQUENCE},
+         flags_arith & ~FLAG_OF},
+        {"bit scans and tests",
+         {0xb8, 0xf0, 0x00,                   // mov ax, 0xf0
+          0x0f, 0xbc, 0xc8,                   // bsf cx, ax
+          0x0f, 0xbd, 0xd0,                   // bsr dx, ax
+          0x0f, 0xba, 0xe0, 0x05,             // bt ax, 5
+          0x0f, 0xba, 0xe8, 0x03,             // bts ax, 3
+          0x0f, 0xba, 0xf0, 0x07,             // btr ax, 7
+          0x0f, 0xba, 0xf8, 0x0c,             // btc ax, 12
+          0x0f, 0x92, 0xc2,                   // setc dl
+          0x66, 0xbb, 0x01, 0x00, 0x00, 0x80, // mov ebx, 0x80000001
+          0x66, 0x0f, 0xbd, 0xf3,             // bsr esi, ebx
+          0x0f, 0x95, 0xc6,                   // setnz dh
+          END_SEQUENCE},
+         FLAG_ZF},
+        {"read-modify-write memory",
+         {0x81, 0x06, 0x10, 0x00, 0x34, 0x12, // add word [0x10], 0x1234
+          0x80, 0x1e, 0x12, 0x00, 0x05,       // sbb byte [0x12], 5
+          0xd1, 0x06, 0x14, 0x00,             // rol word [0x14], 1
+          0xf7, 0x1e, 0x16, 0x00,             // neg word [0x16]
+          0xa1, 0x18, 0x00,                   // mov ax, [0x18]
+          0x0f, 0xc1, 0x06, 0x1a, 0x00,       // xadd [0x1a], ax
+          0xb0, 0x55,                         // mov al, 0x55
+          0x0f, 0xb0, 0x1e, 0x1c, 0x00,       // cmpxchg [0x1c], bl
+          0xff, 0x06, 0x1e, 0x00,             // inc word [0x1e]
+          0x66, 0xf7, 0x16, 0x20, 0x00,       // not dword [0x20]
+          END_SEQUENCE}},
+        {"stack frames and 32-bit addressing",
+         {0xc8, 0x08, 0x00, 0x00,             // enter 8, 0
+          0x89, 0xe3,                         // mov bx, sp
+          0xc7, 0x46, 0xfe, 0x21, 0x43,       // mov word [bp-2], 0x4321
+          0x8b, 0x4e, 0xfe,                   // mov cx, [bp-2]
+          0xc9,                               // leave
+          0x66, 0xbe, 0x10, 0x00, 0x00, 0x00, // mov esi, 0x10
+          0x66, 0xbf, 0x02, 0x00, 0x00, 0x00, // mov edi, 2
+          0x67, 0x66, 0x8b, 0x44, 0xbe, 0x20, // mov eax, [esi+edi*4+0x20]
+          0x67, 0x66, 0x8d, 0x54, 0xfe, 0x07, // lea edx, [esi+edi*8+7]
+          END_SEQUENCE}},
+        {"shifts and rotates by cl",
+         {0xb1, 0x03,             // mov cl, 3
+          0xb8, 0x21, 0x84,       // mov ax, 0x8421
+          0xd3, 0xe0,             // shl ax, cl
+          0xbb, 0x34, 0x12,       // mov bx, 0x1234
+          0xd3, 0xfb,             // sar bx, cl
+          0xba, 0x78, 0x56,       // mov dx, 0x5678
+          0xd3, 0xda,             // rcr dx, cl
+          0xbe, 0x0f, 0xf0,       // mov si, 0xf00f
+          0xd3, 0xce,             // ror si, cl
+          0xd1, 0xee,             // shr si, 1
+          END_SEQUENCE},
+         flags_arith & ~FLAG_AF},
+        {"multiply, divide and translate",
+         {0xb8, 0x34, 0x12,       // mov ax, 0x1234
+          0xb3, 0x56,             // mov bl, 0x56
+          0xf6, 0xe3,             // mul bl
+          0xba, 0x00, 0x10,       // mov dx, 0x1000
+          0xb8, 0x21, 0x43,       // mov ax, 0x4321
+          0xb9, 0x77, 0x77,       // mov cx, 0x7777
+          0xf7, 0xf1,             // div cx
+          0xbb, 0x30, 0x00,       // mov bx, 0x30
+          0xb0, 0x03,             // mov al, 3
+          0xd7,                   // xlat
+          0xb8, 0x9c, 0xff,       // mov ax, -100
+          0xb1, 0x07,             // mov cl, 7
+          0xf6, 0xf9,             // idiv cl
+          END_SEQUENCE},
+         0},
+        // The FPU sequences store their results to memory and the status
+        // word to ax, which covers the stack top and the condition codes
+        {"FPU register arithmetic",
+         {0xdb, 0xe3,                         // fninit
+          0xc7, 0x06, 0x00, 0x01, 0x07, 0x00, // mov word [0x100], 7
+          0xc7, 0x06, 0x02, 0x01, 0x03, 0x00, // mov word [0x102], 3
+          0xdf, 0x06, 0x00, 0x01,             // fild word [0x100]
+          0xdf, 0x06, 0x02, 0x01,             // fild word [0x102]
+          0xd9, 0xc1,                         // fld st(1)
+          0xd8, 0xc1,                         // fadd st, st(1)
+          0xd8, 0xc9,                         // fmul st, st(1)
+          0xdc, 0xc2,                         // fadd st(2), st
+          0xd8, 0xe2,                         // fsub st, st(2)
+          0xd8, 0xea,                         // fsubr st, st(2)
+          0xd8, 0xf1,                         // fdiv st, st(1)
+          0xd8, 0xf9,                         // fdivr st, st(1)
+          0xdc, 0xca,                         // fmul st(2), st
+          0xdc, 0xe2,                         // fsubr st(2), st
+          0xdc, 0xfa,                         // fdiv st(2), st
+          0xd9, 0xc9,                         // fxch st(1)
+          0xdd, 0xd2,                         // fst st(2)
+          0xde, 0xc1,                         // faddp st(1), st
+          0xdc, 0xe9,                         // fsub st(1), st
+          0xdd, 0x1e, 0x10, 0x01,             // fstp qword [0x110]
+          0xdd, 0x1e, 0x18, 0x01,             // fstp qword [0x118]
+          0xdf, 0xe0,                         // fnstsw ax
+          END_SEQUENCE}},
+        {"FPU memory operands",
+         {0xdb, 0xe3,                         // fninit
+          0xc7, 0x06, 0x20, 0x01, 0x00, 0x00, // mov word [0x120], 0
+          0xc7, 0x06, 0x22, 0x01, 0x20, 0x40, // mov word [0x122], 0x4020
+          0xc7, 0x06, 0x28, 0x01, 0x00, 0x00, // mov word [0x128], 0
+          0xc7, 0x06, 0x2a, 0x01, 0x00, 0x00, // mov word [0x12a], 0
+          0xc7, 0x06, 0x2c, 0x01, 0x00, 0x00, // mov word [0x12c], 0
+          0xc7, 0x06, 0x2e, 0x01, 0xf4, 0x3f, // mov word [0x12e], 0x3ff4
+          0xc7, 0x06, 0x00, 0x01, 0x0b, 0x00, // mov word [0x100], 11
+          0xdf, 0x06, 0x00, 0x01,             // fild word [0x100]
+          0xd8, 0x06, 0x20, 0x01,             // fadd dword [0x120]
+          0xdc, 0x0e, 0x28, 0x01,             // fmul qword [0x128]
+          0xd8, 0x26, 0x20, 0x01,             // fsub dword [0x120]
+          0xdc, 0x2e, 0x28, 0x01,             // fsubr qword [0x128]
+          0xd8, 0x36, 0x20, 0x01,             // fdiv dword [0x120]
+          0xdc, 0x3e, 0x28, 0x01,             // fdivr qword [0x128]
+          0xde, 0x0e, 0x00, 0x01,             // fimul word [0x100]
+          0xd9, 0x16, 0x30, 0x01,             // fst dword [0x130]
+          0xdd, 0x1e, 0x38, 0x01,             // fstp qword [0x138]
+          0xdf, 0xe0,                         // fnstsw ax
+          END_SEQUENCE}},
+        {"FPU stack wrap-around and mixed code",
+         {0xdb, 0xe3,                         // fninit
+          0xd9, 0xe8,                         // fld1
+          0xd9, 0xee,                         // fldz
+          0xd9, 0xeb,                         // fldpi
+          0xd8, 0xc1,                         // fadd st, st(1)
+          0x40,                               // inc ax
+          0xd8, 0xca,                         // fmul st, st(2)
+          0xd9, 0xc9,                         // fxch st(1)
+          0xd9, 0xc2,                         // fld st(2)
+          0xde, 0xc2,                         // faddp st(2), st
+          0xdd, 0xd9,                         // fstp st(1)
+          0xd8, 0xd1,                         // fcom st(1)
+          0xdf, 0xe0,                         // fnstsw ax
+          0x89, 0xc3,                         // mov bx, ax
+          0xd9, 0xe8,                         // fld1
+          0xd9, 0xe8,                         // fld1
+          0xd9, 0xe8,                         // fld1
+          0xd9, 0xe8,                         // fld1
+          0xde, 0xc1,                         // faddp st(1), st
+          0xde, 0xc9,                         // fmulp st(1), st
+          0xde, 0xf9,                         // fdivp st(1), st
+          0xde, 0xe1,                         // fsubrp st(1), st
+          0xdd, 0x1e, 0x40, 0x01,             // fstp qword [0x140]
+          0xdd, 0x1e, 0x48, 0x01,             // fstp qword [0x148]
+          0xdf, 0xe0,                         // fnstsw ax
+          END_SEQUENCE}},
+};
+
+class CPU_CoresTest : public DOSBoxTestFixture {
+protected:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+		cores = available_cores();
+	}
+
+	// Puts the sequence into a new code slot and returns the slot
+	static uint32_t LoadSequence(const Sequence &seq)
+	{
+		EXPECT_LT(next_code_slot, code_slots) << "out of code slots";
+		EXPECT_LE(seq.code.size(), max_code_size);
+		const auto slot = next_code_slot++;
+		const PhysPt code = (code_segment << 4) + slot * code_slot_size;
+		// Written like the guest would, so any translation of the
+		// slot's page learns about the new code
+		for (size_t i = 0; i < seq.code.size(); ++i)
+			mem_writeb(code + static_cast<PhysPt>(i), seq.code[i]);
+		return slot;
+	}
+
+	// Runs the sequence on all cores and compares them to the normal core
+	void RunSequence(const Sequence &seq, const CpuState &initial)
+	{
+		ASSERT_LT(next_code_slot, code_slots) << "out of code slots";
+		ASSERT_LE(seq.code.size(), max_code_size);
+		const auto slot = LoadSequence(seq);
+
+		const auto expected = run_on_core(cores[0], initial, slot);
+		for (size_t i = 1; i < cores.size(); ++i)
+			compare_states(seq, cores[i], expected,
+			               run_on_core(cores[i], initial, slot));
+	}
+
+	std::vector<Core> cores = {};
+};
+
+TEST_F(CPU_CoresTest, CuratedSequences)
+{
+	SequenceGenerator generator(1);
+	for (const auto &seq : curated_sequences)
+		RunSequence(seq, generator.RandomState());
+}
+
+TEST_F(CPU_CoresTest, RandomSequences)
+{
+	constexpr int num_sequences = 500;
+	constexpr int instructions_per_sequence = 24;
+	SequenceGenerator generator(0xd05b0c5);
+	for (int i = 0; i < num_sequences && !HasFailure(); ++i) {
+		const auto seq = generator.Generate(instructions_per_sequence);
+		RunSequence(seq, generator.RandomState());
+	}
+}
+
+#if C_DYNREC
+// Code is interpreted until it's reached for the hot threshold-th time,
+// which translates it
+TEST_F(CPU_CoresTest, DynrecTranslatesOnHotThresholdRun)
+{
+	const Core dynrec = cores.back();
+	ASSERT_STREQ(dynrec.name, "dynrec");
+	const Sequence seq = {"hot threshold",
+	                      {0xb8, 0x01, 0x00, // mov ax, 1
+	                       0x40,             // inc ax
+	                       0x01, 0xc3,       // add bx, ax
+	                       END_SEQUENCE}};
+	ASSERT_LT(next_code_slot, code_slots) << "out of code slots";
+	const auto slot = LoadSequence(seq);
+	SequenceGenerator generator(3);
+	const auto initial = generator.RandomState();
+	const auto expected = run_on_core(cores[0], initial, slot);
+
+	constexpr int hot_threshold = 3;
+	CPU_Core_Dynrec_SetHotThreshold(hot_threshold);
+	for (int run = 1; run <= hot_threshold + 1; ++run) {
+		SCOPED_TRACE("run " + std::to_string(run));
+		const auto translated_before = CPU_Core_Dynrec_TranslatedBlocks();
+		compare_states(seq, dynrec, expected,
+		               run_on_core(dynrec, initial, slot));
+		const auto translated = CPU_Core_Dynrec_TranslatedBlocks() -
+		                        translated_before;
+		EXPECT_EQ(translated, run == hot_threshold ? 1u : 0u);
+	}
+	CPU_Core_Dynrec_SetHotThreshold(1);
+}
+
+// A page that is mostly written as data is handed back to data use, and an
+// instruction at the end of the page before it that runs into it is left to
+// the normal core
+TEST_F(CPU_CoresTest, DynrecDecodesIntoDemotedPage)
+{
+	const Core dynrec = cores.back();
+	ASSERT_STREQ(dynrec.name, "dynrec");
+
+	// The last slot of one page and a slot in the page that follows it
+	constexpr uint32_t slots_per_page = 4096 / code_slot_size;
+	next_code_slot = (next_code_slot + slots_per_page - 1) / slots_per_page *
+	                 slots_per_page;
+	ASSERT_LE(next_code_slot + 2 * slots_per_page, code_slots)
+	        << "out of code slots";
+	const auto code_slot = next_code_slot + slots_per_page - 1;
+	const auto data_slot = next_code_slot + slots_per_page + 1;
+	next_code_slot += 2 * slots_per_page;
+	const PhysPt slot_start = (code_segment << 4) + code_slot * code_slot_size;
+	const PhysPt page_start = slot_start + code_slot_size;
+
+	Sequence seq = {"into a demoted page"};
+	seq.code.assign(code_slot_size - 2, 0x90); // nop
+	seq.code.insert(seq.code.end(), {0xb8, 0x34, 0x12, // mov ax, 0x1234
+	                                 0x40,             // inc ax
+	                                 END_SEQUENCE});
+	for (size_t i = 0; i < seq.code.size(); ++i)
+		mem_writeb(slot_start + static_cast<PhysPt>(i), seq.code[i]);
+	PhysPt data_code = (code_segment << 4) + data_slot * code_slot_size;
+	for (const uint8_t b : {END_SEQUENCE})
+		mem_writeb(data_code++, b);
+
+	SequenceGenerator generator(4);
+	const auto initial = generator.RandomState();
+	auto has_code = [page_start] {
+		return (get_tlb_readhandler(page_start)->flags & PFLAG_HASCODE) != 0;
+	};
+
+	// Translate code in the second page, then write to it as data a lot
+	// more than its code runs, so dynrec demotes it when it next runs
+	run_on_core(dynrec, initial, data_slot);
+	ASSERT_TRUE(has_code());
+	for (const uint8_t val : {0x55, 0xaa, 0x55})
+		for (PhysPt addr = page_start + 0x800; addr < page_start + 0x1000; ++addr)
+			mem_writeb(addr, val);
+	run_on_core(dynrec, initial, data_slot);
+	ASSERT_FALSE(has_code());
+
+	const auto expected = run_on_core(cores[0], initial, code_slot);
+	compare_states(seq, dynrec, expected, run_on_core(dynrec, initial, code_slot));
+	EXPECT_FALSE(has_code());
+}
+#endif
+
+} // namespace
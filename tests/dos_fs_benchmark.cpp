@@ -0,0 +1,650 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Measures the DOS file API over each drive type. DOS is brought up the same
+// way as in the unit test fixture, then the same synthetic tree is placed on:
+//
+//   C: a local directory
+//   D: an overlay on top of C:'s directory
+//   E: a FAT16 hard disk image
+//   F: an ISO 9660 image
+//
+// Each drive is timed opening, reading, seeking in, listing, and (when
+// writable) creating files through DOS_OpenFile, DOS_ReadFile, DOS_SeekFile,
+// DOS_FindFirst/FindNext and DOS_CreateFile. Everything is written to a
+// scratch directory under the system's temporary directory.
+
+#define SDL_MAIN_HANDLED
+
+#include "dos_inc.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "byteorder.h"
+#include "control.h"
+#include "cross.h"
+#include "dos_system.h"
+#include "drives.h"
+#include "setup.h"
+#include "support.h"
+#include "video.h"
+
+namespace {
+
+constexpr int num_dirs = 8;
+constexpr int files_per_dir = 64;
+constexpr uint16_t file_size = 16 * 1024;
+constexpr uint32_t big_file_size = 4 * 1024 * 1024;
+constexpr uint16_t read_chunk = 4096;
+constexpr uint16_t big_read_chunk = 32 * 1024;
+constexpr int open_passes = 4;
+constexpr int find_passes = 16;
+constexpr int seek_reads = 20000;
+constexpr int created_files = 256;
+constexpr uint16_t created_file_size = 4096;
+
+// Brings up the same sections as DOSBoxTestFixture, minus gtest
+class DOSBoxSession {
+public:
+	DOSBoxSession() : com_line(3, argv)
+	{
+		control = std::make_unique<Config>(&com_line);
+		CROSS_DetermineConfigPaths();
+		SETUP_ParseConfigFiles(CROSS_GetPlatformConfigDir());
+		DOSBOX_Init();
+		control->GetSection("mixer")->HandleInputline("nosound=true");
+		for (const auto &name : sections)
+			control->GetSection(name)->ExecuteEarlyInit();
+		for (const auto &name : sections)
+			control->GetSection(name)->ExecuteInit();
+
+		// Without a shell, give DOS a PSP for the file handles and a
+		// DTA for the searches
+		DOS_PSP psp(DOS_FIRST_SHELL);
+		psp.MakeNew(0);
+		dos.psp(DOS_FIRST_SHELL);
+		dos.dta(dos.tables.tempdta);
+	}
+
+	~DOSBoxSession()
+	{
+		for (auto r = sections.rbegin(); r != sections.rend(); ++r)
+			control->GetSection(*r)->ExecuteDestroy();
+		GFX_RequestExit(true);
+	}
+
+	DOSBoxSession(const DOSBoxSession &) = delete;
+	DOSBoxSession &operator=(const DOSBoxSession &) = delete;
+
+private:
+	const char *argv[3] = {"dosbox", "-noprimaryconf", "-nolocalconf"};
+	CommandLine com_line;
+	const std::vector<std::string> sections = {"dosbox", "cpu",      "mixer",
+	                                           "midi",   "sblaster", "speaker",
+	                                           "serial", "dos",      "autoexec"};
+};
+
+// The tree: DIR00-DIR07 holding FILE0000.DAT-FILE0063.DAT, and BIG.DAT in
+// the root. Every file's content depends on its index.
+std::string dir_name(const int d)
+{
+	char name[8];
+	snprintf(name, sizeof(name), "DIR%02d", d);
+	return name;
+}
+
+std::string file_name(const int f)
+{
+	char name[16];
+	snprintf(name, sizeof(name), "FILE%04d.DAT", f);
+	return name;
+}
+
+std::vector<uint8_t> file_content(const int index, const size_t size)
+{
+	std::vector<uint8_t> data(size);
+	for (size_t i = 0; i < size; ++i)
+		data[i] = static_cast<uint8_t>(index * 31 + i);
+	return data;
+}
+
+std::string dos_path(const char drive, const std::string &path)
+{
+	return std::string(1, drive) + ":\\" + path;
+}
+
+bool write_dos_file(const std::string &path, std::vector<uint8_t> &data)
+{
+	uint16_t handle = 0;
+	if (!DOS_CreateFile(path.c_str(), DOS_ATTR_ARCHIVE, &handle))
+		return false;
+	size_t pos = 0;
+	while (pos < data.size()) {
+		auto amount = static_cast<uint16_t>(
+		        std::min<size_t>(big_read_chunk, data.size() - pos));
+		if (!DOS_WriteFile(handle, data.data() + pos, &amount) || !amount)
+			break;
+		pos += amount;
+	}
+	DOS_CloseFile(handle);
+	return pos == data.size();
+}
+
+bool populate(const char drive)
+{
+	for (int d = 0; d < num_dirs; ++d) {
+		const auto dir = dos_path(drive, dir_name(d));
+		if (!DOS_MakeDir(dir.c_str()))
+			return false;
+		for (int f = 0; f < files_per_dir; ++f) {
+			auto data = file_content(d * files_per_dir + f, file_size);
+			if (!write_dos_file(dir + "\\" + file_name(f), data))
+				return false;
+		}
+	}
+	auto big = file_content(-1, big_file_size);
+	return write_dos_file(dos_path(drive, "BIG.DAT"), big);
+}
+
+// A 32 MiB hard disk image with one empty FAT16 partition. The files are
+// added through the drive itself.
+constexpr uint32_t fat_heads = 16;
+constexpr uint32_t fat_sectors_per_track = 63;
+constexpr uint32_t fat_cylinders = 65;
+
+bool make_fat_image(const std::string &path)
+{
+	constexpr uint32_t total_sectors = fat_heads * fat_sectors_per_track *
+	                                   fat_cylinders;
+	constexpr uint32_t part_start = fat_sectors_per_track;
+	constexpr uint32_t part_size = total_sectors - part_start;
+	constexpr uint16_t sectors_per_fat = 64;
+
+	partTable mbr = {};
+	mbr.pentry[0].bootflag = 0x80;
+	mbr.pentry[0].parttype = 0x06; // FAT16
+	mbr.pentry[0].absSectStart = host_to_le32(part_start);
+	mbr.pentry[0].partSize = host_to_le32(part_size);
+	mbr.magic1 = 0x55;
+	mbr.magic2 = 0xaa;
+
+	bootstrap boot = {};
+	boot.nearjmp[0] = 0xeb;
+	boot.nearjmp[1] = 0x3c;
+	boot.nearjmp[2] = 0x90;
+	memcpy(boot.oemname, "MSDOS5.0", 8);
+	boot.bytespersector = host_to_le16(512);
+	boot.sectorspercluster = 4;
+	boot.reservedsectors = host_to_le16(1);
+	boot.fatcopies = 2;
+	boot.rootdirentries = host_to_le16(512);
+	boot.totalsectorcount = host_to_le16(static_cast<uint16_t>(part_size));
+	boot.mediadescriptor = 0xf8;
+	boot.sectorsperfat = host_to_le16(sectors_per_fat);
+	boot.sectorspertrack = host_to_le16(fat_sectors_per_track);
+	boot.headcount = host_to_le16(fat_heads);
+	boot.hiddensectorcount = host_to_le32(part_start);
+	boot.magic1 = 0x55;
+	boot.magic2 = 0xaa;
+
+	std::vector<uint8_t> image(total_sectors * 512);
+	memcpy(image.data(), &mbr, sizeof(mbr));
+	memcpy(image.data() + part_start * 512, &boot, sizeof(boot));
+	// Reserve clusters 0 and 1 in both FATs
+	for (uint32_t fat = 0; fat < 2; ++fat) {
+		auto entries = image.data() + (part_start + 1 + fat * sectors_per_fat) * 512;
+		const uint8_t reserved[4] = {0xf8, 0xff, 0xff, 0xff};
+		memcpy(entries, reserved, sizeof(reserved));
+	}
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char *>(image.data()),
+	           static_cast<std::streamsize>(image.size()));
+	return file.good();
+}
+
+// Builds an ISO 9660 image of the same tree: the volume descriptors, the root
+// directory, both path tables, the subdirectories, then the file data.
+class IsoBuilder {
+public:
+	bool Write(const std::string &path)
+	{
+		constexpr uint32_t root_lba = 18;
+		constexpr uint32_t path_table_lba = 19;
+		std::vector<uint32_t> dir_lbas(num_dirs);
+		std::vector<uint32_t> dir_sizes(num_dirs);
+		uint32_t lba = path_table_lba + 2;
+		for (int d = 0; d < num_dirs; ++d) {
+			dir_lbas[d] = lba;
+			dir_sizes[d] = DirSectors(files_per_dir) * frame_size;
+			lba += dir_sizes[d] / frame_size;
+		}
+		const auto big_lba = lba;
+		lba += Sectors(big_file_size);
+		const auto first_file_lba = lba;
+		lba += num_dirs * files_per_dir * Sectors(file_size);
+		image.assign(static_cast<size_t>(lba) * frame_size, 0);
+
+		// Root directory
+		Directory root(Sector(root_lba));
+		root.Add(root_lba, frame_size, dir_flag, std::string(1, '\0'));
+		root.Add(root_lba, frame_size, dir_flag, std::string(1, '\1'));
+		root.Add(big_lba, big_file_size, 0, "BIG.DAT;1");
+		for (int d = 0; d < num_dirs; ++d)
+			root.Add(dir_lbas[d], dir_sizes[d], dir_flag, dir_name(d));
+		const auto big = file_content(-1, big_file_size);
+		std::copy(big.begin(), big.end(), Sector(big_lba));
+
+		// Subdirectories and their files
+		auto file_lba = first_file_lba;
+		for (int d = 0; d < num_dirs; ++d) {
+			Directory dir(Sector(dir_lbas[d]));
+			dir.Add(dir_lbas[d], dir_sizes[d], dir_flag, std::string(1, '\0'));
+			dir.Add(root_lba, frame_size, dir_flag, std::string(1, '\1'));
+			for (int f = 0; f < files_per_dir; ++f) {
+				dir.Add(file_lba, file_size, 0, file_name(f) + ";1");
+				const auto data = file_content(d * files_per_dir + f,
+				                               file_size);
+				std::copy(data.begin(), data.end(), Sector(file_lba));
+				file_lba += Sectors(file_size);
+			}
+		}
+
+		// Little- and big-endian path tables, which DOSBox doesn't use
+		// but other readers require
+		auto l_table = Sector(path_table_lba);
+		auto m_table = Sector(path_table_lba + 1);
+		size_t table_size = 0;
+		auto add_path = [&](const uint32_t dir_lba, const std::string &ident) {
+			l_table[table_size] = m_table[table_size] =
+			        static_cast<uint8_t>(ident.size());
+			for (int i = 0; i < 4; ++i) {
+				l_table[table_size + 2 + i] = static_cast<uint8_t>(dir_lba >> (8 * i));
+				m_table[table_size + 5 - i] = static_cast<uint8_t>(dir_lba >> (8 * i));
+			}
+			l_table[table_size + 6] = 1; // parent is the root
+			m_table[table_size + 7] = 1;
+			memcpy(l_table + table_size + 8, ident.data(), ident.size());
+			memcpy(m_table + table_size + 8, ident.data(), ident.size());
+			table_size += 8 + ident.size() + ident.size() % 2;
+		};
+		add_path(root_lba, std::string(1, '\0'));
+		for (int d = 0; d < num_dirs; ++d)
+			add_path(dir_lbas[d], dir_name(d));
+
+		// Primary volume descriptor and terminator
+		uint8_t *pvd = Sector(16);
+		pvd[0] = 1;
+		memcpy(pvd + 1, "CD001", 5);
+		pvd[6] = 1;
+		memset(pvd + 8, ' ', 64);
+		memcpy(pvd + 40, "DOSFSBENCH", 10);
+		PutBoth32(pvd + 80, lba);
+		PutBoth16(pvd + 120, 1);
+		PutBoth16(pvd + 124, 1);
+		PutBoth16(pvd + 128, frame_size);
+		PutBoth32(pvd + 132, static_cast<uint32_t>(table_size));
+		for (int i = 0; i < 4; ++i) {
+			pvd[140 + i] = static_cast<uint8_t>(path_table_lba >> (8 * i));
+			pvd[151 - i] = static_cast<uint8_t>((path_table_lba + 1) >> (8 * i));
+		}
+		Directory root_entry(pvd + 156);
+		root_entry.Add(root_lba, frame_size, dir_flag, std::string(1, '\0'));
+		pvd[881] = 1;
+		uint8_t *terminator = Sector(17);
+		terminator[0] = 255;
+		memcpy(terminator + 1, "CD001", 5);
+		terminator[6] = 1;
+
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char *>(image.data()),
+		           static_cast<std::streamsize>(image.size()));
+		return file.good();
+	}
+
+private:
+	static constexpr uint32_t frame_size = 2048;
+	static constexpr uint8_t dir_flag = 2;
+
+	static void PutBoth16(uint8_t *p, const uint16_t val)
+	{
+		p[0] = p[3] = static_cast<uint8_t>(val);
+		p[1] = p[2] = static_cast<uint8_t>(val >> 8);
+	}
+
+	static void PutBoth32(uint8_t *p, const uint32_t val)
+	{
+		for (int i = 0; i < 4; ++i)
+			p[i] = p[7 - i] = static_cast<uint8_t>(val >> (8 * i));
+	}
+
+	static uint32_t Sectors(const uint32_t bytes)
+	{
+		return (bytes + frame_size - 1) / frame_size;
+	}
+
+	static constexpr size_t RecordSize(const size_t ident_length)
+	{
+		return 33 + ident_length + (ident_length % 2 == 0 ? 1 : 0);
+	}
+
+	// "." and ".." plus the files, without records crossing sectors
+	static uint32_t DirSectors(const int files)
+	{
+		const auto record = RecordSize(file_name(0).size() + 2);
+		const auto first = (frame_size - 2 * RecordSize(1)) / record;
+		const auto per_sector = frame_size / record;
+		const auto rest = files > static_cast<int>(first)
+		                        ? files - static_cast<int>(first)
+		                        : 0;
+		return 1 + static_cast<uint32_t>((rest + per_sector - 1) / per_sector);
+	}
+
+	uint8_t *Sector(const uint32_t lba)
+	{
+		return image.data() + static_cast<size_t>(lba) * frame_size;
+	}
+
+	class Directory {
+	public:
+		Directory(uint8_t *start) : data(start) {}
+
+		void Add(const uint32_t lba, const uint32_t size,
+		         const uint8_t flags, const std::string &ident)
+		{
+			const auto length = RecordSize(ident.size());
+			if (pos % frame_size + length > frame_size)
+				pos += frame_size - pos % frame_size;
+			uint8_t *r = data + pos;
+			r[0] = static_cast<uint8_t>(length);
+			PutBoth32(r + 2, lba);
+			PutBoth32(r + 10, size);
+			r[18] = 122; // 2022-01-01
+			r[19] = 1;
+			r[20] = 1;
+			r[25] = flags;
+			PutBoth16(r + 28, 1);
+			r[32] = static_cast<uint8_t>(ident.size());
+			memcpy(r + 33, ident.data(), ident.size());
+			pos += length;
+		}
+
+	private:
+		uint8_t *data = nullptr;
+		size_t pos = 0;
+	};
+
+	std::vector<uint8_t> image = {};
+};
+
+struct Measurement {
+	double seconds = 0.0;
+	uint64_t ops = 0;
+	uint64_t bytes = 0;
+};
+
+using clock_type = std::chrono::steady_clock;
+
+double seconds_since(const clock_type::time_point start)
+{
+	return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+void report(const char *drive, const char *op, const Measurement &m)
+{
+	printf("%-8s %-8s %10.0f ops/s", drive, op, m.ops / m.seconds);
+	if (m.bytes)
+		printf(" %9.1f MiB/s", m.bytes / m.seconds / (1024 * 1024));
+	printf("\n");
+	fflush(stdout);
+}
+
+std::string tree_file(const char drive, const int d, const int f)
+{
+	return dos_path(drive, dir_name(d) + "\\" + file_name(f));
+}
+
+uint64_t read_whole_file(const std::string &path, const uint16_t chunk)
+{
+	static std::vector<uint8_t> buffer(big_read_chunk);
+	uint16_t handle = 0;
+	if (!DOS_OpenFile(path.c_str(), OPEN_READ, &handle))
+		return 0;
+	uint64_t total = 0;
+	while (true) {
+		auto amount = chunk;
+		if (!DOS_ReadFile(handle, buffer.data(), &amount) || !amount)
+			break;
+		total += amount;
+	}
+	DOS_CloseFile(handle);
+	return total;
+}
+
+Measurement time_open(const char drive)
+{
+	Measurement m;
+	const auto start = clock_type::now();
+	for (int pass = 0; pass < open_passes; ++pass) {
+		for (int d = 0; d < num_dirs; ++d) {
+			for (int f = 0; f < files_per_dir; ++f) {
+				const auto path = tree_file(drive, d, f);
+				uint16_t handle = 0;
+				if (DOS_OpenFile(path.c_str(), OPEN_READ, &handle)) {
+					DOS_CloseFile(handle);
+					++m.ops;
+				}
+			}
+		}
+	}
+	m.seconds = seconds_since(start);
+	return m;
+}
+
+Measurement time_read(const char drive)
+{
+	Measurement m;
+	const auto start = clock_type::now();
+	for (int d = 0; d < num_dirs; ++d) {
+		for (int f = 0; f < files_per_dir; ++f) {
+			m.bytes += read_whole_file(tree_file(drive, d, f), read_chunk);
+			++m.ops;
+		}
+	}
+	m.seconds = seconds_since(start);
+	return m;
+}
+
+Measurement time_read_big(const char drive)
+{
+	Measurement m;
+	const auto start = clock_type::now();
+	m.bytes = read_whole_file(dos_path(drive, "BIG.DAT"), big_read_chunk);
+	m.ops = m.bytes / big_read_chunk;
+	m.seconds = seconds_since(start);
+	return m;
+}
+
+// Random 512-byte reads from the big file
+Measurement time_seek(const char drive)
+{
+	Measurement m;
+	uint16_t handle = 0;
+	if (!DOS_OpenFile(dos_path(drive, "BIG.DAT").c_str(), OPEN_READ, &handle))
+		return m;
+	uint8_t buffer[512];
+	uint32_t seed = 0x1234567;
+	const auto start = clock_type::now();
+	for (int i = 0; i < seek_reads; ++i) {
+		seed = seed * 1103515245 + 12345;
+		uint32_t pos = seed % (big_file_size - sizeof(buffer));
+		uint16_t amount = sizeof(buffer);
+		DOS_SeekFile(handle, &pos, DOS_SEEK_SET);
+		DOS_ReadFile(handle, buffer, &amount);
+		m.bytes += amount;
+		++m.ops;
+	}
+	m.seconds = seconds_since(start);
+	DOS_CloseFile(handle);
+	return m;
+}
+
+// Counts every directory entry returned by FindFirst/FindNext
+Measurement time_find(const char drive)
+{
+	Measurement m;
+	const auto start = clock_type::now();
+	for (int pass = 0; pass < find_passes; ++pass) {
+		for (int d = 0; d < num_dirs; ++d) {
+			const auto pattern = dos_path(drive, dir_name(d) + "\\*.*");
+			bool found = DOS_FindFirst(pattern.c_str(), 0);
+			while (found) {
+				++m.ops;
+				found = DOS_FindNext();
+			}
+		}
+	}
+	m.seconds = seconds_since(start);
+	return m;
+}
+
+// Creates and writes small files in a new directory, then removes them
+// untimed
+Measurement time_create(const char drive)
+{
+	Measurement m;
+	const auto new_dir = dos_path(drive, "NEW");
+	DOS_MakeDir(new_dir.c_str());
+	auto data = file_content(0, created_file_size);
+	const auto start = clock_type::now();
+	for (int f = 0; f < created_files; ++f) {
+		if (write_dos_file(new_dir + "\\" + file_name(f), data)) {
+			m.bytes += data.size();
+			++m.ops;
+		}
+	}
+	m.seconds = seconds_since(start);
+	for (int f = 0; f < created_files; ++f)
+		DOS_UnlinkFile((new_dir + "\\" + file_name(f)).c_str());
+	DOS_RemoveDir(new_dir.c_str());
+	return m;
+}
+
+void run_drive(const char *name, const char drive, const bool is_writable)
+{
+	report(name, "open", time_open(drive));
+	report(name, "read", time_read(drive));
+	report(name, "readbig", time_read_big(drive));
+	report(name, "seek", time_seek(drive));
+	report(name, "find", time_find(drive));
+	if (is_writable)
+		report(name, "create", time_create(drive));
+}
+
+void unmount(const char drive)
+{
+	const auto index = drive_index(drive);
+	if (Drives[index] && DriveManager::UnmountDrive(index) == 0)
+		Drives[index] = nullptr;
+}
+
+} // namespace
+
+int main()
+{
+	const auto scratch = std_fs::temp_directory_path() / "dosbox_dos_fs_benchmark";
+	std_fs::remove_all(scratch);
+	const auto base_dir = scratch / "base";
+	const auto overlay_dir = scratch / "overlay";
+	const auto fat_image = (scratch / "fat16.img").string();
+	const auto iso_image = (scratch / "tree.iso").string();
+	std_fs::create_directories(base_dir);
+	std_fs::create_directories(overlay_dir);
+
+	DOSBoxSession session;
+
+	// Local directory, filled through DOS
+	const auto base = base_dir.string() + CROSS_FILESPLIT;
+	Drives[drive_index('C')] = new localDrive(base.c_str(), 512, 32, 32765,
+	                                          16000, 0xf8);
+	if (!populate('C')) {
+		fprintf(stderr, "Can't write the tree to %s\n", base.c_str());
+		return 1;
+	}
+
+	// Overlay on the now-filled directory
+	uint8_t overlay_error = 0;
+	const auto overlay = overlay_dir.string() + CROSS_FILESPLIT;
+	Drives[drive_index('D')] = new Overlay_Drive(base.c_str(), overlay.c_str(),
+	                                             512, 32, 32765, 16000, 0xf8,
+	                                             overlay_error);
+	if (overlay_error) {
+		fprintf(stderr, "Can't overlay %s (error %u)\n", overlay.c_str(),
+		        overlay_error);
+		delete Drives[drive_index('D')];
+		Drives[drive_index('D')] = nullptr;
+	}
+
+	// FAT16 image, filled through DOS
+	if (!make_fat_image(fat_image))
+		return 1;
+	auto fat = new fatDrive(fat_image.c_str(), 512, fat_sectors_per_track,
+	                        fat_heads, fat_cylinders, 0, false);
+	if (!fat->created_successfully) {
+		fprintf(stderr, "Can't mount %s\n", fat_image.c_str());
+		return 1;
+	}
+	DriveManager::AppendDisk(drive_index('E'), fat);
+	DriveManager::InitializeDrive(drive_index('E'));
+	if (!populate('E')) {
+		fprintf(stderr, "Can't write the tree to %s\n", fat_image.c_str());
+		return 1;
+	}
+
+	// ISO image, built on the host
+	IsoBuilder iso_builder;
+	if (!iso_builder.Write(iso_image))
+		return 1;
+	int iso_error = 0;
+	auto iso = new isoDrive('F', iso_image.c_str(), 0xf8, iso_error);
+	if (iso_error) {
+		fprintf(stderr, "Can't mount %s (error %d)\n", iso_image.c_str(),
+		        iso_error);
+		return 1;
+	}
+	DriveManager::AppendDisk(drive_index('F'), iso);
+	DriveManager::InitializeDrive(drive_index('F'));
+
+	run_drive("local", 'C', true);
+	if (overlay_error == 0)
+		run_drive("overlay", 'D', true);
+	run_drive("fat", 'E', true);
+	run_drive("iso", 'F', false);
+
+	for (const auto drive : {'F', 'E', 'D', 'C'})
+		unmount(drive);
+	std_fs::remove_all(scratch);
+	return 0;
+}
@@ -195,4 +195,25 @@ TEST(iohandler_containers, adjacent_dword_write)
 	EXPECT_EQ(read_word_from_port(word_port_start), val >> 16);
 }
 
+TEST(iohandler_containers, block_read)
+{
+	constexpr io_port_t port = 0x1f0;
+	uint8_t dest[8] = {};
+
+	// without a block handler nothing is transferred
+	EXPECT_EQ(read_block_from_port(port, dest, 4, io_width_t::word), 0u);
+
+	IO_RegisterBlockReadHandler(port, [](io_port_t, uint8_t *d, size_t count, io_width_t width) {
+		const auto n = std::min<size_t>(count, 3);
+		memset(d, 0xab, n * static_cast<size_t>(width));
+		return n;
+	});
+	EXPECT_EQ(read_block_from_port(port, dest, 4, io_width_t::word), 3u);
+	EXPECT_EQ(dest[5], 0xab);
+	EXPECT_EQ(dest[6], 0);
+
+	IO_FreeBlockReadHandler(port);
+	EXPECT_EQ(read_block_from_port(port, dest, 4, io_width_t::word), 0u);
+}
+
 } // namespace
@@ -0,0 +1,139 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Compares the per-pixel Normal2x/Normal3x scaler templates against the
+// integer nearest-neighbour blitter at 1080p and 4K output sizes. Every
+// frame differs from the previous one, so each line is fully redrawn.
+// Sources are kept within SCALER_MAXWIDTH and SCALER_MAXHEIGHT, as the
+// renderer rejects anything larger.
+
+#include "../src/gui/render_scalers.cpp"
+#include "../src/gui/render_nearest.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+Render_t render;
+
+namespace {
+
+constexpr int frames_per_run = 60;
+
+struct Frame {
+	int width = 0;
+	int height = 0;
+	int pixel_size = 0;
+	int scale = 0;
+	std::vector<uint8_t> sources[2] = {};
+	std::vector<uint8_t> cache = {};
+	std::vector<uint8_t> output = {};
+};
+
+Frame make_frame(const int width, const int height, const int pixel_size,
+                 const int scale)
+{
+	Frame f;
+	f.width = width;
+	f.height = height;
+	f.pixel_size = pixel_size;
+	f.scale = scale;
+	uint32_t seed = 0x1234567;
+	for (auto &source : f.sources) {
+		source.resize(static_cast<size_t>(width * height * pixel_size));
+		for (auto &b : source) {
+			seed = seed * 1103515245 + 12345;
+			b = static_cast<uint8_t>(seed >> 16);
+		}
+	}
+	f.cache.resize(f.sources[0].size());
+	f.output.resize(f.sources[0].size() * scale * scale);
+	return f;
+}
+
+// Drives a line handler over one frame the way RENDER_DrawLine does
+void draw_frame(Frame &f, const ScalerLineHandler_t handler, const int index)
+{
+	const auto pitch = f.width * f.pixel_size;
+	render.src.width = static_cast<uint32_t>(f.width);
+	render.scale.cachePitch = static_cast<uint32_t>(pitch);
+	render.scale.cacheRead = f.cache.data();
+	render.scale.outWrite = f.output.data();
+	render.scale.outPitch = pitch * f.scale;
+	render.scale.outLine = 0;
+	render.scale.xscale = static_cast<uint32_t>(f.scale);
+	render.scale.pixelSize = static_cast<uint32_t>(f.pixel_size);
+	Scaler_ChangedLineIndex = 0;
+	Scaler_ChangedLines[0] = 0;
+
+	const uint8_t *src = f.sources[index & 1].data();
+	for (int y = 0; y < f.height; ++y, src += pitch)
+		handler(src);
+}
+
+double run(Frame &f, const ScalerLineHandler_t handler)
+{
+	draw_frame(f, handler, 0); // warm up the caches
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 1; i <= frames_per_run; ++i)
+		draw_frame(f, handler, i);
+	const std::chrono::duration<double, std::micro> elapsed =
+	        std::chrono::steady_clock::now() - start;
+	return elapsed.count() / frames_per_run;
+}
+
+bool compare(const char *name, ScalerLineHandler_t reference, const int width,
+             const int height, const int pixel_size, const int scale)
+{
+	if (width > SCALER_MAXWIDTH || height > SCALER_MAXHEIGHT) {
+		printf("%-9s %4dx%-4d skipped, larger than the renderer accepts\n",
+		       name, width, height);
+		return true;
+	}
+	for (int y = 0; y < height; ++y)
+		Scaler_Aspect[y] = static_cast<uint8_t>(scale);
+
+	auto f = make_frame(width, height, pixel_size, scale);
+	const auto reference_us = run(f, reference);
+	const auto reference_output = f.output;
+	const auto nearest_us = run(f, Scaler_NearestLine);
+	const auto matches = (f.output == reference_output);
+
+	printf("%-9s %4dx%-4d -> %4dx%-4d %dbpp: template %8.1f us/frame, "
+	       "nearest %8.1f us/frame (%.2fx)%s\n",
+	       name, width, height, width * scale, height * scale,
+	       pixel_size * 8, reference_us, nearest_us,
+	       reference_us / nearest_us, matches ? "" : " MISMATCH");
+	return matches;
+}
+
+} // namespace
+
+int main()
+{
+	bool ok = true;
+	ok &= compare("normal2x", Normal2x_32_32_L, 960, 540, 4, 2);
+	ok &= compare("normal3x", Normal3x_32_32_L, 640, 360, 4, 3);
+	ok &= compare("normal2x", Normal2x_32_32_L, 1600, 1200, 4, 2);
+	ok &= compare("normal3x", Normal3x_32_32_L, 1280, 720, 4, 3);
+	ok &= compare("normal2x", Normal2x_8_8_L, 960, 540, 1, 2);
+	ok &= compare("normal3x", Normal3x_8_8_L, 1280, 720, 1, 3);
+	return ok ? 0 : 1;
+}
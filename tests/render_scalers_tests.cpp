@@ -0,0 +1,338 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// The VGA dirty page tracking hands lines nothing was written to over as
+// null lines (RENDER_NULL_INPUT). Every scaler must treat them exactly like
+// an unchanged copy of the previous frame's line, so each one is fed the same
+// frames twice, once with the unchanged lines and once with null lines. The
+// outputs have to match after every frame, and the changed line lists have
+// to cover every output line that differs from the frame before.
+
+#include "../src/gui/render_scalers.cpp"
+#include "../src/gui/render_nearest.cpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+Render_t render;
+
+namespace {
+
+// A multiple of SCALER_BLOCKSIZE, like the widths of the video modes
+constexpr uint32_t width = 320;
+constexpr uint32_t height = 48;
+
+// Bytes per pixel of the line handler columns and the output modes
+constexpr uint32_t source_sizes[] = {1, 2, 2, 3, 4};
+constexpr uint32_t output_sizes[] = {1, 2, 2, 4};
+
+struct Pipeline {
+	std::string name = {};
+	ScalerLineHandler_t line_handler = nullptr;
+	ScalerComplexHandler_t complex_handler = nullptr;
+	uint32_t xscale = 1;
+	uint32_t yscale = 1;
+	uint32_t source_size = 1;
+	uint32_t output_size = 1;
+	uint32_t nearest_pixel_size = 0;
+};
+
+struct FrameResult {
+	std::vector<uint8_t> output = {};
+	std::vector<uint16_t> changed_lines = {};
+};
+
+// The lines of a frame follow each other like they do in video memory, with
+// some slack at the end for the handlers that compare a few bytes past the
+// end of the line
+struct Frame {
+	uint32_t pitch = 0;
+	std::vector<uint8_t> data = {};
+
+	uint8_t *Line(const uint32_t y) { return data.data() + y * pitch; }
+	const uint8_t *Line(const uint32_t y) const
+	{
+		return data.data() + y * pitch;
+	}
+	bool SameLine(const Frame &other, const uint32_t y) const
+	{
+		return std::memcmp(Line(y), other.Line(y), pitch) == 0;
+	}
+};
+
+uint32_t seed = 0x2545f491;
+
+uint8_t random_byte()
+{
+	seed = seed * 1103515245 + 12345;
+	return static_cast<uint8_t>(seed >> 16);
+}
+
+// The first frame is random, each later one changes the given lines of the
+// frame before it, from single pixels to whole lines
+std::vector<Frame> make_frames(const uint32_t source_size)
+{
+	const auto pitch = width * source_size;
+	Frame frame = {pitch, std::vector<uint8_t>(pitch * height + sizeof(Bitu))};
+	for (auto &b : frame.data)
+		b = random_byte();
+
+	const std::vector<std::set<uint32_t>> changes = {
+	        {0, 7, 8, 23, height - 1},
+	        {},
+	        {5, 30},
+	        {1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21},
+	        {height - 2},
+	};
+	std::vector<Frame> frames = {frame};
+	for (const auto &changed : changes) {
+		for (const auto y : changed) {
+			auto line = frame.Line(y);
+			// Alternate between a single pixel, one block and the
+			// whole line
+			switch (y % 3) {
+			case 0: line[pitch / 2] ^= 0x5a; break;
+			case 1:
+				for (uint32_t x = 0; x < SCALER_BLOCKSIZE * source_size; ++x)
+					line[x + 4 * source_size] ^= 0xa5;
+				break;
+			default:
+				for (uint32_t x = 0; x < pitch; ++x)
+					line[x] = random_byte();
+				break;
+			}
+		}
+		frames.push_back(frame);
+	}
+	return frames;
+}
+
+// Drives the line handler over every frame the way RENDER_StartUpdate and
+// RENDER_DrawLine do, starting with a cleared cache
+std::vector<FrameResult> run_pipeline(const Pipeline &p,
+                                      const std::vector<Frame> &frames,
+                                      const bool pass_null_lines)
+{
+	render.src.width = width;
+	render.src.start = width * p.source_size / sizeof(Bitu);
+	render.scale.cachePitch = width * p.source_size;
+	render.scale.blocks = width / SCALER_BLOCKSIZE;
+	render.scale.lastBlock = width % SCALER_BLOCKSIZE;
+	render.scale.inHeight = height;
+	render.scale.complexHandler = p.complex_handler;
+	render.scale.xscale = p.xscale;
+	render.scale.pixelSize = p.nearest_pixel_size;
+	// As MakeAspectTable does, the complex scalers lag a line behind
+	const uint32_t skip = p.complex_handler ? 1 : 0;
+	for (uint32_t y = 0; y < height + skip; ++y)
+		Scaler_Aspect[y] = static_cast<uint8_t>(y < skip ? 0 : p.yscale);
+
+	// The complex scalers read a little past the edges of the frame cache,
+	// so both runs start out from the same leftovers
+	std::memset(&scalerSourceCache, 0, sizeof(scalerSourceCache));
+	std::memset(&scalerChangeCache, 0, sizeof(scalerChangeCache));
+
+	const auto out_pitch = width * p.xscale * p.output_size;
+	// Room for the line the complex scalers may write past the end
+	std::vector<uint8_t> output(out_pitch * (height + 1) * p.yscale);
+
+	std::vector<FrameResult> results = {};
+	for (size_t f = 0; f < frames.size(); ++f) {
+		render.scale.inLine = 0;
+		render.scale.outLine = 0;
+		render.scale.cacheRead = reinterpret_cast<uint8_t *>(&scalerSourceCache);
+		render.scale.outWrite = output.data();
+		render.scale.outPitch = static_cast<int>(out_pitch);
+		Scaler_ChangedLines[0] = 0;
+		Scaler_ChangedLineIndex = 0;
+
+		for (uint32_t y = 0; y < height; ++y) {
+			const auto line = frames[f].Line(y);
+			if (f == 0) {
+				// As RENDER_ClearCacheHandler does
+				auto cache = render.scale.cacheRead;
+				for (uint32_t x = 0; x < render.scale.cachePitch; ++x)
+					cache[x] = static_cast<uint8_t>(~line[x]);
+			}
+			const bool unchanged = f > 0 && frames[f].SameLine(frames[f - 1], y);
+			p.line_handler((pass_null_lines && unchanged) ? nullptr : line);
+		}
+
+		FrameResult result = {};
+		result.output = output;
+		result.changed_lines.assign(Scaler_ChangedLines,
+		                            Scaler_ChangedLines +
+		                                    Scaler_ChangedLineIndex + 1);
+		results.push_back(std::move(result));
+	}
+	return results;
+}
+
+// Scaler_ChangedLines alternates between runs of unchanged and changed
+// output lines, starting with an unchanged one
+std::vector<bool> flagged_lines(const FrameResult &result, const size_t num_lines)
+{
+	std::vector<bool> flagged(num_lines, false);
+	size_t y = 0;
+	for (size_t i = 0; i < result.changed_lines.size(); ++i) {
+		const auto run = result.changed_lines[i];
+		for (size_t n = 0; n < run && y < num_lines; ++n, ++y)
+			flagged[y] = (i % 2) == 1;
+	}
+	return flagged;
+}
+
+void expect_null_lines_match(const Pipeline &p)
+{
+	SCOPED_TRACE(p.name);
+	const auto frames = make_frames(p.source_size);
+	const auto expected = run_pipeline(p, frames, false);
+	const auto actual = run_pipeline(p, frames, true);
+	ASSERT_EQ(expected.size(), actual.size());
+
+	const size_t out_pitch = width * p.xscale * p.output_size;
+	const size_t out_lines = height * p.yscale;
+	for (size_t f = 0; f < expected.size(); ++f) {
+		EXPECT_TRUE(expected[f].output == actual[f].output)
+		        << "output of frame " << f;
+		if (f == 0)
+			continue;
+		// Lines that weren't redrawn may be left out, but every line
+		// that differs from the frame before has to be reported
+		const auto flagged = flagged_lines(actual[f], out_lines);
+		for (size_t y = 0; y < out_lines; ++y) {
+			const auto offset = y * out_pitch;
+			const bool differs = !std::equal(
+			        actual[f].output.begin() + offset,
+			        actual[f].output.begin() + offset + out_pitch,
+			        actual[f - 1].output.begin() + offset);
+			EXPECT_TRUE(!differs || flagged[y])
+			        << "line " << y << " of frame " << f << " isn't reported";
+		}
+	}
+}
+
+void setup_palette()
+{
+	for (int i = 0; i < 256; ++i) {
+		render.pal.lut.b16[i] = static_cast<uint16_t>(random_byte() << 8 |
+		                                              random_byte());
+		render.pal.lut.b32[i] = static_cast<uint32_t>(
+		        random_byte() << 16 | random_byte() << 8 | random_byte());
+		render.pal.modified[i] = 0;
+	}
+}
+
+std::vector<Pipeline> simple_pipelines(const ScalerSimpleBlock_t &block)
+{
+	std::vector<Pipeline> pipelines = {};
+	for (int linear = 0; linear < 2; ++linear) {
+		const auto &handlers = linear ? block.Linear : block.Random;
+		for (int in = 0; in < 5; ++in)
+			for (int out = 0; out < 4; ++out) {
+				if (!handlers[in][out])
+					continue;
+				Pipeline p;
+				p.name = std::string(block.name) +
+				         (linear ? " linear " : " random ") +
+				         std::to_string(in) + "->" + std::to_string(out);
+				p.line_handler = handlers[in][out];
+				p.xscale = static_cast<uint32_t>(block.xscale);
+				p.yscale = static_cast<uint32_t>(block.yscale);
+				p.source_size = source_sizes[in];
+				p.output_size = output_sizes[out];
+				pipelines.push_back(p);
+			}
+	}
+	return pipelines;
+}
+
+TEST(RenderScalers, SimpleScalersSkipNullLines)
+{
+	setup_palette();
+	const ScalerSimpleBlock_t *blocks[] = {
+	        &ScaleNormal1x, &ScaleNormalDw, &ScaleNormalDh, &ScaleNormal2x,
+	        &ScaleNormal3x,
+#if RENDER_USE_ADVANCED_SCALERS > 0
+	        &ScaleTV2x,     &ScaleTV3x,     &ScaleRGB2x,    &ScaleRGB3x,
+	        &ScaleScan2x,   &ScaleScan3x,
+#endif
+	};
+	for (const auto block : blocks)
+		for (const auto &p : simple_pipelines(*block))
+			expect_null_lines_match(p);
+}
+
+#if RENDER_USE_ADVANCED_SCALERS > 2
+TEST(RenderScalers, ComplexScalersSkipNullLines)
+{
+	setup_palette();
+	const ScalerComplexBlock_t *blocks[] = {
+	        &ScaleHQ2x,       &ScaleHQ3x,       &Scale2xSaI,
+	        &ScaleSuper2xSaI, &ScaleSuperEagle, &ScaleAdvMame2x,
+	        &ScaleAdvMame3x,  &ScaleAdvInterp2x, &ScaleAdvInterp3x,
+	};
+	for (const auto block : blocks)
+		for (int linear = 0; linear < 2; ++linear) {
+			const auto &complex = linear ? block->Linear : block->Random;
+			for (int in = 0; in < 5; ++in)
+				for (int out = 0; out < 4; ++out) {
+					if (!complex[out] || !ScalerCache[in][out])
+						continue;
+					Pipeline p;
+					p.name = std::string(block->name) +
+					         (linear ? " linear " : " random ") +
+					         std::to_string(in) + "->" +
+					         std::to_string(out);
+					p.line_handler = ScalerCache[in][out];
+					p.complex_handler = complex[out];
+					p.xscale = static_cast<uint32_t>(block->xscale);
+					p.yscale = static_cast<uint32_t>(block->yscale);
+					p.source_size = source_sizes[in];
+					p.output_size = output_sizes[out];
+					expect_null_lines_match(p);
+				}
+		}
+}
+#endif
+
+TEST(RenderScalers, NearestSkipsNullLines)
+{
+	for (const uint32_t pixel_size : {1, 2, 4})
+		for (const uint32_t scale : {1, 2, 3}) {
+			Pipeline p;
+			p.name = "nearest " + std::to_string(pixel_size * 8) +
+			         "bpp " + std::to_string(scale) + "x";
+			p.line_handler = Scaler_NearestLine;
+			p.xscale = scale;
+			p.yscale = scale;
+			p.source_size = pixel_size;
+			p.output_size = pixel_size;
+			p.nearest_pixel_size = pixel_size;
+			expect_null_lines_match(p);
+		}
+}
+
+} // namespace
@@ -0,0 +1,201 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "task_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Holds a worker busy until opened
+class Gate {
+public:
+	void Open()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			is_open = true;
+		}
+		opened.notify_all();
+	}
+
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		opened.wait(lock, [this] { return is_open; });
+	}
+
+private:
+	std::mutex mutex = {};
+	std::condition_variable opened = {};
+	bool is_open = false;
+};
+
+TEST(TaskPool, SizedToHostCores)
+{
+	TaskPool pool("test:pool");
+	const auto cores = static_cast<int>(std::thread::hardware_concurrency());
+	EXPECT_EQ(pool.NumWorkers(), std::max(1, cores));
+}
+
+TEST(TaskPool, ExplicitWorkerCount)
+{
+	TaskPool pool("test:pool", 3);
+	EXPECT_EQ(pool.NumWorkers(), 3);
+}
+
+TEST(TaskPool, FuturesReturnResults)
+{
+	TaskPool pool("test:pool", 4);
+	std::vector<std::future<int>> results;
+	for (int i = 0; i < 100; ++i) {
+		const auto lane = (i % 2) ? TaskLane::Audio : TaskLane::Background;
+		results.push_back(pool.Submit("square", lane, [i] { return i * i; }));
+	}
+	for (int i = 0; i < 100; ++i)
+		EXPECT_EQ(results[i].get(), i * i);
+}
+
+TEST(TaskPool, VoidTasks)
+{
+	TaskPool pool("test:pool", 2);
+	std::atomic<int> count = 0;
+	std::vector<std::future<void>> results;
+	for (int i = 0; i < 50; ++i)
+		results.push_back(pool.Submit("count", TaskLane::Background,
+		                              [&count] { ++count; }));
+	for (auto &result : results)
+		result.get();
+	EXPECT_EQ(count, 50);
+}
+
+TEST(TaskPool, ExceptionsReachTheFuture)
+{
+	TaskPool pool("test:pool", 1);
+	auto result = pool.Submit("throw", TaskLane::Background, []() -> int {
+		throw std::runtime_error("failed");
+	});
+	EXPECT_THROW(result.get(), std::runtime_error);
+
+	// The worker survives the exception
+	EXPECT_EQ(pool.Submit("after", TaskLane::Audio, [] { return 1; }).get(), 1);
+}
+
+TEST(TaskPool, AudioLaneRunsFirst)
+{
+	TaskPool pool("test:pool", 1);
+	Gate gate;
+	auto blocker = pool.Submit("block", TaskLane::Background,
+	                           [&gate] { gate.Wait(); });
+
+	std::mutex order_mutex;
+	std::vector<char> order;
+	auto record = [&](const char lane) {
+		std::lock_guard<std::mutex> lock(order_mutex);
+		order.push_back(lane);
+	};
+	std::vector<std::future<void>> results;
+	for (int i = 0; i < 3; ++i)
+		results.push_back(pool.Submit("bg", TaskLane::Background,
+		                              [&] { record('b'); }));
+	for (int i = 0; i < 3; ++i)
+		results.push_back(pool.Submit("audio", TaskLane::Audio,
+		                              [&] { record('a'); }));
+	gate.Open();
+	blocker.get();
+	for (auto &result : results)
+		result.get();
+
+	const std::vector<char> expected = {'a', 'a', 'a', 'b', 'b', 'b'};
+	EXPECT_EQ(order, expected);
+}
+
+TEST(TaskPool, LastIdleWorkerIsKeptForAudio)
+{
+	TaskPool pool("test:pool", 2);
+	Gate gate;
+	auto blocker = pool.Submit("block", TaskLane::Background,
+	                           [&gate] { gate.Wait(); });
+
+	// The second worker won't take background work while the first is
+	// busy, but it does run audio work
+	std::atomic<bool> background_ran = false;
+	auto background = pool.Submit("bg", TaskLane::Background,
+	                              [&] { background_ran = true; });
+	EXPECT_EQ(pool.Submit("audio", TaskLane::Audio, [] { return 2; }).get(), 2);
+	EXPECT_FALSE(background_ran);
+
+	gate.Open();
+	blocker.get();
+	background.get();
+	EXPECT_TRUE(background_ran);
+}
+
+TEST(TaskPool, Stats)
+{
+	TaskPool pool("test:pool", 2);
+	for (int i = 0; i < 5; ++i)
+		pool.Submit("sleep", TaskLane::Background, [] {
+			    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		    }).get();
+	pool.Submit("noop", TaskLane::Audio, [] {}).get();
+
+	const auto stats = pool.GetStats();
+	ASSERT_EQ(stats.size(), 2);
+	const auto &sleep_stats = stats.at("sleep");
+	EXPECT_EQ(sleep_stats.runs, 5);
+	EXPECT_GE(sleep_stats.total_us, 5 * 2000);
+	EXPECT_GE(sleep_stats.max_us, 2000);
+	EXPECT_LE(sleep_stats.max_us, sleep_stats.total_us);
+	EXPECT_GE(sleep_stats.total_wait_us, 0);
+	EXPECT_EQ(stats.at("noop").runs, 1);
+
+	pool.ResetStats();
+	EXPECT_TRUE(pool.GetStats().empty());
+}
+
+TEST(TaskPool, DestructorRunsQueuedTasks)
+{
+	std::atomic<int> count = 0;
+	{
+		TaskPool pool("test:pool", 2);
+		for (int i = 0; i < 20; ++i)
+			pool.Submit("count", TaskLane::Background, [&count] {
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+				++count;
+			});
+	}
+	EXPECT_EQ(count, 20);
+}
+
+TEST(TaskPool, SharedPool)
+{
+	auto &pool = TASK_GetPool();
+	EXPECT_EQ(&pool, &TASK_GetPool());
+	EXPECT_GE(pool.NumWorkers(), 1);
+	EXPECT_EQ(pool.Submit("shared", TaskLane::Background, [] { return 3; }).get(),
+	          3);
+}
+
+} // namespace
@@ -0,0 +1,231 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/hardware/vga_composite.cpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "mem_unaligned.h"
+#include "support.h"
+
+namespace {
+
+// The scanline-filter implementation that used to live in vga_draw.cpp,
+// kept verbatim (apart from taking its parameters explicitly) as the
+// reference that the table-driven decoder must match pixel for pixel.
+uint8_t reference_byte_clamp(int v)
+{
+	v >>= 13;
+	return v < 0 ? 0u : (v > 255 ? 255u : static_cast<uint8_t>(v));
+}
+
+uint8_t *reference_composite_process(uint8_t *TempLine,
+                                     uint8_t border,
+                                     uint32_t blocks,
+                                     bool doublewidth,
+                                     const CompositeParams &p)
+{
+	static int temp[SCALER_MAXWIDTH + 10] = {0};
+	static int atemp[SCALER_MAXWIDTH + 2] = {0};
+	static int btemp[SCALER_MAXWIDTH + 2] = {0};
+	const int *CGA_Composite_Table = p.table;
+
+	int w = blocks * 4;
+
+	if (doublewidth) {
+		uint8_t *source = TempLine + w - 1;
+		uint8_t *dest = TempLine + w * 2 - 2;
+		for (int x = 0; x < w; ++x) {
+			*dest = *source;
+			*(dest + 1) = *source;
+			--source;
+			dest -= 2;
+		}
+		blocks *= 2;
+		w *= 2;
+	}
+
+	// Simulate CGA composite output
+	int *o = temp;
+	auto push_pixel = [&o](const int v) {
+		*o = v;
+		++o;
+	};
+
+	uint8_t *rgbi = TempLine;
+	const int *b = &CGA_Composite_Table[border * 68];
+	for (int x = 0; x < 4; ++x)
+		push_pixel(b[(x + 3) & 3]);
+	push_pixel(CGA_Composite_Table[(border << 6) | ((*rgbi) << 2) | 3]);
+	for (int x = 0; x < w - 1; ++x) {
+		push_pixel(CGA_Composite_Table[(rgbi[0] << 6) | (rgbi[1] << 2) | (x & 3)]);
+		++rgbi;
+	}
+	push_pixel(CGA_Composite_Table[((*rgbi) << 6) | (border << 2) | 3]);
+	for (int x = 0; x < 5; ++x)
+		push_pixel(b[x & 3]);
+
+	if (p.is_monochrome) {
+		// Decode
+		int *i = temp + 5;
+		uint16_t idx = 0;
+		for (uint32_t x = 0; x < blocks * 4; ++x) {
+			int c = (i[0] + i[0]) << 3;
+			int d = (i[-1] + i[1]) << 3;
+			int y = ((c + d) << 8) + p.sharpness * (c - d);
+			++i;
+			write_unaligned_uint32_at(TempLine, idx++,
+			                          reference_byte_clamp(y) * 0x10101);
+		}
+	} else {
+		// Store chroma
+		int *i = temp + 4;
+		int *ap = atemp + 1;
+		int *bp = btemp + 1;
+		for (int x = -1; x < w + 1; ++x) {
+			ap[x] = i[-4] - left_shift_signed(i[-2] - i[0] + i[2], 1) + i[4];
+			bp[x] = left_shift_signed(i[-3] - i[-1] + i[1] - i[3], 1);
+			++i;
+		}
+
+		// Decode
+		i = temp + 5;
+		i[-1] = (i[-1] << 3) - ap[-1];
+		i[0] = (i[0] << 3) - ap[0];
+
+		uint16_t idx = 0;
+		auto COMPOSITE_CONVERT = [&](const int I, const int Q) {
+			i[1] = (i[1] << 3) - ap[1];
+			const int c = i[0] + i[0];
+			const int d = i[-1] + i[1];
+			const int y = left_shift_signed(c + d, 8) + p.sharpness * (c - d);
+			const int rr = y + p.ri * (I) + p.rq * (Q);
+			const int gg = y + p.gi * (I) + p.gq * (Q);
+			const int bb = y + p.bi * (I) + p.bq * (Q);
+			++i;
+			++ap;
+			++bp;
+			const auto srgb = (reference_byte_clamp(rr) << 16) |
+			                  (reference_byte_clamp(gg) << 8) |
+			                  reference_byte_clamp(bb);
+			write_unaligned_uint32_at(TempLine, idx++, srgb);
+		};
+
+		for (uint32_t x = 0; x < blocks; ++x) {
+			COMPOSITE_CONVERT(ap[0], bp[0]);
+			COMPOSITE_CONVERT(-bp[0], ap[0]);
+			COMPOSITE_CONVERT(-ap[0], -bp[0]);
+			COMPOSITE_CONVERT(bp[0], -ap[0]);
+		}
+	}
+	return TempLine;
+}
+
+class CompositeDecoder : public ::testing::Test {
+protected:
+	std::mt19937 rng{0x0c6a}; // fixed seed for reproducible runs
+	std::vector<int> table = std::vector<int>(1024);
+	CompositeParams params = {};
+
+	int random_between(const int lo, const int hi)
+	{
+		return std::uniform_int_distribution<int>(lo, hi)(rng);
+	}
+
+	// Produces tables and coefficients in the same ranges that
+	// update_cga16_color() generates across its hue, saturation,
+	// contrast, brightness, and convergence settings.
+	void randomize_params(const bool is_monochrome)
+	{
+		for (auto &level : table)
+			level = random_between(-100, 400);
+		params.table = table.data();
+		params.ri = random_between(-600, 600);
+		params.rq = random_between(-600, 600);
+		params.gi = random_between(-600, 600);
+		params.gq = random_between(-600, 600);
+		params.bi = random_between(-600, 600);
+		params.bq = random_between(-600, 600);
+		params.sharpness = random_between(-256, 512);
+		params.is_monochrome = is_monochrome;
+	}
+
+	void expect_matching_lines(const uint32_t blocks, const bool doublewidth)
+	{
+		const auto hdots = blocks * 4 * (doublewidth ? 2 : 1);
+		std::vector<uint8_t> expected(hdots * 4);
+		for (uint32_t x = 0; x < blocks * 4; ++x)
+			expected[x] = static_cast<uint8_t>(random_between(0, 15));
+		auto actual = expected;
+		const auto border = static_cast<uint8_t>(random_between(0, 15));
+
+		reference_composite_process(expected.data(), border, blocks,
+		                            doublewidth, params);
+		composite_decode_line(actual.data(), border, blocks,
+		                      doublewidth, params);
+		ASSERT_EQ(actual, expected);
+	}
+};
+
+TEST_F(CompositeDecoder, ColourMatchesReference)
+{
+	for (int run = 0; run < 200; ++run) {
+		randomize_params(false);
+		expect_matching_lines(160, false); // 640 hdot graphics modes
+		expect_matching_lines(80, false);  // 80-column text
+	}
+}
+
+TEST_F(CompositeDecoder, ColourDoubleWidthMatchesReference)
+{
+	for (int run = 0; run < 200; ++run) {
+		randomize_params(false);
+		expect_matching_lines(80, true); // 320 pixel 4-colour modes
+		expect_matching_lines(40, true); // 40-column text
+	}
+}
+
+TEST_F(CompositeDecoder, MonochromeMatchesReference)
+{
+	for (int run = 0; run < 200; ++run) {
+		randomize_params(true);
+		expect_matching_lines(160, false);
+		expect_matching_lines(80, true);
+	}
+}
+
+TEST_F(CompositeDecoder, UniformLinesDecodeToUniformColour)
+{
+	randomize_params(false);
+	for (uint8_t colour = 0; colour < 16; ++colour) {
+		std::vector<uint8_t> line(640 * 4, colour);
+		composite_decode_line(line.data(), colour, 160, false, params);
+
+		// Away from the edges, a solid colour repeats every four hdots
+		for (size_t x = 16; x < 640 - 16; ++x)
+			EXPECT_EQ(read_unaligned_uint32_at(line.data(), x),
+			          read_unaligned_uint32_at(line.data(), x + 4));
+	}
+}
+
+} // namespace
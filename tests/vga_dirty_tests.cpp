@@ -0,0 +1,392 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Covers the dirty page tracking of the SVGA linear modes (VGA_Dirty in
+// vga.h): the write traps of the linear framebuffer, which lines
+// VGA_Draw_Dirty_Line hands the renderer as null lines, and that a scaled
+// frame built from them matches one drawn in full.
+
+#include "vga.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "../src/hardware/vga_draw.h"
+#include "paging.h"
+#include "render.h"
+#include "vga_stubs.h"
+
+namespace {
+
+// A 640x48 LIN8 mode, so lines straddle the 4 KiB tracking pages
+constexpr uint32_t width = 640;
+constexpr uint32_t height = 48;
+constexpr uint32_t frame_size = width * height;
+
+constexpr PhysPt lfb_addr = 0xe0000000;
+constexpr Bitu lfb_page = lfb_addr >> 12;
+
+uint32_t seed = 0x0badf00d;
+
+uint8_t random_byte()
+{
+	seed = seed * 1103515245 + 12345;
+	return static_cast<uint8_t>(seed >> 16);
+}
+
+// Writes as the guest does: through the TLB's handler until the page has
+// been made writable, and straight to video memory after that
+void guest_writeb(const uint32_t offset, const uint8_t val)
+{
+	const PhysPt addr = lfb_addr + offset;
+	if (writable_pages.count(addr >> 12))
+		vga.mem.linear[offset] = val;
+	else
+		get_tlb_writehandler(addr)->writeb(addr, val);
+}
+
+bool hardware_cursor_active()
+{
+	return true;
+}
+
+// Which lines of the last frame came through as null lines
+std::vector<bool> null_lines = {};
+ScalerLineHandler_t scaler_line = nullptr;
+bool is_first_frame = false;
+
+void record_line(const void *src)
+{
+	if (is_first_frame) {
+		// As RENDER_ClearCacheHandler does
+		const auto line = static_cast<const uint8_t *>(src);
+		for (uint32_t x = 0; x < width; ++x)
+			render.scale.cacheRead[x] = static_cast<uint8_t>(~line[x]);
+	}
+	null_lines.push_back(src == nullptr);
+	if (scaler_line)
+		scaler_line(src);
+}
+
+class VgaDirty : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		constexpr uint32_t memsize = 2 * 1024 * 1024;
+		vga.vmemsize = memsize;
+		vga.vmemwrap = memsize;
+		for (uint32_t i = 0; i < frame_size; ++i)
+			vga.mem.linear[i] = random_byte();
+		for (auto &page : vga.dirty.pages)
+			page = 0;
+		vga.dirty.plain_lines = false;
+		vga.dirty.tracking = true;
+		vga.mode = M_LIN8;
+		vga.s3.la_window = static_cast<uint16_t>(lfb_addr >> 16);
+		VGA_StartUpdateLFB();
+		svga.hardware_cursor_active = nullptr;
+		render.fullFrame = false;
+
+		for (Bitu page = 0; page <= (frame_size >> 12); ++page) {
+			paging.tlb.writehandler[lfb_page + page] = vga.lfb.handler;
+			paging.tlb.phys_page[lfb_page + page] =
+			        static_cast<uint32_t>(lfb_page + page);
+		}
+		writable_pages.clear();
+		VGA_ProtectDirtyPages();
+
+		VGA_DrawLine = VGA_Draw_Linear_Line;
+		scaler_line = nullptr;
+		is_first_frame = false;
+		RENDER_DrawLine = record_line;
+	}
+
+	// Runs the vertical timer for a frame drawn in the given parts
+	void StartFrame(const uint32_t start, const Bitu parts)
+	{
+		VGA_ProtectDirtyPages();
+		auto &d = vga.draw;
+		d.mode = PART;
+		d.linear_base = vga.mem.linear;
+		d.linear_mask = vga.vmemwrap - 1;
+		d.line_length = width;
+		d.address_line_total = 1;
+		d.address_add = width;
+		d.address = start;
+		d.address_line = 0;
+		d.lines_done = 0;
+		d.lines_total = height;
+		d.split_line = height + 1;
+		d.parts_left = parts;
+		VGA_DirtyFrameStart();
+		null_lines.clear();
+	}
+
+	void DrawFrame(const uint32_t start = 0)
+	{
+		StartFrame(start, 1);
+		VGA_DrawPart(height);
+	}
+
+	// The lines showing any of the given offsets should be drawn, all
+	// others come through as null lines
+	static std::vector<bool> ExpectedNullLines(const std::set<uint32_t> &offsets)
+	{
+		std::set<Bitu> pages = {};
+		for (const auto offset : offsets)
+			pages.insert(offset >> vga_dirty_page_shift);
+		std::vector<bool> expected(height, true);
+		for (uint32_t y = 0; y < height; ++y) {
+			const auto first = (y * width) >> vga_dirty_page_shift;
+			const auto last = ((y + 1) * width - 1) >> vga_dirty_page_shift;
+			for (auto page = first; page <= last; ++page)
+				if (pages.count(page))
+					expected[y] = false;
+		}
+		return expected;
+	}
+
+	static std::vector<bool> NoNullLines()
+	{
+		return std::vector<bool>(height, false);
+	}
+};
+
+TEST_F(VgaDirty, FirstWriteToAPageTraps)
+{
+	guest_writeb(100, 1);
+	EXPECT_EQ(vga.mem.linear[100], 1);
+	EXPECT_EQ(vga.dirty.pages[0], vga_dirty_written);
+	EXPECT_EQ(writable_pages, std::set<Bitu>{lfb_page});
+
+	// Further writes to the page go straight to video memory
+	guest_writeb(4000, 2);
+	EXPECT_EQ(vga.mem.linear[4000], 2);
+	EXPECT_EQ(writable_pages, std::set<Bitu>{lfb_page});
+
+	guest_writeb(5000, 3);
+	EXPECT_EQ(vga.dirty.pages[1], vga_dirty_written);
+	EXPECT_EQ(writable_pages, (std::set<Bitu>{lfb_page, lfb_page + 1}));
+
+	// The vertical timer closes the pages, so the next write traps again
+	VGA_ProtectDirtyPages();
+	EXPECT_TRUE(writable_pages.empty());
+	vga.dirty.pages[0] = 0;
+	guest_writeb(200, 4);
+	EXPECT_EQ(vga.dirty.pages[0], vga_dirty_written);
+	EXPECT_EQ(writable_pages, std::set<Bitu>{lfb_page});
+}
+
+TEST_F(VgaDirty, WritesThroughOtherMappingsAreOnlyMarked)
+{
+	// The page is reached through a different TLB entry, so it can't be
+	// opened, only marked
+	PageHandler other_mapping;
+	paging.tlb.writehandler[lfb_page + 2] = &other_mapping;
+	vga.lfb.handler->writeb(lfb_addr + 2 * 4096 + 10, 5);
+	EXPECT_EQ(vga.mem.linear[2 * 4096 + 10], 5);
+	EXPECT_EQ(vga.dirty.pages[2], vga_dirty_written);
+	EXPECT_TRUE(writable_pages.empty());
+}
+
+TEST_F(VgaDirty, LinearAliasesOpenTheirOwnPage)
+{
+	// A linear page the guest mapped to the sixth page of the framebuffer
+	constexpr Bitu lin_page = 0x400;
+	paging.tlb.writehandler[lin_page] = vga.lfb.handler;
+	paging.tlb.phys_page[lin_page] = static_cast<uint32_t>(lfb_page + 5);
+	vga.lfb.handler->writeb((lin_page << 12) + 8, 6);
+	EXPECT_EQ(vga.mem.linear[5 * 4096 + 8], 6);
+	EXPECT_EQ(vga.dirty.pages[5], vga_dirty_written);
+	EXPECT_EQ(vga.dirty.pages[0], 0);
+	EXPECT_EQ(writable_pages, std::set<Bitu>{lin_page});
+	paging.tlb.writehandler[lin_page] = nullptr;
+}
+
+TEST_F(VgaDirty, PhysicalWritesMarkThePhysicalPage)
+{
+	// The linear page at the same address belongs to another handler, or
+	// to this one but maps outside of the framebuffer, so the address is
+	// taken as physical and no linear page is opened
+	PageHandler other_mapping;
+	paging.tlb.writehandler[lfb_page + 3] = &other_mapping;
+	vga.lfb.handler->writeb(lfb_addr + 3 * 4096 + 8, 7);
+	EXPECT_EQ(vga.mem.linear[3 * 4096 + 8], 7);
+	EXPECT_EQ(vga.dirty.pages[3], vga_dirty_written);
+
+	paging.tlb.writehandler[lfb_page + 4] = vga.lfb.handler;
+	paging.tlb.phys_page[lfb_page + 4] = 0x123;
+	vga.lfb.handler->writew(lfb_addr + 4 * 4096 + 8, 0x0908);
+	EXPECT_EQ(vga.mem.linear[4 * 4096 + 8], 8);
+	EXPECT_EQ(vga.mem.linear[4 * 4096 + 9], 9);
+	EXPECT_EQ(vga.dirty.pages[4], vga_dirty_written);
+	EXPECT_TRUE(writable_pages.empty());
+}
+
+TEST_F(VgaDirty, OnlyWrittenLinesAreDrawn)
+{
+	// Without a previous frame to line up with, everything is drawn
+	DrawFrame();
+	EXPECT_EQ(null_lines, NoNullLines());
+
+	DrawFrame();
+	EXPECT_EQ(null_lines, ExpectedNullLines({}));
+
+	guest_writeb(3 * width + 5, 1);
+	guest_writeb(20 * width, 2);
+	VGA_MarkDirty(40 * width, 2 * width);
+	DrawFrame();
+	EXPECT_EQ(null_lines,
+	          ExpectedNullLines({3 * width + 5, 20 * width, 40 * width,
+	                             42 * width - 1}));
+
+	// The writes were shown, so they're skipped again
+	DrawFrame();
+	EXPECT_EQ(null_lines, ExpectedNullLines({}));
+}
+
+TEST_F(VgaDirty, WritesDuringAFrameShowInTheNext)
+{
+	DrawFrame();
+	DrawFrame();
+
+	// Draw the top half, then write to a line that was already drawn
+	StartFrame(0, 2);
+	VGA_DrawPart(height / 2);
+	guest_writeb(width, 7);
+	VGA_DrawPart(height / 2);
+
+	DrawFrame();
+	EXPECT_EQ(null_lines, ExpectedNullLines({width}));
+	DrawFrame();
+	EXPECT_EQ(null_lines, ExpectedNullLines({}));
+}
+
+TEST_F(VgaDirty, LayoutChangesDrawEveryLine)
+{
+	DrawFrame();
+	DrawFrame();
+
+	// Panning to another start address
+	DrawFrame(width);
+	EXPECT_EQ(null_lines, NoNullLines());
+	DrawFrame(width);
+	EXPECT_EQ(null_lines, ExpectedNullLines({}));
+	DrawFrame();
+	EXPECT_EQ(null_lines, NoNullLines());
+
+	// The renderer asked for the whole frame
+	render.fullFrame = true;
+	DrawFrame();
+	EXPECT_EQ(null_lines, NoNullLines());
+	render.fullFrame = false;
+
+	// The writers aren't accounted for, for example in the VGA_Changes
+	// builds
+	vga.dirty.tracking = false;
+	DrawFrame();
+	EXPECT_EQ(null_lines, NoNullLines());
+	vga.dirty.tracking = true;
+	DrawFrame();
+	DrawFrame();
+	EXPECT_EQ(null_lines, ExpectedNullLines({}));
+}
+
+TEST_F(VgaDirty, HardwareCursorDrawsEveryLine)
+{
+	DrawFrame();
+	DrawFrame();
+
+	// The cursor is drawn over memory that doesn't change
+	svga.hardware_cursor_active = hardware_cursor_active;
+	VGA_ActivateHardwareCursor();
+	DrawFrame();
+	EXPECT_EQ(null_lines, NoNullLines());
+	DrawFrame();
+	EXPECT_EQ(null_lines, NoNullLines());
+}
+
+TEST_F(VgaDirty, ScaledFramesMatchFullRedraws)
+{
+	for (uint32_t i = 0; i < 256; ++i)
+		render.pal.lut.b32[i] = static_cast<uint32_t>(
+		        random_byte() << 16 | random_byte() << 8 | random_byte());
+	const std::vector<uint8_t> initial(vga.mem.linear,
+	                                   vga.mem.linear + frame_size);
+
+	// Each frame's writes, as offsets into the frame
+	std::vector<std::set<uint32_t>> writes = {{}, {}, {10, 4095, 4096}};
+	for (int f = 0; f < 5; ++f) {
+		std::set<uint32_t> offsets = {};
+		for (int i = 0; i < 6; ++i)
+			offsets.insert((random_byte() << 8 | random_byte()) % frame_size);
+		writes.push_back(offsets);
+	}
+
+	size_t num_null_lines = 0;
+	auto run = [&](const bool tracking) {
+		std::copy(initial.begin(), initial.end(), vga.mem.linear);
+		vga.dirty.plain_lines = false;
+		vga.dirty.tracking = tracking;
+		scaler_line = ScaleNormal2x.Linear[0][scalerMode32];
+		for (uint32_t y = 0; y < height; ++y)
+			Scaler_Aspect[y] = 2;
+		std::vector<uint8_t> output(width * 2 * 4 * height * 2);
+
+		uint8_t value = 0;
+		std::vector<std::vector<uint8_t>> frames = {};
+		for (size_t f = 0; f < writes.size(); ++f) {
+			for (const auto offset : writes[f])
+				guest_writeb(offset, ++value);
+
+			render.src.width = width;
+			render.scale.cachePitch = width;
+			render.scale.cacheRead = reinterpret_cast<uint8_t *>(
+			        &scalerSourceCache);
+			render.scale.outWrite = output.data();
+			render.scale.outPitch = static_cast<int>(width * 2 * 4);
+			render.scale.inLine = 0;
+			render.scale.outLine = 0;
+			render.scale.inHeight = height;
+			render.scale.blocks = width / SCALER_BLOCKSIZE;
+			render.scale.lastBlock = width % SCALER_BLOCKSIZE;
+			Scaler_ChangedLineIndex = 0;
+			Scaler_ChangedLines[0] = 0;
+			is_first_frame = (f == 0);
+			DrawFrame();
+			num_null_lines += static_cast<size_t>(
+			        std::count(null_lines.begin(), null_lines.end(), true));
+			frames.push_back(output);
+		}
+		return frames;
+	};
+	const auto expected = run(false);
+	EXPECT_EQ(num_null_lines, 0u);
+	const auto actual = run(true);
+	EXPECT_GT(num_null_lines, 0u);
+	ASSERT_EQ(expected.size(), actual.size());
+	for (size_t f = 0; f < expected.size(); ++f)
+		EXPECT_TRUE(expected[f] == actual[f]) << "frame " << f;
+}
+
+} // namespace
@@ -0,0 +1,381 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Measures the video output path without a display. Synthetic video memory
+// for each major mode is drawn by VGA_DrawPart with the mode's real line
+// handler, first on its own and then through each scaler into a 32-bit
+// output frame. Consecutive frames are drawn from two different video
+// pages, so every line is redrawn and rescaled.
+
+#include "vga.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "../src/hardware/vga_draw.h"
+#include "render.h"
+#include "vga_stubs.h"
+
+namespace {
+
+constexpr int frames_per_run = 30;
+
+uint32_t seed = 0x1234567;
+
+uint8_t random_byte()
+{
+	seed = seed * 1103515245 + 12345;
+	return static_cast<uint8_t>(seed >> 16);
+}
+
+// Fills the lookup tables and video memory with plausible content. The
+// tables follow VGA_Init and the composite setup in spirit only, the exact
+// colours don't matter for timing.
+void setup_video()
+{
+	constexpr uint32_t memsize = 8 * 1024 * 1024;
+	vga.vmemsize = memsize;
+	vga.vmemwrap = memsize;
+	for (uint32_t i = 0; i < memsize; ++i)
+		vga.mem.linear[i] = random_byte();
+	for (uint32_t i = 0; i < memsize * 2; ++i)
+		vga.fastmem[i] = random_byte() & 0x0f;
+
+	for (uint32_t i = 0; i < 16; ++i) {
+		CGA_2_Table[i] = ((i >> 3) & 1) | (((i >> 2) & 1) << 8) |
+		                 (((i >> 1) & 1) << 16) | ((i & 1) << 24);
+		TXT_FG_Table[i] = i * 0x01010101;
+		TXT_BG_Table[i] = i * 0x01010101;
+		TXT_Font_Table[i] = ((i & 1) ? 0xff000000 : 0) |
+		                    ((i & 2) ? 0x00ff0000 : 0) |
+		                    ((i & 4) ? 0x0000ff00 : 0) |
+		                    ((i & 8) ? 0x000000ff : 0);
+		vga.attr.palette[i] = static_cast<uint8_t>(i);
+	}
+	for (uint32_t i = 0; i < 256; ++i) {
+		CGA_4_Table[i] = ((i >> 6) & 3) | (((i >> 4) & 3) << 8) |
+		                 (((i >> 2) & 3) << 16) | ((i & 3) << 24);
+		CGA_4_HiRes_Table[i] = CGA_4_Table[i];
+		vga.dac.xlat16[i] = static_cast<uint16_t>(random_byte() << 8 |
+		                                          random_byte());
+		render.pal.lut.b32[i] = static_cast<uint32_t>(
+		        random_byte() << 16 | random_byte() << 8 | random_byte());
+	}
+	for (int i = 0; i < 1024; ++i)
+		CGA_Composite_Table[i] = (i * 37) % 1536 - 256;
+	vga.ri = 245;
+	vga.rq = 159;
+	vga.gi = -70;
+	vga.gq = -166;
+	vga.bi = -283;
+	vga.bq = 436;
+	vga.sharpness = 128;
+
+	static uint8_t font[256 * 32];
+	for (auto &b : font)
+		b = random_byte();
+	vga.draw.font_tables[0] = font;
+	vga.draw.font_tables[1] = font;
+	vga.draw.blinking = 1;
+	vga.draw.blink = true;
+	vga.draw.cursor.enabled = false;
+	vga.crtc.underline_location = 0x1f;
+}
+
+struct VideoMode {
+	const char *name = nullptr;
+	VGA_Line_Handler handler = nullptr;
+	int width = 0;
+	int height = 0;
+	unsigned bpp = 0;                // as handed to the renderer
+	Bitu blocks = 0;                 // character or byte columns
+	Bitu line_length = 0;            // bytes per linear line
+	Bitu address_line_total = 1;     // scanlines per address row
+	Bitu address_add = 0;            // address step between rows
+	Bitu page_size = 0;              // distance between the two pages
+	uint8_t *linear_base = nullptr;  // linear modes
+	Bitu linear_mask = 0;
+	bool tandy_memory = false;       // CGA modes draw from draw_base
+	uint8_t line_mask = 0;
+	uint8_t line_shift = 0;
+	Bitu addr_mask = 0;
+	bool char9dot = false;
+};
+
+uint8_t *text_page(const int page)
+{
+	return vga.mem.linear + page * 0x8000;
+}
+
+std::vector<VideoMode> make_modes()
+{
+	const Bitu vga_mask = vga.vmemwrap - 1;
+	const Bitu ega_mask = (static_cast<Bitu>(vga.vmemwrap) << 1) - 1;
+
+	auto text = [](const char *name, VGA_Line_Handler handler, int width,
+	               int height, unsigned bpp, Bitu char_height, bool char9dot) {
+		VideoMode m;
+		m.name = name;
+		m.handler = handler;
+		m.width = width;
+		m.height = height;
+		m.bpp = bpp;
+		m.blocks = 80;
+		m.address_line_total = char_height;
+		m.address_add = 160;
+		m.tandy_memory = true;
+		m.linear_mask = 0x3fff;
+		m.char9dot = char9dot;
+		return m;
+	};
+	auto cga = [](const char *name, VGA_Line_Handler handler, int width,
+	              unsigned bpp) {
+		VideoMode m;
+		m.name = name;
+		m.handler = handler;
+		m.width = width;
+		m.height = 200;
+		m.bpp = bpp;
+		m.blocks = 80;
+		m.address_line_total = 2;
+		m.address_add = 80;
+		m.tandy_memory = true;
+		m.line_mask = 1;
+		m.line_shift = 13;
+		m.addr_mask = 0x1fff;
+		return m;
+	};
+	auto linear = [](const char *name, VGA_Line_Handler handler, int width,
+	                 int height, unsigned bpp, Bitu bytes_per_pixel,
+	                 uint8_t *base, Bitu mask, Bitu page_size) {
+		VideoMode m;
+		m.name = name;
+		m.handler = handler;
+		m.width = width;
+		m.height = height;
+		m.bpp = bpp;
+		// as in VGA_SetupDrawing, the Xlat16 handlers count the
+		// converted bytes
+		m.line_length = static_cast<Bitu>(width) * ((bpp + 1) / 8);
+		m.address_add = static_cast<Bitu>(width) * bytes_per_pixel;
+		m.page_size = page_size;
+		m.linear_base = base;
+		m.linear_mask = mask;
+		return m;
+	};
+
+	return {
+	        text("text 80x25 (VGA)", VGA_TEXT_Xlat16_Draw_Line, 720, 400,
+	             16, 16, true),
+	        text("text 80x25 (CGA)", VGA_TEXT_Draw_Line, 640, 200, 8, 8, false),
+	        cga("CGA 4-colour", VGA_Draw_2BPP_Line, 320, 8),
+	        cga("CGA 2-colour", VGA_Draw_1BPP_Line, 640, 8),
+	        cga("CGA composite", VGA_Draw_CGA4_Composite_Line, 640, 32),
+	        linear("EGA 16-colour", VGA_Draw_Xlat16_Linear_Line, 640, 350,
+	               16, 1, vga.fastmem, ega_mask, 0x40000),
+	        linear("VGA 13h", VGA_Draw_Xlat16_Linear_Line, 320, 200, 16, 1,
+	               vga.mem.linear, vga_mask, 0x10000),
+	        linear("VGA mode X", VGA_Draw_Xlat16_Linear_Line, 320, 240, 16,
+	               1, vga.mem.linear, vga_mask, 0x20000),
+	        linear("SVGA LIN8 640x480", VGA_Draw_VGA_Line_HWMouse, 640,
+	               480, 8, 1, vga.mem.linear, vga_mask, 0x80000),
+	        linear("SVGA LIN15 640x480", VGA_Draw_LIN16_Line_HWMouse, 640,
+	               480, 15, 2, vga.mem.linear, vga_mask, 0x100000),
+	        linear("SVGA LIN16 800x600", VGA_Draw_LIN16_Line_HWMouse, 800,
+	               600, 16, 2, vga.mem.linear, vga_mask, 0x100000),
+	        linear("SVGA LIN32 640x480", VGA_Draw_LIN32_Line_HWMouse, 640,
+	               480, 32, 4, vga.mem.linear, vga_mask, 0x200000),
+	        linear("SVGA LIN32 1024x768", VGA_Draw_LIN32_Line_HWMouse,
+	               1024, 768, 32, 4, vga.mem.linear, vga_mask, 0x400000),
+	};
+}
+
+struct Scaler {
+	const char *name = nullptr;
+	const ScalerSimpleBlock_t *simple = nullptr;
+	const ScalerComplexBlock_t *complex = nullptr;
+};
+
+const std::vector<Scaler> scalers = {
+        {"none", nullptr, nullptr},
+        {nullptr, &ScaleNormal1x, nullptr},
+        {nullptr, &ScaleNormal2x, nullptr},
+        {nullptr, &ScaleNormal3x, nullptr},
+        {nullptr, &ScaleTV2x, nullptr},
+        {nullptr, &ScaleTV3x, nullptr},
+        {nullptr, &ScaleRGB2x, nullptr},
+        {nullptr, &ScaleRGB3x, nullptr},
+        {nullptr, &ScaleScan2x, nullptr},
+        {nullptr, &ScaleScan3x, nullptr},
+        {nullptr, nullptr, &ScaleHQ2x},
+        {nullptr, nullptr, &ScaleHQ3x},
+        {nullptr, nullptr, &Scale2xSaI},
+        {nullptr, nullptr, &ScaleSuper2xSaI},
+        {nullptr, nullptr, &ScaleSuperEagle},
+        {nullptr, nullptr, &ScaleAdvMame2x},
+        {nullptr, nullptr, &ScaleAdvMame3x},
+        {nullptr, nullptr, &ScaleAdvInterp2x},
+        {nullptr, nullptr, &ScaleAdvInterp3x},
+};
+
+// The line handler tables' row for each source depth, as in RENDER_Reset
+int source_row(const unsigned bpp)
+{
+	switch (bpp) {
+	case 8: return 0;
+	case 15: return 1;
+	case 16: return 2;
+	default: return 4;
+	}
+}
+
+int bytes_per_pixel(const unsigned bpp)
+{
+	return static_cast<int>((bpp + 7) / 8);
+}
+
+void discard_line(const void *) {}
+
+struct Pipeline {
+	ScalerLineHandler_t line_handler = nullptr;
+	ScalerComplexHandler_t complex_handler = nullptr;
+	int xscale = 1;
+	int yscale = 1;
+	std::vector<uint8_t> output = {};
+};
+
+// Sets up the renderer state RENDER_Reset would for this mode and scaler.
+// Returns false if the combination isn't available.
+bool make_pipeline(const VideoMode &mode, const Scaler &scaler, Pipeline &p)
+{
+	const auto row = source_row(mode.bpp);
+	if (scaler.simple) {
+		p.line_handler = scaler.simple->Linear[row][scalerMode32];
+		p.xscale = static_cast<int>(scaler.simple->xscale);
+		p.yscale = static_cast<int>(scaler.simple->yscale);
+		for (int y = 0; y < mode.height; ++y)
+			Scaler_Aspect[y] = static_cast<uint8_t>(p.yscale);
+	} else if (scaler.complex) {
+		// The complex scalers only take sources of the output's
+		// format and work in a fixed-size frame cache
+		if (mode.bpp != 32 ||
+		    mode.width + 2 * SCALER_BLOCKSIZE > SCALER_COMPLEXWIDTH ||
+		    mode.height + 2 > SCALER_COMPLEXHEIGHT)
+			return false;
+		p.line_handler = ScalerCache[row][scalerMode32];
+		p.complex_handler = scaler.complex->Linear[scalerMode32];
+		p.xscale = static_cast<int>(scaler.complex->xscale);
+		p.yscale = static_cast<int>(scaler.complex->yscale);
+		// They lag a line behind, see MakeAspectTable
+		Scaler_Aspect[0] = 0;
+		for (int y = 1; y <= mode.height; ++y)
+			Scaler_Aspect[y] = static_cast<uint8_t>(p.yscale);
+	} else {
+		p.line_handler = discard_line;
+	}
+	if (!p.line_handler || (scaler.complex && !p.complex_handler))
+		return false;
+	p.output.resize(static_cast<size_t>(mode.width * p.xscale * 4) *
+	                static_cast<size_t>(mode.height * p.yscale));
+	return true;
+}
+
+// Draws one frame the way the VGA timing events and the renderer do
+void draw_frame(const VideoMode &mode, Pipeline &p, const int page)
+{
+	auto &d = vga.draw;
+	d.blocks = mode.blocks;
+	d.line_length = mode.line_length;
+	d.address_line_total = mode.address_line_total;
+	d.address_add = mode.address_add;
+	d.char9dot = mode.char9dot;
+	d.panning = 0;
+	if (mode.tandy_memory) {
+		vga.tandy.draw_base = text_page(page);
+		vga.tandy.line_mask = mode.line_mask;
+		vga.tandy.line_shift = mode.line_shift;
+		vga.tandy.addr_mask = mode.addr_mask;
+		d.linear_mask = mode.linear_mask;
+		d.address = 0;
+	} else {
+		d.linear_base = mode.linear_base;
+		d.linear_mask = mode.linear_mask;
+		d.address = page * mode.page_size;
+	}
+	d.address_line = 0;
+	d.lines_done = 0;
+	d.lines_total = static_cast<Bitu>(mode.height);
+	d.split_line = d.lines_total + 1;
+	d.parts_left = 1;
+	VGA_DrawLine = mode.handler;
+
+	const auto pitch = mode.width * p.xscale * 4;
+	render.src.width = static_cast<uint32_t>(mode.width);
+	render.scale.cachePitch = static_cast<uint32_t>(
+	        mode.width * bytes_per_pixel(mode.bpp));
+	render.scale.cacheRead = reinterpret_cast<uint8_t *>(&scalerSourceCache);
+	render.scale.outWrite = p.output.data();
+	render.scale.outPitch = pitch;
+	render.scale.inLine = 0;
+	render.scale.outLine = 0;
+	render.scale.inHeight = static_cast<uint32_t>(mode.height);
+	render.scale.blocks = render.src.width / SCALER_BLOCKSIZE;
+	render.scale.lastBlock = render.src.width % SCALER_BLOCKSIZE;
+	render.scale.complexHandler = p.complex_handler;
+	Scaler_ChangedLineIndex = 0;
+	Scaler_ChangedLines[0] = 0;
+	RENDER_DrawLine = p.line_handler;
+
+	VGA_DrawPart(static_cast<uint32_t>(mode.height));
+}
+
+double run(const VideoMode &mode, Pipeline &p)
+{
+	draw_frame(mode, p, 0); // warm up the caches
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 1; i <= frames_per_run; ++i)
+		draw_frame(mode, p, i & 1);
+	const std::chrono::duration<double, std::nano> elapsed =
+	        std::chrono::steady_clock::now() - start;
+	return elapsed.count() / frames_per_run;
+}
+
+} // namespace
+
+int main()
+{
+	setup_video();
+	for (const auto &mode : make_modes()) {
+		for (const auto &scaler : scalers) {
+			Pipeline p;
+			if (!make_pipeline(mode, scaler, p))
+				continue;
+			const auto ns = run(mode, p);
+			const char *name = scaler.simple    ? scaler.simple->name
+			                   : scaler.complex ? scaler.complex->name
+			                                    : scaler.name;
+			printf("%-20s %4dx%-4d %2ubpp  %-12s -> %4dx%-4d %12.0f ns/frame\n",
+			       mode.name, mode.width, mode.height, mode.bpp, name,
+			       mode.width * p.xscale, mode.height * p.yscale, ns);
+		}
+	}
+	return 0;
+}
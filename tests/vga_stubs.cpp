@@ -0,0 +1,148 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "vga_stubs.h"
+
+#include <vector>
+
+#include "../src/ints/int10.h"
+#include "inout.h"
+#include "paging.h"
+#include "pic.h"
+#include "render.h"
+#include "vga.h"
+
+// The parts of the emulator the VGA drawing and memory code reach into
+
+VGA_Type vga;
+SVGA_Driver svga;
+SVGACards svgaCard = SVGA_S3Trio;
+MachineType machine = MCH_VGA;
+std::vector<VideoModeBlock>::const_iterator CurMode;
+
+Render_t render;
+ScalerLineHandler_t RENDER_DrawLine = nullptr;
+
+int32_t CPU_Cycles = 0;
+int32_t CPU_CycleLeft = 0;
+int32_t CPU_CycleMax = 0;
+uint32_t PIC_Ticks = 0;
+
+uint32_t CGA_2_Table[16];
+uint32_t CGA_4_Table[256];
+uint32_t CGA_4_HiRes_Table[256];
+int CGA_Composite_Table[1024];
+uint32_t TXT_Font_Table[16];
+uint32_t TXT_FG_Table[16];
+uint32_t TXT_BG_Table[16];
+uint32_t ExpandTable[256];
+uint32_t FillTable[16];
+uint32_t Expand16Table[4][16];
+
+uint8_t MemBase[1024 * 1024];
+PagingBlock paging;
+
+void PIC_ActivateIRQ(uint8_t) {}
+void PIC_DeActivateIRQ(uint8_t) {}
+void PIC_AddEvent(PIC_EventHandler, double, uint32_t) {}
+void PIC_RemoveEvents(PIC_EventHandler) {}
+
+void RENDER_SetSize(uint32_t, uint32_t, unsigned, double, double, bool, bool) {}
+bool RENDER_StartUpdate()
+{
+	return true;
+}
+void RENDER_EndUpdate(bool) {}
+
+double VGA_GetPreferredRate()
+{
+	return 70.0;
+}
+void VGA_ATTR_SetEGAMonitorPalette(EGAMonitorMode) {}
+
+void XGA_Write(io_port_t, io_val_t, io_width_t) {}
+uint32_t XGA_Read(io_port_t, io_width_t)
+{
+	return 0;
+}
+
+void MEM_SetLFB(Bitu, Bitu, PageHandler *, PageHandler *) {}
+void MEM_SetPageHandler(Bitu, Bitu, PageHandler *) {}
+void PAGING_ClearTLB() {}
+
+std::set<Bitu> writable_pages = {};
+
+void PAGING_MakePageWritable(Bitu lin_page, HostPt)
+{
+	writable_pages.insert(lin_page);
+}
+void PAGING_UnlinkPages(Bitu lin_page, Bitu pages)
+{
+	for (Bitu i = 0; i < pages; ++i)
+		writable_pages.erase(lin_page + i);
+}
+
+uint8_t PageHandler::readb(PhysPt)
+{
+	return 0xff;
+}
+uint16_t PageHandler::readw(PhysPt)
+{
+	return 0xffff;
+}
+uint32_t PageHandler::readd(PhysPt)
+{
+	return 0xffffffff;
+}
+void PageHandler::writeb(PhysPt, uint8_t) {}
+void PageHandler::writew(PhysPt, uint16_t) {}
+void PageHandler::writed(PhysPt, uint32_t) {}
+HostPt PageHandler::GetHostReadPt(Bitu)
+{
+	return nullptr;
+}
+HostPt PageHandler::GetHostWritePt(Bitu)
+{
+	return nullptr;
+}
+bool PageHandler::readb_checked(PhysPt, uint8_t *)
+{
+	return false;
+}
+bool PageHandler::readw_checked(PhysPt, uint16_t *)
+{
+	return false;
+}
+bool PageHandler::readd_checked(PhysPt, uint32_t *)
+{
+	return false;
+}
+bool PageHandler::writeb_checked(PhysPt, uint8_t)
+{
+	return false;
+}
+bool PageHandler::writew_checked(PhysPt, uint16_t)
+{
+	return false;
+}
+bool PageHandler::writed_checked(PhysPt, uint32_t)
+{
+	return false;
+}
@@ -0,0 +1,38 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2022-2022  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_VGA_STUBS_H
+#define DOSBOX_VGA_STUBS_H
+
+// The VGA drawing and memory code and the scalers are built into the tests
+// and benchmarks that need them, with vga_stubs.cpp standing in for the
+// rest of the emulator they reach into
+
+#include "dosbox.h"
+
+#include <set>
+
+#include "mem.h"
+
+// The linear pages the TLB lets through straight to video memory, as
+// PAGING_MakePageWritable and PAGING_UnlinkPages leave them
+extern std::set<Bitu> writable_pages;
+
+#endif